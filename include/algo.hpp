@@ -6,6 +6,9 @@
 #include "ptr.hpp"
 #include <utility>
 #include <tuple>
+#include <memory>
+#include <iterator>
+#include <stdexcept>
 
 namespace fwd
 {
@@ -123,6 +126,324 @@ namespace fwd
 		}
 	};
 
+	//
+	// Small Vector
+	//
+
+	template
+	<
+		class Type, size_t Size = 8, template <class> class Alloc = allocator
+	>
+	class small_vector
+	// Sequence kept inline until it grows past Size, then on the heap
+	{
+		static_assert(0 < Size);
+
+		using traits = std::allocator_traits<Alloc<Type>>;
+
+		Type* first;
+		size_t count = 0;
+		size_t room = Size;
+		[[no_unique_address]] Alloc<Type> alloc;
+		alignas(Type) unsigned char store[Size * sizeof(Type)];
+
+		Type* local()
+		{
+			return reinterpret_cast<Type*>(store);
+		}
+
+		void release()
+		// Give back the heap buffer, if there is one
+		{
+			if (spilled())
+			{
+				traits::deallocate(alloc, first, room);
+				first = local();
+				room = Size;
+			}
+		}
+
+		template <class... Args> Type* move(size_t next, Args&&... args)
+		// Larger buffer holding the old elements, with one made from args after them
+		{
+			auto const ptr = traits::allocate(alloc, next);
+			if constexpr (0 < sizeof...(Args))
+			{
+				traits::construct(alloc, ptr + count, std::forward<Args>(args)...);
+			}
+			std::uninitialized_move(first, first + count, ptr);
+			std::destroy(first, first + count);
+			release();
+			first = ptr;
+			room = next;
+			return first + count;
+		}
+
+		void take(small_vector& that)
+		// Steal a heap buffer or move inline elements one by one
+		{
+			if (that.spilled())
+			{
+				first = std::exchange(that.first, that.local());
+				count = std::exchange(that.count, 0);
+				room = std::exchange(that.room, Size);
+			}
+			else
+			{
+				std::uninitialized_move(that.begin(), that.end(), first);
+				count = that.count;
+				that.clear();
+			}
+		}
+
+	public:
+
+		using value_type = Type;
+		using allocator_type = Alloc<Type>;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = Type&;
+		using const_reference = Type const&;
+		using pointer = Type*;
+		using const_pointer = Type const*;
+		using iterator = Type*;
+		using const_iterator = Type const*;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+		small_vector() : first(local())
+		{ }
+
+		explicit small_vector(size_t n) : small_vector()
+		{
+			resize(n);
+		}
+
+		small_vector(size_t n, Type const& value) : small_vector()
+		{
+			resize(n, value);
+		}
+
+		template <std::input_iterator Iterator> small_vector(Iterator begin, Iterator end) : small_vector()
+		{
+			assign(begin, end);
+		}
+
+		small_vector(init<Type> list) : small_vector(list.begin(), list.end())
+		{ }
+
+		small_vector(small_vector const& that) : small_vector(that.begin(), that.end())
+		{ }
+
+		small_vector(small_vector&& that) noexcept(std::is_nothrow_move_constructible_v<Type>)
+		: first(local()), alloc(that.alloc)
+		{
+			take(that);
+		}
+
+		~small_vector()
+		{
+			clear();
+			release();
+		}
+
+		small_vector& operator=(small_vector const& that)
+		{
+			if (this != &that)
+			{
+				assign(that.begin(), that.end());
+			}
+			return *this;
+		}
+
+		small_vector& operator=(small_vector&& that) noexcept(std::is_nothrow_move_constructible_v<Type>)
+		{
+			if (this != &that)
+			{
+				clear();
+				release();
+				take(that);
+			}
+			return *this;
+		}
+
+		small_vector& operator=(init<Type> list)
+		{
+			assign(list.begin(), list.end());
+			return *this;
+		}
+
+		template <std::input_iterator Iterator> void assign(Iterator begin, Iterator end)
+		{
+			clear();
+			if constexpr (std::forward_iterator<Iterator>)
+			{
+				reserve(static_cast<size_t>(std::distance(begin, end)));
+			}
+			for (; begin != end; ++begin)
+			{
+				emplace_back(*begin);
+			}
+		}
+
+		bool spilled() const
+		// Whether the elements have moved to the heap
+		{
+			return first != reinterpret_cast<Type const*>(store);
+		}
+
+		allocator_type get_allocator() const { return alloc; }
+
+		iterator begin() { return first; }
+		iterator end() { return first + count; }
+		const_iterator begin() const { return first; }
+		const_iterator end() const { return first + count; }
+		const_iterator cbegin() const { return begin(); }
+		const_iterator cend() const { return end(); }
+		reverse_iterator rbegin() { return reverse_iterator(end()); }
+		reverse_iterator rend() { return reverse_iterator(begin()); }
+		const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+		const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+		Type* data() { return first; }
+		Type const* data() const { return first; }
+		size_t size() const { return count; }
+		size_t capacity() const { return room; }
+		bool empty() const { return 0 == count; }
+		size_t max_size() const { return traits::max_size(alloc); }
+
+		Type& operator[](size_t n) { return first[n]; }
+		Type const& operator[](size_t n) const { return first[n]; }
+		Type& front() { return first[0]; }
+		Type const& front() const { return first[0]; }
+		Type& back() { return first[count - 1]; }
+		Type const& back() const { return first[count - 1]; }
+
+		Type& at(size_t n)
+		{
+			if (count <= n) throw std::out_of_range("small_vector::at");
+			return first[n];
+		}
+
+		Type const& at(size_t n) const
+		{
+			if (count <= n) throw std::out_of_range("small_vector::at");
+			return first[n];
+		}
+
+		void reserve(size_t n)
+		{
+			if (room < n)
+			{
+				(void) move(n);
+			}
+		}
+
+		void shrink_to_fit()
+		// Back inline when it fits, otherwise left as is
+		{
+			if (spilled() and count <= Size)
+			{
+				auto const ptr = first;
+				auto const size = room;
+				first = local();
+				room = Size;
+				std::uninitialized_move(ptr, ptr + count, first);
+				std::destroy(ptr, ptr + count);
+				traits::deallocate(alloc, ptr, size);
+			}
+		}
+
+		template <class... Args> Type& emplace_back(Args&&... args)
+		{
+			if (count < room)
+			{
+				traits::construct(alloc, first + count, std::forward<Args>(args)...);
+				return first[count++];
+			}
+			auto const ptr = move(room * 2, std::forward<Args>(args)...);
+			++count;
+			return *ptr;
+		}
+
+		void push_back(Type const& value) { (void) emplace_back(value); }
+		void push_back(Type&& value) { (void) emplace_back(std::move(value)); }
+
+		void pop_back()
+		{
+			std::destroy_at(first + --count);
+		}
+
+		template <class... Args> iterator emplace(const_iterator pos, Args&&... args)
+		{
+			auto const at = pos - first;
+			(void) emplace_back(std::forward<Args>(args)...);
+			std::rotate(first + at, end() - 1, end());
+			return first + at;
+		}
+
+		iterator insert(const_iterator pos, Type const& value) { return emplace(pos, value); }
+		iterator insert(const_iterator pos, Type&& value) { return emplace(pos, std::move(value)); }
+
+		iterator erase(const_iterator begin, const_iterator end)
+		{
+			auto const at = first + (begin - first);
+			auto const tail = std::move(first + (end - first), this->end(), at);
+			std::destroy(tail, this->end());
+			count = static_cast<size_t>(tail - first);
+			return at;
+		}
+
+		iterator erase(const_iterator pos)
+		{
+			return erase(pos, pos + 1);
+		}
+
+		void resize(size_t n)
+		{
+			if (n < count)
+			{
+				std::destroy(first + n, end());
+			}
+			else
+			{
+				reserve(n);
+				std::uninitialized_value_construct(end(), first + n);
+			}
+			count = n;
+		}
+
+		void resize(size_t n, Type const& value)
+		{
+			if (n < count)
+			{
+				std::destroy(first + n, end());
+			}
+			else
+			{
+				reserve(n);
+				std::uninitialized_fill(end(), first + n, value);
+			}
+			count = n;
+		}
+
+		void clear()
+		{
+			std::destroy(begin(), end());
+			count = 0;
+		}
+
+		void swap(small_vector& that)
+		{
+			std::swap(*this, that);
+		}
+
+		bool operator==(small_vector const& that) const
+		{
+			return std::equal(begin(), end(), that.begin(), that.end());
+		}
+	};
+
 	//
 	// Graph Structure
 	//
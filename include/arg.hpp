@@ -39,7 +39,7 @@ namespace env::opt
 		view text; // descriptive text for user help menu
 	};
 
-	view::vector put(int argc, char** argv, command::span);
+	view::small put(int argc, char** argv, command::span);
 	// Put command line arguments into options
 	fmt::string::out::ref put(fmt::string::out::ref);
 	// Write options to output string
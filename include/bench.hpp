@@ -0,0 +1,159 @@
+#ifndef bench_hpp
+#define bench_hpp "Micro Benchmarks"
+
+#include "sym.hpp"
+#include "ptr.hpp"
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace sys::bench
+{
+	template <class Type> inline void keep(Type const& value)
+	// Value is observed so the computation cannot be dropped
+	{
+		#if defined(__GNUC__) || defined(__clang__)
+		asm volatile ("" : : "r,m" (value) : "memory");
+		#else
+		auto const ptr = reinterpret_cast<char const volatile*>(&value);
+		(void) *ptr;
+		_ReadWriteBarrier();
+		#endif
+	}
+
+	template <class Type> inline void keep(Type& value)
+	// Value is observed and may be changed behind the compiler's back
+	{
+		#if defined(__GNUC__) || defined(__clang__)
+		#ifdef __clang__
+		asm volatile ("" : "+r,m" (value) : : "memory");
+		#else
+		asm volatile ("" : "+m,r" (value) : : "memory");
+		#endif
+		#else
+		auto const ptr = reinterpret_cast<char volatile*>(&value);
+		(void) *ptr;
+		_ReadWriteBarrier();
+		#endif
+	}
+
+	inline void clobber()
+	// All memory is observed by the time this returns
+	{
+		#if defined(__GNUC__) || defined(__clang__)
+		asm volatile ("" : : : "memory");
+		#else
+		_ReadWriteBarrier();
+		#endif
+	}
+
+	struct result
+	{
+		using vector = fwd::vector<result>;
+		using counter = std::pair<fmt::string, double>;
+
+		fmt::string name;  // suite and label
+		size_t iterations = 0; // operations per sample
+		size_t samples = 0;    // timed samples taken
+		double median = 0;     // nanoseconds per operation
+		double p99 = 0;        // nanoseconds per operation
+		double mean = 0;       // nanoseconds per operation
+		double bytes = 0;      // bytes per operation (or zero)
+		double rate = 0;       // bytes (or operations) per second
+		fwd::vector<counter> counters; // hardware events per operation
+	};
+
+	struct options
+	{
+		double warmup = 0.05;   // seconds spent before calibration
+		double target = 0.01;   // seconds for each timed sample
+		size_t samples = 31;    // timed samples per benchmark
+		bool counters = false;  // attach hardware counters
+	};
+
+	options& settings();
+	// Adjustable options for all suites
+
+	size_t allocations();
+	// Calls to the global operator new made on this thread so far, or zero when nothing counts them
+
+	void allocations(size_t (*)());
+	// Counter installed by a program which replaces the global operator new, as the test runner does
+
+	struct suite : fwd::unique
+	{
+		using body = std::function<void(size_t)>;
+		// Perform the operation under test the given number of times
+		using task = std::function<void(size_t, size_t)>;
+		// Perform the operation a number of times on the given thread
+
+		fmt::string::view name;
+		result::vector results;
+
+		suite(fmt::string::view id) : name(id)
+		{ }
+
+		result const& operator()(fmt::string::view label, size_t bytes, body);
+		// Calibrate then measure work, counting bytes per operation
+
+		result const& operator()(fmt::string::view label, body work)
+		{
+			return (*this)(label, 0, work);
+		}
+
+		result const& parallel(fmt::string::view label, size_t threads, size_t bytes, task);
+		// Measure work shared by threads, all released at once
+	};
+
+	struct random
+	// Deterministic generator so that data is the same on every run
+	{
+		unsigned long long state;
+
+		random(unsigned long long seed = 1) : state(seed)
+		{ }
+
+		unsigned long long operator()()
+		{
+			auto z = state += 0x9E3779B97F4A7C15ull;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		size_t operator()(size_t limit)
+		{
+			return 0 < limit ? (*this)() % limit : 0;
+		}
+	};
+
+	fmt::string ascii(size_t bytes, unsigned long long seed = 1);
+	// Words of printable ASCII separated by spaces, tabs and new lines
+
+	fmt::string utf8(size_t bytes, unsigned long long seed = 1);
+	// Words mixing sequences of one to four bytes with ASCII spaces
+
+	fmt::string worst(size_t bytes, fmt::string::view pattern);
+	// Pattern repeated, as in long runs of delimiters or nested braces
+
+	fmt::string::vector words(size_t count, unsigned long long seed = 1);
+	// Distinct short tokens like identifiers or keys
+
+	fmt::string label(fmt::string::view op, size_t n);
+	// Name of a case run for each of a range of sizes or counts, as op/n
+
+	bool compare(result const&, double baseline, double threshold);
+	// Whether a result regressed by more than threshold percent
+
+	fmt::string::out::ref operator<<(fmt::string::out::ref, result const&);
+	// Write a result as one line of tab separated fields
+}
+
+// Supply the signature for a benchmark callback
+#define bench_unit(name) dynamic void bench_##name(sys::bench::suite& bench)
+
+#endif // file
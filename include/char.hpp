@@ -2,6 +2,8 @@
 #define char_hpp "Universal Character Set"
 
 #include <iomanip>
+#include <charconv>
+#include <initializer_list>
 #include "it.hpp"
 #include "fmt.hpp"
 
@@ -555,13 +557,88 @@ namespace fmt
 
 	namespace io
 	{
+		constexpr std::size_t width(int n)
+		// Decimal digits of a parameter
+		{
+			std::size_t w = 0;
+			do ++w; while (n /= 10);
+			return w;
+		}
+
+		template <std::size_t Size> struct literal
+		// Escape sequence spelled out at compile time
+		{
+			char data[Size + 1] { };
+			std::size_t size = 0;
+
+			constexpr literal& operator+=(char c)
+			{
+				data[size++] = c;
+				return *this;
+			}
+
+			constexpr literal& operator+=(int n)
+			{
+				auto const w = width(n);
+				for (auto i = w; 0 < i; n /= 10)
+				{
+					data[size + --i] = static_cast<char>('0' + n % 10);
+				}
+				size += w;
+				return *this;
+			}
+		};
+
+		template <int... Params> constexpr std::size_t count = (0 + ... + (1 + width(Params)));
+		// Length of the parameters with their separators, plus one
+
+		template <char... Code> constexpr auto encoded = []
+		{
+			literal<sizeof...(Code)> s;
+			((s += Code), ...);
+			return s;
+		}();
+
+		template <int... Params> constexpr auto joined = []
+		{
+			literal<count<Params...>> s;
+			[[maybe_unused]] auto const add = [&s](int n)
+			{
+				if (0 < s.size) s += ';';
+				s += n;
+			};
+			(add(Params), ...);
+			return s;
+		}();
+
+		template <char Code, char Escape, int... Params> constexpr auto escaped = []
+		{
+			literal<3 + count<Params...>> s;
+			s += C0::ESC;
+			s += Code;
+			[[maybe_unused]] auto const add = [&s](int n)
+			{
+				if (2 < s.size) s += ';';
+				s += n;
+			};
+			(add(Params), ...);
+			s += Escape;
+			return s;
+		}();
+
+		template <std::size_t Size> string::out::ref write(string::out::ref out, literal<Size> const& s)
+		// Whole sequence in one call to the stream
+		{
+			return out.write(s.data, static_cast<std::streamsize>(s.size));
+		}
+
 		template 
 		<
 			char... Code
 		>
 		string::out::ref enc(string::out::ref out)
 		{
-			return (out << ... << Code);
+			return write(out, encoded<Code...>);
 		}
 
 		template
@@ -570,15 +647,7 @@ namespace fmt
 		>
 		string::out::ref par(string::out::ref out)
 		{
-			out << Param;
-			if constexpr (0 < sizeof...(Params))
-			{
-				return ((out << ';' << Params), ...);
-			}
-			else
-			{
-				return out;
-			}
+			return write(out, joined<Param, Params...>);
 		}
 
 		template
@@ -587,11 +656,7 @@ namespace fmt
 		>
 		string::out::ref esc(string::out::ref out)
 		{
-			auto begin = enc<C0::ESC, Code>;
-			auto next = par<Params...>;
-			auto end = enc<Escape>;
-
-			return out << begin << next << end;
+			return write(out, escaped<Code, Escape, Params...>);
 		}
 
 		template
@@ -600,7 +665,7 @@ namespace fmt
 		>
 		string::out::ref ctl(string::out::ref out)
 		{
-			return out << esc<G0::CSI, Escape, Params...>;
+			return write(out, escaped<G0::CSI, Escape, Params...>);
 		}
 
 		template 
@@ -609,7 +674,50 @@ namespace fmt
 		>
 		string::out::ref set(string::out::ref out)
 		{
-			return out << ctl<CSI::SGR, Params...>;
+			return write(out, escaped<G0::CSI, CSI::SGR, Params...>);
+		}
+
+		class control
+		// Sequence with parameters known only at run time
+		{
+			char buf[96];
+			std::size_t size = 0;
+
+		public:
+
+			control(char escape, std::initializer_list<int> params)
+			{
+				buf[size++] = C0::ESC;
+				buf[size++] = G0::CSI;
+				// Leave room for the final code when parameters overflow
+				auto const end = buf + sizeof buf - 1;
+				for (auto const n : params)
+				{
+					auto const at = buf + size + (2 < size);
+					if (end <= at) break;
+					auto const res = std::to_chars(at, end, n);
+					if (std::errc { } != res.ec) break;
+					if (2 < size) buf[size] = ';';
+					size = res.ptr - buf;
+				}
+				buf[size++] = escape;
+			}
+
+			fmt::string::view str() const
+			{
+				return string::view(buf, size);
+			}
+
+			friend string::out::ref operator<<(string::out::ref out, control const& c)
+			{
+				return out.write(c.buf, static_cast<std::streamsize>(c.size));
+			}
+		};
+
+		inline control rendition(std::initializer_list<int> params)
+		// Graphic rendition such as a palette colour
+		{
+			return control(CSI::SGR, params);
 		}
 
 		constexpr auto reset = set<SGR::reset>;
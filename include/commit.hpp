@@ -0,0 +1,84 @@
+#ifndef commit_hpp
+#define commit_hpp "Group Commit"
+
+#include "pipe.hpp"
+#include "err.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace env::file
+{
+	class committer : fwd::unique
+	// Writes to many descriptors made durable by one thread, so that writers who wait together share a flush
+	{
+	public:
+
+		using ticket = std::uint64_t;
+		using clock = std::chrono::steady_clock;
+
+		struct options
+		{
+			clock::duration delay { };  // longest wait for more writers before a flush
+			size_t batch = 64;          // flush without delay once this many are waiting
+			bool data = true;           // only what is needed to read the data back, not times
+			bool early = false;         // start writing back each range as soon as it is marked
+		};
+
+		committer();
+		explicit committer(options);
+		~committer();
+		// Flushes what is still marked
+
+		ticket mark(descriptor const&);
+		// Ask for everything written so far to the descriptor to become durable
+
+		bool wait(ticket);
+		// Until the flush which covers the ticket, failure if its descriptor could not be flushed,
+		// which is told to the first wait alone
+
+		bool commit(descriptor const& file)
+		// Mark and wait
+		{
+			return wait(mark(file));
+		}
+
+		bool append(descriptor const& file, void const* buf, size_t sz)
+		// Write all of the buffer and commit it
+		{
+			auto const ptr = static_cast<char const*>(buf);
+			for (size_t at = 0; at < sz; )
+			{
+				auto const n = file.write(ptr + at, sz - at);
+				if (n <= 0)
+				{
+					return failure;
+				}
+				at += static_cast<size_t>(n);
+			}
+			return commit(file);
+		}
+
+		size_t flushes() const;
+		// Number of batches flushed so far
+
+	private:
+
+		options const opt;
+		mutable std::mutex lock;
+		std::condition_variable work, done;
+		fwd::vector<std::pair<int, ticket>> dirty; // descriptors marked since the last flush
+		fwd::vector<ticket> failed; // tickets on descriptors which failed and nobody has waited on
+		ticket issued = 0, durable = 0;
+		size_t batches = 0;
+		bool stop = false;
+		std::thread thread;
+
+		void run();
+		bool flush(int fd) const;
+	};
+}
+
+#endif // file
@@ -0,0 +1,236 @@
+#ifndef csv_hpp
+#define csv_hpp "Delimited Tables"
+
+#include "fmt.hpp"
+#include "algo.hpp"
+#include "shm.hpp"
+#include "err.hpp"
+#include <charconv>
+#include <functional>
+#include <variant>
+
+namespace doc::csv
+{
+	using view = fmt::string::view;
+
+	struct format
+	{
+		char sep = ',';     // between fields
+		char quote = '"';   // around fields, or none
+		bool header = true; // first record names the columns
+	};
+
+	constexpr format tsv { '\t', '\0', true };
+
+	struct report
+	{
+		std::size_t rows = 0;    // records loaded
+		std::size_t skipped = 0; // records with an error
+		std::size_t record = 0;  // number of the first bad record from one
+		std::size_t offset = 0;  // byte position of the first bad record
+		view what;               // description of the first error
+
+		bool fail() const
+		{
+			return 0 < skipped;
+		}
+
+		void fault(std::size_t at, std::size_t count, view why)
+		// Count a bad record, keeping the first
+		{
+			if (0 == skipped++)
+			{
+				offset = at;
+				record = count;
+				what = why;
+			}
+		}
+	};
+
+	struct field
+	{
+		view text;           // without the outer quotes
+		bool quoted = false; // was inside quotes
+		bool doubled = false; // has escaped quotes still in it
+	};
+
+	class records
+	// Fields of each record in one chunk
+	{
+		view data;
+		format form;
+		std::size_t pos = 0;
+
+	public:
+
+		std::size_t count = 0; // records read so far
+		std::size_t start = 0; // where the last record began
+		view problem;          // what was wrong with the last record
+
+		records(view chunk, format f) : data(chunk), form(f)
+		{ }
+
+		bool next(fwd::vector<field>&);
+		// Split the next record, false at the end of the chunk
+
+		std::size_t tell() const
+		// Where the next record begins
+		{
+			return pos;
+		}
+	};
+
+	fmt::string unquote(field const&, char quote = '"');
+	// Text of a field with escaped quotes made single
+
+	template <class Type> bool convert(field const& f, Type& out, char quote = '"')
+	// Typed value of one field, failing unless all of it is used
+	{
+		if constexpr (std::is_same_v<Type, fmt::string>)
+		{
+			out = f.doubled ? unquote(f, quote) : fmt::to_string(f.text);
+			return success;
+		}
+		else
+		if constexpr (std::is_same_v<Type, view>)
+		{
+			out = f.text;
+			return f.doubled ? failure : success;
+		}
+		else
+		{
+			static_assert(std::is_arithmetic_v<Type> and not std::is_same_v<Type, bool>);
+			auto const begin = f.text.data();
+			auto const end = begin + f.text.size();
+			auto const res = std::from_chars(begin, end, out);
+			return std::errc { } != res.ec or end != res.ptr ? failure : success;
+		}
+	}
+
+	fwd::vector<view> split(view data, format, std::size_t parts);
+	// Chunks ending on record boundaries, found with the quote parity of each
+
+	view body(view data, format, fwd::vector<field>* names = nullptr);
+	// Records after the header, if the format has one
+
+	void run(std::size_t count, std::function<void(std::size_t)> const&);
+	// Call once for each index, spread over threads
+
+	report merge(fwd::span<report const>, std::size_t first = 1);
+	// Totals of every chunk in order, numbering records from first
+
+	std::size_t threads(std::size_t wanted = 0);
+	// Number of chunks to use, all cores by default
+
+	template <class... Columns> report load(view data, fwd::matrix<Columns...>& out, format form = { }, std::size_t count = 0)
+	// Append every record, parsed on all cores, to the typed columns
+	{
+		auto const text = body(data, form);
+		auto const parts = split(text, form, threads(count));
+		fwd::vector<fwd::matrix<Columns...>> tables(parts.size());
+		fwd::vector<report> reports(parts.size());
+
+		run(parts.size(), [&](std::size_t i)
+		{
+			records in(parts[i], form);
+			fwd::vector<field> fields;
+			std::tuple<Columns...> row;
+			auto const base = static_cast<std::size_t>(parts[i].data() - data.data());
+			while (in.next(fields))
+			{
+				auto const ok = [&]<std::size_t... N>(std::index_sequence<N...>)
+				{
+					return (... and not convert(fields[N], std::get<N>(row), form.quote));
+				};
+
+				if (not in.problem.empty())
+				{
+					reports[i].fault(base + in.start, in.count, in.problem);
+				}
+				else
+				if (sizeof...(Columns) != fields.size())
+				{
+					reports[i].fault(base + in.start, in.count, "wrong number of fields");
+				}
+				else
+				if (not ok(std::index_sequence_for<Columns...>()))
+				{
+					reports[i].fault(base + in.start, in.count, "field does not convert");
+				}
+				else
+				{
+					std::apply([&](auto&... value) { tables[i].emplace_back(std::move(value)...); }, row);
+				}
+			}
+			reports[i].rows = tables[i].size();
+		});
+
+		// Concatenate the chunks in order, copying each on its own thread
+		std::size_t total = out.size();
+		fwd::vector<std::size_t> at;
+		for (auto const& t : tables)
+		{
+			at.push_back(total);
+			total += t.size();
+		}
+		out.resize(total);
+		run(tables.size(), [&](std::size_t i)
+		{
+			for (std::size_t row = 0; row < tables[i].size(); ++row)
+			{
+				auto to = out.at(at[i] + row);
+				auto from = tables[i].at(row);
+				[&]<std::size_t... N>(std::index_sequence<N...>)
+				{
+					((std::get<N>(to) = std::move(std::get<N>(from))), ...);
+				}
+				(std::index_sequence_for<Columns...>());
+			}
+		});
+
+		return merge(reports, form.header ? 2 : 1);
+	}
+
+	class table
+	// Columns whose types are chosen at run time
+	{
+	public:
+
+		enum kind : char
+		{
+			text, integer, real,
+		};
+
+		using column = std::variant<fwd::vector<fmt::string>, fwd::vector<long long>, fwd::vector<double>>;
+
+		fwd::vector<fmt::string> names;
+		fwd::vector<column> columns;
+
+		explicit table(fwd::span<kind const> kinds = { });
+		// Empty columns of each kind, or text columns counted from the data
+
+		std::size_t size() const;
+		// Number of rows
+	};
+
+	report load(view data, table& out, format = { }, std::size_t count = 0);
+	// Append every record, parsed on all cores, to the columns
+
+	class file : fwd::unique
+	// Whole file mapped for reading
+	{
+		env::file::map_ptr map;
+		std::size_t size = 0;
+
+	public:
+
+		explicit file(view path);
+
+		view data() const
+		{
+			return view(static_cast<char const*>(map.get()), size);
+		}
+	};
+}
+
+#endif // file
@@ -8,14 +8,14 @@
 
 namespace fmt::path
 {
-	string::view::vector split(string::view);
+	string::view::small split(string::view);
 	string join(string::view::span);
 	string join(string::view::init);
 }
 
 namespace fmt::dir
 {
-	string::view::vector split(string::view);
+	string::view::small split(string::view);
 	string join(string::view::span);
 	string join(string::view::init);
 }
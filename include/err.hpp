@@ -80,4 +80,8 @@ namespace sys
 #	include "test.hpp"
 #endif
 
+// Benchmarks
+
+#include "bench.hpp"
+
 #endif // file
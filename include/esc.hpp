@@ -0,0 +1,88 @@
+#ifndef esc_hpp
+#define esc_hpp "Escape Sequence Parser"
+
+#include "fmt.hpp"
+#include "ptr.hpp"
+
+namespace fmt::esc
+{
+	struct token
+	// Text or one control function decoded from a stream
+	{
+		enum kind : char
+		{
+			text,    // run of characters including C0 format effectors
+			control, // single C1 control or its ESC Fe form
+			escape,  // ESC with intermediates and a final
+			csi,     // control sequence
+			dcs,     // device control string
+			osc,     // operating system command
+			sos,     // start of string
+			pm,      // privacy message
+			apc,     // application program command
+		};
+
+		kind type = text;
+		char final = 0; // code of a control, escape, csi or dcs
+		view params;    // parameter bytes of a csi or dcs
+		view inter;     // intermediate bytes of an escape, csi or dcs
+		view data;      // text or the body of a string
+
+		int param(std::size_t index, int otherwise = 0) const;
+		// Numeric parameter at an index, or otherwise when empty or missing
+	};
+
+	class parser : fwd::unique
+	// Incremental state machine which keeps partial sequences between chunks
+	{
+		enum state : char
+		{
+			ground, held, escape, escape_inter, param, inter, ignore, str, str_esc, str_held
+		};
+
+		view chunk;
+		std::size_t pos = 0;
+		string seq; // sequence bytes after the introducer
+		std::size_t mark = 0, body = 0; // where intermediates and string data start
+		token::kind kind = token::text;
+		state now = ground;
+		char code = 0; // final of the sequence
+		bool utf8, discard = false;
+
+		bool introduce(char fe, token&);
+		// Start the sequence of an ESC Fe or C1 control
+
+		bool sequence(char, token&);
+		// Step through a control sequence or escape
+
+		bool text(char, token&);
+		// Step through a control string body
+
+		bool emit(token&, token::kind);
+		// Fill a token for the sequence which just ended
+
+	public:
+
+		static constexpr std::size_t limit = 1 << 16;
+		// Longest string body kept, beyond which the rest is dropped
+
+		explicit parser(bool utf8 = true) : utf8(utf8)
+		// UTF-8 streams carry C1 as two bytes, otherwise they are 0x80 to 0x9F
+		{ }
+
+		void feed(view);
+		// Next chunk, which must outlive the tokens taken from it
+
+		bool next(token&);
+		// Next token in the chunk, valid until the following call, or
+		// false when the chunk is spent
+
+		void strip(view, string& out);
+		// Append the text of a chunk without the control functions
+	};
+
+	string strip(view);
+	// Text of a whole buffer without the control functions
+}
+
+#endif // file
@@ -0,0 +1,914 @@
+#ifndef flat_hpp
+#define flat_hpp "Flat Containers"
+
+#include "fwd.hpp"
+#include "hash.hpp"
+#include <functional>
+#include <string_view>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace fwd
+{
+	template <class Type> struct hash
+	// Standard hash, except that anything like a string is hashed as a view with the seed of the process
+	{
+		std::size_t operator()(Type const& value) const
+		{
+			if constexpr (std::is_convertible_v<Type const&, std::string_view>)
+			{
+				return static_cast<std::size_t>(fmt::hash(std::string_view(value), fmt::seed()));
+			}
+			else
+			{
+				return std::hash<Type>()(value);
+			}
+		}
+	};
+
+	template <class First, class Second> struct hash<std::pair<First, Second>>
+	// Pairs of text or integers, which the standard cannot hash
+	{
+		std::size_t operator()(std::pair<First, Second> const& value) const
+		{
+			return static_cast<std::size_t>(fmt::hash(value, fmt::seed()));
+		}
+	};
+
+	template <class Iterator, class Key, class Less, class Project>
+	Iterator lower_bound(Iterator begin, Iterator end, Key const& key, Less const& less, Project const& project)
+	// First element not before key, halving with a conditional move rather than a branch
+	{
+		auto n = std::distance(begin, end);
+		if (0 == n)
+		{
+			return begin;
+		}
+		auto base = begin;
+		while (1 < n)
+		{
+			auto const half = n / 2;
+			base = less(project(base[half]), key) ? base + half : base;
+			n -= half;
+		}
+		return base + less(project(*base), key);
+	}
+
+	//
+	// Sorted Vectors
+	//
+
+	template
+	<
+		class Type
+		,
+		template <class> class Order = order
+		,
+		template <class> class Alloc = allocator
+	>
+	class flat_set
+	// Sorted unique values in one block, quick to search and walk but slow to change
+	{
+		using container = std::vector<Type, Alloc<Type>>;
+
+		container data;
+		[[no_unique_address]] Order<Type> less;
+
+		static Type const& self(Type const& value)
+		{
+			return value;
+		}
+
+		bool same(Type const& a, Type const& b) const
+		{
+			return not less(a, b) and not less(b, a);
+		}
+
+		void adopt(std::size_t sorted)
+		// Sort what was appended after the sorted part, merge, and drop repeats
+		{
+			auto const mid = data.begin() + static_cast<std::ptrdiff_t>(sorted);
+			std::stable_sort(mid, data.end(), less);
+			std::inplace_merge(data.begin(), mid, data.end(), less);
+			auto const end = std::unique(data.begin(), data.end(), [this](auto const& a, auto const& b)
+			{
+				return same(a, b);
+			});
+			data.erase(end, data.end());
+		}
+
+	public:
+
+		using key_type = Type;
+		using value_type = Type;
+		using size_type = std::size_t;
+		using key_compare = Order<Type>;
+		using allocator_type = Alloc<Type>;
+		using iterator = typename container::const_iterator;
+		using const_iterator = typename container::const_iterator;
+
+		flat_set() = default;
+
+		template <std::input_iterator Iterator> flat_set(Iterator begin, Iterator end) : data(begin, end)
+		{
+			adopt(0);
+		}
+
+		flat_set(init<Type> list) : flat_set(list.begin(), list.end())
+		{ }
+
+		iterator begin() const { return data.begin(); }
+		iterator end() const { return data.end(); }
+		std::size_t size() const { return data.size(); }
+		bool empty() const { return data.empty(); }
+		void clear() { data.clear(); }
+		void reserve(std::size_t n) { data.reserve(n); }
+		void shrink_to_fit() { data.shrink_to_fit(); }
+
+		iterator lower_bound(Type const& key) const
+		{
+			return fwd::lower_bound(data.begin(), data.end(), key, less, self);
+		}
+
+		iterator upper_bound(Type const& key) const
+		{
+			auto const it = lower_bound(key);
+			return end() != it and not less(key, *it) ? std::next(it) : it;
+		}
+
+		std::pair<iterator, iterator> equal_range(Type const& key) const
+		{
+			return { lower_bound(key), upper_bound(key) };
+		}
+
+		iterator find(Type const& key) const
+		{
+			auto const it = lower_bound(key);
+			return end() != it and not less(key, *it) ? it : end();
+		}
+
+		bool contains(Type const& key) const
+		{
+			return end() != find(key);
+		}
+
+		std::size_t count(Type const& key) const
+		{
+			return contains(key) ? 1 : 0;
+		}
+
+		template <class... Args> std::pair<iterator, bool> emplace(Args&&... args)
+		{
+			return insert(Type(std::forward<Args>(args)...));
+		}
+
+		std::pair<iterator, bool> insert(Type const& value)
+		{
+			return insert(Type(value));
+		}
+
+		std::pair<iterator, bool> insert(Type&& value)
+		{
+			auto const it = lower_bound(value);
+			if (end() != it and not less(value, *it))
+			{
+				return { it, false };
+			}
+			return { data.insert(it, std::move(value)), true };
+		}
+
+		template <std::input_iterator Iterator> void insert(Iterator begin, Iterator end)
+		// Many values at once, sorted together rather than one by one
+		{
+			auto const sorted = data.size();
+			data.insert(data.end(), begin, end);
+			adopt(sorted);
+		}
+
+		iterator erase(const_iterator it)
+		{
+			return data.erase(it);
+		}
+
+		std::size_t erase(Type const& key)
+		{
+			auto const it = find(key);
+			if (end() == it)
+			{
+				return 0;
+			}
+			(void) data.erase(it);
+			return 1;
+		}
+
+		bool operator==(flat_set const& that) const
+		{
+			return data == that.data;
+		}
+	};
+
+	template
+	<
+		class Key
+		,
+		class Value
+		,
+		template <class> class Order = order
+		,
+		template <class> class Alloc = allocator
+	>
+	class flat_map
+	// Pairs sorted by unique keys in one block, quick to search and walk but slow to change
+	{
+	public:
+
+		using key_type = Key;
+		using mapped_type = Value;
+		using value_type = std::pair<Key, Value>;
+		using size_type = std::size_t;
+		using key_compare = Order<Key>;
+		using allocator_type = Alloc<value_type>;
+
+	private:
+
+		using container = std::vector<value_type, allocator_type>;
+
+		container data;
+		[[no_unique_address]] Order<Key> less;
+
+		static Key const& first(value_type const& pair)
+		{
+			return pair.first;
+		}
+
+		void adopt(std::size_t sorted)
+		// Sort what was appended, merge, and keep the first of each key
+		{
+			auto const before = [this](auto const& a, auto const& b)
+			{
+				return less(a.first, b.first);
+			};
+			auto const mid = data.begin() + static_cast<std::ptrdiff_t>(sorted);
+			std::stable_sort(mid, data.end(), before);
+			std::inplace_merge(data.begin(), mid, data.end(), before);
+			auto const end = std::unique(data.begin(), data.end(), [this](auto const& a, auto const& b)
+			{
+				return not less(a.first, b.first) and not less(b.first, a.first);
+			});
+			data.erase(end, data.end());
+		}
+
+	public:
+
+		using iterator = typename container::iterator;
+		using const_iterator = typename container::const_iterator;
+
+		flat_map() = default;
+
+		template <std::input_iterator Iterator> flat_map(Iterator begin, Iterator end) : data(begin, end)
+		{
+			adopt(0);
+		}
+
+		flat_map(init<value_type> list) : flat_map(list.begin(), list.end())
+		{ }
+
+		iterator begin() { return data.begin(); }
+		iterator end() { return data.end(); }
+		const_iterator begin() const { return data.begin(); }
+		const_iterator end() const { return data.end(); }
+		std::size_t size() const { return data.size(); }
+		bool empty() const { return data.empty(); }
+		void clear() { data.clear(); }
+		void reserve(std::size_t n) { data.reserve(n); }
+		void shrink_to_fit() { data.shrink_to_fit(); }
+
+		iterator lower_bound(Key const& key)
+		{
+			return fwd::lower_bound(data.begin(), data.end(), key, less, first);
+		}
+
+		const_iterator lower_bound(Key const& key) const
+		{
+			return fwd::lower_bound(data.begin(), data.end(), key, less, first);
+		}
+
+		iterator find(Key const& key)
+		{
+			auto const it = lower_bound(key);
+			return end() != it and not less(key, it->first) ? it : end();
+		}
+
+		const_iterator find(Key const& key) const
+		{
+			auto const it = lower_bound(key);
+			return end() != it and not less(key, it->first) ? it : end();
+		}
+
+		iterator upper_bound(Key const& key)
+		{
+			auto const it = find(key);
+			return end() != it ? std::next(it) : lower_bound(key);
+		}
+
+		const_iterator upper_bound(Key const& key) const
+		{
+			auto const it = find(key);
+			return end() != it ? std::next(it) : lower_bound(key);
+		}
+
+		std::pair<iterator, iterator> equal_range(Key const& key)
+		{
+			return { lower_bound(key), upper_bound(key) };
+		}
+
+		std::pair<const_iterator, const_iterator> equal_range(Key const& key) const
+		{
+			return { lower_bound(key), upper_bound(key) };
+		}
+
+		bool contains(Key const& key) const
+		{
+			return end() != find(key);
+		}
+
+		std::size_t count(Key const& key) const
+		{
+			return contains(key) ? 1 : 0;
+		}
+
+		Value& at(Key const& key)
+		{
+			auto const it = find(key);
+			if (end() == it) throw std::out_of_range("flat_map::at");
+			return it->second;
+		}
+
+		Value const& at(Key const& key) const
+		{
+			auto const it = find(key);
+			if (end() == it) throw std::out_of_range("flat_map::at");
+			return it->second;
+		}
+
+		template <class... Args> std::pair<iterator, bool> try_emplace(Key const& key, Args&&... args)
+		{
+			auto const it = lower_bound(key);
+			if (end() != it and not less(key, it->first))
+			{
+				return { it, false };
+			}
+			auto const at = data.emplace(it, std::piecewise_construct,
+				std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+			return { at, true };
+		}
+
+		template <class... Args> std::pair<iterator, bool> emplace(Key const& key, Args&&... args)
+		{
+			return try_emplace(key, std::forward<Args>(args)...);
+		}
+
+		std::pair<iterator, bool> insert(value_type const& pair)
+		{
+			return try_emplace(pair.first, pair.second);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& pair)
+		{
+			return try_emplace(pair.first, std::move(pair.second));
+		}
+
+		template <std::input_iterator Iterator> void insert(Iterator begin, Iterator end)
+		// Many pairs at once, sorted together rather than one by one
+		{
+			auto const sorted = data.size();
+			data.insert(data.end(), begin, end);
+			adopt(sorted);
+		}
+
+		template <class Other> std::pair<iterator, bool> insert_or_assign(Key const& key, Other&& value)
+		{
+			auto const p = try_emplace(key, std::forward<Other>(value));
+			if (not p.second)
+			{
+				p.first->second = std::forward<Other>(value);
+			}
+			return p;
+		}
+
+		Value& operator[](Key const& key)
+		{
+			return try_emplace(key).first->second;
+		}
+
+		iterator erase(const_iterator it)
+		{
+			return data.erase(it);
+		}
+
+		std::size_t erase(Key const& key)
+		{
+			auto const it = find(key);
+			if (end() == it)
+			{
+				return 0;
+			}
+			(void) data.erase(it);
+			return 1;
+		}
+
+		bool operator==(flat_map const& that) const
+		{
+			return data == that.data;
+		}
+	};
+
+	//
+	// Hash Table
+	//
+
+	template
+	<
+		class Key
+		,
+		class Value
+		,
+		template <class> class Hash = hash
+		,
+		template <class> class Identity = identity
+		,
+		template <class> class Alloc = allocator
+	>
+	class hash_map
+	// Open addressing with a byte of control for each slot, probed sixteen at a time
+	{
+	public:
+
+		using key_type = Key;
+		using mapped_type = Value;
+		using value_type = std::pair<Key, Value>;
+		using size_type = std::size_t;
+		using hasher = Hash<Key>;
+		using key_equal = Identity<Key>;
+		using allocator_type = Alloc<value_type>;
+
+	private:
+
+		using control = signed char;
+		using traits = std::allocator_traits<allocator_type>;
+		using bytes = typename traits::template rebind_alloc<control>;
+
+		static constexpr control empty_slot = -128;
+		static constexpr control deleted = -2;
+		static constexpr std::size_t width = 16;
+
+		struct group
+		// Bit masks of the controls which match in a window of sixteen
+		{
+			#ifdef __SSE2__
+			__m128i ctrl;
+
+			explicit group(control const* pos)
+			: ctrl(_mm_loadu_si128(reinterpret_cast<__m128i const*>(pos)))
+			{ }
+
+			unsigned match(control h) const
+			{
+				return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h), ctrl)));
+			}
+
+			unsigned empty() const
+			{
+				return match(empty_slot);
+			}
+
+			unsigned free() const
+			// Empty or deleted, which are the only negative controls
+			{
+				return static_cast<unsigned>(_mm_movemask_epi8(ctrl));
+			}
+			#else
+			control ctrl[width];
+
+			explicit group(control const* pos)
+			{
+				std::memcpy(ctrl, pos, width);
+			}
+
+			unsigned match(control h) const
+			{
+				unsigned bits = 0;
+				for (std::size_t i = 0; i < width; ++i)
+				{
+					bits |= unsigned(h == ctrl[i]) << i;
+				}
+				return bits;
+			}
+
+			unsigned empty() const
+			{
+				return match(empty_slot);
+			}
+
+			unsigned free() const
+			{
+				unsigned bits = 0;
+				for (std::size_t i = 0; i < width; ++i)
+				{
+					bits |= unsigned(ctrl[i] < 0) << i;
+				}
+				return bits;
+			}
+			#endif
+		};
+
+		control* ctrl = nullptr;    // capacity bytes then a copy of the first sixteen
+		value_type* slots = nullptr;
+		std::size_t mask = 0;       // capacity less one, or zero when none
+		std::size_t used = 0;
+		std::size_t growth = 0;     // inserts left before the table is rebuilt
+		[[no_unique_address]] hasher hash;
+		[[no_unique_address]] key_equal same;
+		[[no_unique_address]] allocator_type alloc;
+
+		static std::size_t mix(std::size_t h)
+		// Spread the bits so that the low seven and the rest are both useful
+		{
+			auto const m = static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ull;
+			return static_cast<std::size_t>(m ^ (m >> 32));
+		}
+
+		static int lowest(unsigned bits)
+		{
+			#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_ctz(bits);
+			#else
+			int n = 0;
+			while (0 == (bits & 1)) bits >>= 1, ++n;
+			return n;
+			#endif
+		}
+
+		std::size_t capacity() const
+		{
+			return ctrl ? mask + 1 : 0;
+		}
+
+		void set(std::size_t i, control h)
+		// Keep the copy after the end so that windows can wrap around
+		{
+			ctrl[i] = h;
+			if (i < width)
+			{
+				ctrl[mask + 1 + i] = h;
+			}
+		}
+
+		std::size_t locate(Key const& key, std::size_t h) const
+		// Slot holding the key, or the capacity when missing
+		{
+			if (nullptr == ctrl)
+			{
+				return 0;
+			}
+			auto const h2 = static_cast<control>(h & 0x7F);
+			auto pos = (h >> 7) & mask;
+			for (std::size_t step = width;; step += width)
+			{
+				group const g(ctrl + pos);
+				for (auto bits = g.match(h2); bits; bits &= bits - 1)
+				{
+					auto const i = (pos + lowest(bits)) & mask;
+					if (same(slots[i].first, key))
+					{
+						return i;
+					}
+				}
+				if (g.empty())
+				{
+					return mask + 1;
+				}
+				pos = (pos + step) & mask;
+			}
+		}
+
+		std::size_t vacant(std::size_t h) const
+		// First empty or deleted slot on the probe sequence
+		{
+			auto pos = (h >> 7) & mask;
+			for (std::size_t step = width;; step += width)
+			{
+				group const g(ctrl + pos);
+				if (auto const bits = g.free())
+				{
+					return (pos + lowest(bits)) & mask;
+				}
+				pos = (pos + step) & mask;
+			}
+		}
+
+		void rebuild(std::size_t size)
+		// Move every pair into a table of a new capacity, dropping deleted marks
+		{
+			auto const old_ctrl = ctrl;
+			auto const old_slots = slots;
+			auto const old_size = capacity();
+
+			bytes b(alloc);
+			ctrl = std::allocator_traits<bytes>::allocate(b, size + width);
+			slots = traits::allocate(alloc, size);
+			std::memset(ctrl, empty_slot, size + width);
+			mask = size - 1;
+			growth = size - size / 8 - used;
+
+			for (std::size_t i = 0; i < old_size; ++i)
+			{
+				if (0 <= old_ctrl[i])
+				{
+					auto const h = mix(hash(old_slots[i].first));
+					auto const at = vacant(h);
+					set(at, static_cast<control>(h & 0x7F));
+					traits::construct(alloc, slots + at, std::move(old_slots[i]));
+					traits::destroy(alloc, old_slots + i);
+				}
+			}
+
+			if (old_ctrl)
+			{
+				std::allocator_traits<bytes>::deallocate(b, old_ctrl, old_size + width);
+				traits::deallocate(alloc, old_slots, old_size);
+			}
+		}
+
+		void release()
+		{
+			if (ctrl)
+			{
+				clear();
+				bytes b(alloc);
+				std::allocator_traits<bytes>::deallocate(b, ctrl, capacity() + width);
+				traits::deallocate(alloc, slots, capacity());
+				ctrl = nullptr;
+				slots = nullptr;
+				mask = growth = 0;
+			}
+		}
+
+		template <class Pointer, class Pair> class walker
+		// Step over the slots in use
+		{
+			friend class hash_map;
+			template <class, class> friend class walker;
+
+			control const* ctrl;
+			Pointer slot;
+			control const* stop;
+
+			void skip()
+			{
+				while (ctrl != stop and *ctrl < 0)
+				{
+					++ctrl, ++slot;
+				}
+			}
+
+		public:
+
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = typename hash_map::value_type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = Pair*;
+			using reference = Pair&;
+
+			walker() = default;
+
+			walker(control const* c, Pointer s, control const* e) : ctrl(c), slot(s), stop(e)
+			{
+				skip();
+			}
+
+			template <class Other, class Form> walker(walker<Other, Form> const& it)
+			: ctrl(it.ctrl), slot(it.slot), stop(it.stop)
+			{ }
+
+			reference operator*() const { return *slot; }
+			pointer operator->() const { return slot; }
+
+			walker& operator++()
+			{
+				++ctrl, ++slot;
+				skip();
+				return *this;
+			}
+
+			walker operator++(int)
+			{
+				auto const it = *this;
+				++*this;
+				return it;
+			}
+
+			bool operator==(walker const& it) const
+			{
+				return ctrl == it.ctrl;
+			}
+		};
+
+	public:
+
+		using iterator = walker<value_type*, value_type>;
+		using const_iterator = walker<value_type const*, value_type const>;
+
+		hash_map() = default;
+
+		hash_map(init<value_type> list)
+		{
+			reserve(list.size());
+			for (auto const& pair : list) (void) insert(pair);
+		}
+
+		hash_map(hash_map const& that) : hash(that.hash), same(that.same), alloc(that.alloc)
+		{
+			reserve(that.size());
+			for (auto const& pair : that) (void) insert(pair);
+		}
+
+		hash_map(hash_map&& that) noexcept
+		: ctrl(std::exchange(that.ctrl, nullptr))
+		, slots(std::exchange(that.slots, nullptr))
+		, mask(std::exchange(that.mask, 0))
+		, used(std::exchange(that.used, 0))
+		, growth(std::exchange(that.growth, 0))
+		, hash(that.hash), same(that.same), alloc(that.alloc)
+		{ }
+
+		~hash_map()
+		{
+			release();
+		}
+
+		hash_map& operator=(hash_map that)
+		{
+			std::swap(ctrl, that.ctrl);
+			std::swap(slots, that.slots);
+			std::swap(mask, that.mask);
+			std::swap(used, that.used);
+			std::swap(growth, that.growth);
+			return *this;
+		}
+
+		iterator begin() { return { ctrl, slots, ctrl + capacity() }; }
+		iterator end() { return { ctrl + capacity(), slots + capacity(), ctrl + capacity() }; }
+		const_iterator begin() const { return { ctrl, slots, ctrl + capacity() }; }
+		const_iterator end() const { return { ctrl + capacity(), slots + capacity(), ctrl + capacity() }; }
+
+		std::size_t size() const { return used; }
+		bool empty() const { return 0 == used; }
+
+		void clear()
+		{
+			for (std::size_t i = 0; i < capacity(); ++i)
+			{
+				if (0 <= ctrl[i])
+				{
+					traits::destroy(alloc, slots + i);
+				}
+			}
+			if (ctrl)
+			{
+				std::memset(ctrl, empty_slot, capacity() + width);
+				growth = capacity() - capacity() / 8;
+			}
+			used = 0;
+		}
+
+		void reserve(std::size_t n)
+		// Room for n pairs without rebuilding
+		{
+			std::size_t size = width;
+			while (size - size / 8 < n) size *= 2;
+			if (capacity() < size)
+			{
+				rebuild(size);
+			}
+		}
+
+		iterator find(Key const& key)
+		{
+			auto const i = locate(key, mix(hash(key)));
+			return i < capacity() ? iterator(ctrl + i, slots + i, ctrl + capacity()) : end();
+		}
+
+		const_iterator find(Key const& key) const
+		{
+			auto const i = locate(key, mix(hash(key)));
+			return i < capacity() ? const_iterator(ctrl + i, slots + i, ctrl + capacity()) : end();
+		}
+
+		bool contains(Key const& key) const
+		{
+			return locate(key, mix(hash(key))) < capacity();
+		}
+
+		std::size_t count(Key const& key) const
+		{
+			return contains(key) ? 1 : 0;
+		}
+
+		Value& at(Key const& key)
+		{
+			auto const it = find(key);
+			if (end() == it) throw std::out_of_range("hash_map::at");
+			return it->second;
+		}
+
+		Value const& at(Key const& key) const
+		{
+			auto const it = find(key);
+			if (end() == it) throw std::out_of_range("hash_map::at");
+			return it->second;
+		}
+
+		template <class... Args> std::pair<iterator, bool> try_emplace(Key const& key, Args&&... args)
+		{
+			auto const h = mix(hash(key));
+			if (auto const i = locate(key, h); i < capacity())
+			{
+				return { iterator(ctrl + i, slots + i, ctrl + capacity()), false };
+			}
+
+			// Rebuild when full, larger unless most of the marks are deleted
+			auto at = ctrl ? vacant(h) : 0;
+			if (nullptr == ctrl or (0 == growth and empty_slot == ctrl[at]))
+			{
+				auto const size = capacity();
+				rebuild(size < width ? width : used < size * 7 / 16 ? size : size * 2);
+				at = vacant(h);
+			}
+
+			traits::construct(alloc, slots + at, std::piecewise_construct,
+				std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+			growth -= empty_slot == ctrl[at];
+			set(at, static_cast<control>(h & 0x7F));
+			++used;
+			return { iterator(ctrl + at, slots + at, ctrl + capacity()), true };
+		}
+
+		template <class... Args> std::pair<iterator, bool> emplace(Key const& key, Args&&... args)
+		{
+			return try_emplace(key, std::forward<Args>(args)...);
+		}
+
+		std::pair<iterator, bool> insert(value_type const& pair)
+		{
+			return try_emplace(pair.first, pair.second);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& pair)
+		{
+			return try_emplace(pair.first, std::move(pair.second));
+		}
+
+		template <class Other> std::pair<iterator, bool> insert_or_assign(Key const& key, Other&& value)
+		{
+			auto const p = try_emplace(key, std::forward<Other>(value));
+			if (not p.second)
+			{
+				p.first->second = std::forward<Other>(value);
+			}
+			return p;
+		}
+
+		Value& operator[](Key const& key)
+		{
+			return try_emplace(key).first->second;
+		}
+
+		void erase(const_iterator it)
+		// Mark the slot deleted so that probes carry on past it
+		{
+			auto const i = static_cast<std::size_t>(it.ctrl - ctrl);
+			traits::destroy(alloc, slots + i);
+			set(i, deleted);
+			--used;
+		}
+
+		std::size_t erase(Key const& key)
+		{
+			auto const it = find(key);
+			if (end() == it)
+			{
+				return 0;
+			}
+			erase(const_iterator(it));
+			return 1;
+		}
+	};
+}
+
+#endif // file
@@ -48,6 +48,7 @@ namespace fmt
 		using map    = fwd::map<Type, Order, Alloc>;
 		using span   = fwd::span<Type>;
 		using vector = fwd::vector<Type, Alloc>;
+		using small  = fwd::small_vector<Type, 8, Alloc>;
 		using graph  = fwd::graph<Type, Alloc>;
 		using group  = fwd::group<Type, Alloc, Order>;
 		using edges  = fwd::edges<Type>;
@@ -106,7 +107,7 @@ namespace fmt
 		// base class composition
 		class Base = string_brief
 		<
-			fwd::basic_string<Char, Traits>, Char, Traits, Alloc, Order
+			fwd::basic_string<Char, Traits, Alloc>, Char, Traits, Alloc, Order
 		>
 	>
 	struct basic_string : Base
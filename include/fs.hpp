@@ -31,48 +31,63 @@ namespace fmt
 			using mode = env::file::mode;
 			inline auto width = env::file::width;
 
-			env::file::descriptor f;
+			using streambuf = fwd::basic_buf<Char, Traits>;
+			using char_type = typename streambuf::char_type;
+			using size_type = std::streamsize;
 
-		public:
+			env::file::descriptor f;
+			bool direct = false;
 
-			basic_fdstream(mode mask = Default, size_t size = width())
-			: base(f)
+			void buffer(mode mask, size_t size)
+			// Whole blocks on their boundaries when direct
 			{
+				size_t n = 0, m = 0;
 				if (mask & env::file::rw)
 				{
-					base::setbufsiz(size, size);
+					n = m = size;
 				}
 				else 
 				if (mask & env::file::wr)
 				{
-					base::setbufsiz(0, size);
+					m = size;
 				}
 				else 
 				if (mask & env::file::rd)
 				{
-					base::setbufsiz(size, 0);
+					n = size;
 				}
-			}
 
-			basic_fdstream(view path, mode mask = Default, size_t size = width())
-			: base(f), f(path, mode(mask | Default))
-			{
-				if (mask & env::file::rw)
-				{
-					base::setbufsiz(size, size);
-				}
-				else 
-				if (mask & env::file::wr)
+				direct = mask & env::file::dio;
+				if (direct)
 				{
-					base::setbufsiz(0, size);
+					auto const align = f.align();
+					auto const block = std::max<size_t>(1, align / sizeof (Char));
+					auto const round = [block](size_t k)
+					{
+						return (k + block - 1) / block * block;
+					};
+					base::setbufsiz(round(n), round(m), align);
 				}
-				else 
-				if (mask & env::file::rd)
+				else
 				{
-					base::setbufsiz(size, 0);
+					base::setbufsiz(n, m);
 				}
 			}
 
+		public:
+
+			basic_fdstream(mode mask = Default, size_t size = width())
+			: base(f)
+			{
+				buffer(mode(mask | Default), size);
+			}
+
+			basic_fdstream(view path, mode mask = Default, size_t size = width())
+			: base(f), f(path, mode(mask | Default))
+			{
+				buffer(mode(mask | Default), size);
+			}
+
 			bool open(view path, mode mask = Default)
 			{
 				return f.open(path, mode(mask | Default));
@@ -87,6 +102,33 @@ namespace fmt
 			{
 				return f.set(fd);
 			}
+
+			bool advise(env::file::advice how, size_t at = 0, size_t sz = 0) const
+			{
+				return f.advise(how, at, sz);
+			}
+
+		private:
+
+			// When direct, callers are copied through the aligned buffer, which alone meets the file
+
+			size_type xsputn(char_type const *s, size_type n) override
+			{
+				if (direct and s != this->pbase())
+				{
+					return streambuf::xsputn(s, n);
+				}
+				return f.write(s, fmt::to_size(n));
+			}
+
+			size_type xsgetn(char_type *s, size_type n) override
+			{
+				if (direct and s != this->eback())
+				{
+					return streambuf::xsgetn(s, n);
+				}
+				return f.read(s, fmt::to_size(n));
+			}
 		};
 	}
 
@@ -0,0 +1,182 @@
+#ifndef hash_hpp
+#define hash_hpp "Hash Functions"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace fmt
+{
+	namespace impl
+	{
+		constexpr std::uint64_t secret[]
+		{
+			0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+		};
+
+		constexpr void mum(std::uint64_t& a, std::uint64_t& b)
+		// Full product of two words, low half in a and high half in b
+		{
+			#ifdef __SIZEOF_INT128__
+			{
+				__extension__ using wide = unsigned __int128;
+				auto const r = static_cast<wide>(a) * b;
+				a = static_cast<std::uint64_t>(r);
+				b = static_cast<std::uint64_t>(r >> 64);
+			}
+			#else
+			{
+				auto const ha = a >> 32, la = a & 0xffffffff;
+				auto const hb = b >> 32, lb = b & 0xffffffff;
+				auto const hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+				auto const t = ll + (hl << 32);
+				auto const lo = t + (lh << 32);
+				auto const carry = static_cast<std::uint64_t>(t < ll) + static_cast<std::uint64_t>(lo < t);
+				a = lo;
+				b = hh + (hl >> 32) + (lh >> 32) + carry;
+			}
+			#endif
+		}
+
+		template <std::size_t Size> constexpr std::uint64_t read(char const* p)
+		// Little endian word of the next bytes, loaded whole at run time
+		{
+			if (not std::is_constant_evaluated() and std::endian::little == std::endian::native)
+			{
+				std::conditional_t<8 == Size, std::uint64_t, std::uint32_t> word;
+				static_assert(sizeof word == Size);
+				std::memcpy(&word, p, Size);
+				return word;
+			}
+			std::uint64_t word = 0;
+			for (std::size_t i = 0; i < Size; ++i)
+			{
+				word |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+			}
+			return word;
+		}
+	}
+
+	constexpr std::uint64_t mix(std::uint64_t a, std::uint64_t b)
+	// Fold the full product of two words, the step everything here is built from
+	{
+		impl::mum(a, b);
+		return a ^ b;
+	}
+
+	constexpr std::uint64_t combine(std::uint64_t a, std::uint64_t b)
+	// Hash of a sequence from the hashes of its parts, which depends on their order
+	{
+		return mix(a ^ impl::secret[2], b ^ impl::secret[3]);
+	}
+
+	constexpr std::uint64_t hash(std::string_view s, std::uint64_t seed = 0)
+	// All 64 bits of the bytes in the manner of wyhash, the same at compile and run time
+	{
+		using impl::secret;
+		using impl::read;
+
+		auto p = s.data();
+		auto const size = s.size();
+		std::uint64_t a = 0, b = 0;
+
+		seed ^= mix(seed ^ secret[0], secret[1]);
+		if (size <= 16)
+		{
+			if (4 <= size)
+			{
+				// Two overlapping pairs of words cover every byte
+				auto const quarter = (size >> 3) << 2;
+				a = (read<4>(p) << 32) | read<4>(p + quarter);
+				b = (read<4>(p + size - 4) << 32) | read<4>(p + size - 4 - quarter);
+			}
+			else
+			if (0 < size)
+			{
+				a = static_cast<std::uint64_t>(static_cast<unsigned char>(p[0])) << 16
+				  | static_cast<std::uint64_t>(static_cast<unsigned char>(p[size >> 1])) << 8
+				  | static_cast<std::uint64_t>(static_cast<unsigned char>(p[size - 1]));
+			}
+		}
+		else
+		{
+			auto left = size;
+			if (48 < left)
+			{
+				// Three independent lanes keep the multipliers busy
+				auto first = seed, second = seed;
+				do
+				{
+					seed = mix(read<8>(p) ^ secret[1], read<8>(p + 8) ^ seed);
+					first = mix(read<8>(p + 16) ^ secret[2], read<8>(p + 24) ^ first);
+					second = mix(read<8>(p + 32) ^ secret[3], read<8>(p + 40) ^ second);
+					p += 48;
+					left -= 48;
+				}
+				while (48 < left);
+				seed ^= first ^ second;
+			}
+			while (16 < left)
+			{
+				seed = mix(read<8>(p) ^ secret[1], read<8>(p + 8) ^ seed);
+				p += 16;
+				left -= 16;
+			}
+			// The last 16 bytes, which may overlap those already seen
+			a = read<8>(p + left - 16);
+			b = read<8>(p + left - 8);
+		}
+
+		a ^= secret[1];
+		b ^= seed;
+		impl::mum(a, b);
+		return mix(a ^ secret[0] ^ size, b ^ secret[1]);
+	}
+
+	constexpr std::uint64_t hash(std::uint64_t n, std::uint64_t seed = 0)
+	// Integers scattered so that nearby values land far apart
+	{
+		auto a = n ^ impl::secret[0];
+		auto b = seed ^ impl::secret[1];
+		impl::mum(a, b);
+		return mix(a ^ impl::secret[0], b ^ impl::secret[1]);
+	}
+
+	template <class First, class Second>
+	constexpr std::uint64_t hash(std::pair<First, Second> const& pair, std::uint64_t seed = 0)
+	// Keys of two parts, such as the pairs of a diff
+	{
+		auto const part = [seed](auto const& value)
+		{
+			using type = std::decay_t<decltype(value)>;
+			if constexpr (std::is_convertible_v<type const&, std::string_view>)
+			{
+				return hash(std::string_view(value), seed);
+			}
+			else
+			{
+				static_assert(std::is_integral_v<type> or std::is_enum_v<type>);
+				return hash(static_cast<std::uint64_t>(value), seed);
+			}
+		};
+		return combine(part(pair.first), part(pair.second));
+	}
+
+	std::uint32_t crc32c(std::string_view, std::uint32_t crc = 0);
+	// Castagnoli checksum continued from a previous one, by the instructions for it where the processor has them
+
+	std::uint64_t entropy();
+	// Random bits from the system, different in each process
+
+	inline std::uint64_t seed()
+	// Key for tables holding text from outside, so that collisions cannot be planned
+	{
+		static auto const value = entropy();
+		return value;
+	}
+}
+
+#endif // file
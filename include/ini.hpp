@@ -2,6 +2,7 @@
 #define ini_hpp "Initial Options"
 
 #include "doc.hpp"
+#include "line.hpp"
 
 namespace doc
 {
@@ -11,6 +12,7 @@ namespace doc
 		using view   = string::view;
 		using init   = view::init;
 		using vector = view::vector;
+		using small  = view::small;
 		using span   = view::span;
 		using out    = string::out;
 		using in     = string::in;
@@ -22,9 +24,10 @@ namespace doc
 		friend in::ref operator>>(in::ref, ref);
 		friend out::ref operator<<(out::ref, cref);
 		static in::ref getline(in::ref, string::ref);
+		static bool getline(fmt::lines&, view&);
 
 		static string join(span);
-		static vector split(view);
+		static small split(view);
 		static string join(init);
 
 		bool got(path::pair) const;
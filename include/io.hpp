@@ -2,6 +2,7 @@
 #define io_hpp "Standard Input/Output"
 
 #include <cstring>
+#include <cstdint>
 #include <streambuf>
 #include "file.hpp"
 #include "dig.hpp"
@@ -58,6 +59,7 @@ namespace fmt
 			else
 			{
 				*Base::pptr() = traits_type::to_char_type(c);
+				Base::pbump(1);
 			}
 			return traits_type::not_eof(c);
 		}
@@ -139,6 +141,16 @@ namespace fmt
 			return Base::setbuf(buf.data(), n, m);
 		}
 
+		auto setbufsiz(size_type n, size_type m, std::size_t align)
+		// Start on a boundary of bytes, as direct transfers need
+		{
+			auto const pad = static_cast<size_type>(align / sizeof (char_type));
+			buf.resize(fmt::to_size(n + m + pad));
+			auto const at = reinterpret_cast<std::uintptr_t>(buf.data());
+			auto const skip = (align - at % align) % align / sizeof (char_type);
+			return Base::setbuf(buf.data() + skip, n, m);
+		}
+
 	private:
 
 		string buf;
@@ -0,0 +1,80 @@
+#ifndef journal_hpp
+#define journal_hpp "Append Log"
+
+#include "pipe.hpp"
+#include "shm.hpp"
+
+namespace env::file
+{
+	class segment : fwd::unique
+	// Sealed part of a journal mapped for reading, each record handed over where it lies
+	{
+	public:
+
+		explicit segment(fmt::string::view path);
+
+		bool each(block const&) const;
+		// Records in order with their offsets until the block returns true, failure if one was damaged
+
+		size_t size() const
+		// Bytes which were mapped
+		{
+			return length;
+		}
+
+	private:
+
+		map_ptr map;
+		size_t length = 0;
+	};
+
+	class journal : fwd::unique
+	// Records appended to numbered files in a directory, each framed by its length and a checksum
+	{
+	public:
+
+		struct options
+		{
+			size_t segment = 64 << 20; // space set aside for each file before rolling over to the next
+			bool sync = false;         // flush the data after every append
+		};
+
+		explicit journal(fmt::string::view dir);
+		journal(fmt::string::view dir, options);
+		// Recover the directory, cutting away a torn record at the end of the last file
+
+		bool append(fmt::string::view record);
+		bool append(fmt::string::view::span records);
+		// All in the same file with as few writes as the system allows
+
+		bool flush() const;
+		// Make what was appended durable
+
+		bool replay(block const&) const;
+		// Every record in order until the block returns true, failure if one was damaged
+
+		fwd::vector<fmt::string> paths() const;
+		// Files in order, the last one still being written
+
+		descriptor const& file() const
+		// Where the next records go, which is replaced on rolling over
+		{
+			return active;
+		}
+
+	private:
+
+		fmt::string const dir;
+		options const opt;
+		descriptor active;
+		fwd::vector<size_t> sealed; // numbers of the files before the active one
+		size_t number = 0, end = 0, room = 0;
+
+		fmt::string path(size_t) const;
+		bool recover();
+		bool roll(size_t need);
+		bool gather(fwd::span<fwd::span<char const>> parts);
+	};
+}
+
+#endif // file
@@ -0,0 +1,89 @@
+#ifndef line_hpp
+#define line_hpp "Line Reader"
+
+#include "fmt.hpp"
+#include "file.hpp"
+#include "ptr.hpp"
+
+namespace fmt
+{
+	class lines : fwd::unique
+	// Each line found in large chunks and given as a view into the buffer
+	{
+		struct adapter : env::file::reader
+		{
+			string::in::ptr stream = nullptr;
+			bool whole = true; // stop after each end of line when nothing can be given back
+			char eol = fmt::eol;
+
+			env::file::ssize_t read(fwd::as_ptr<void> ptr, env::file::size_t sz) const override;
+		};
+
+		adapter wrap;
+		env::file::reader const& from;
+		fwd::vector<char> buf;
+		std::size_t head = 0, seen = 0, tail = 0;
+		char eol;
+		bool done = false;
+
+		bool fill();
+		// Keep the partial line and read another chunk after it
+
+	public:
+
+		static constexpr std::size_t chunk = 1 << 16;
+
+		explicit lines(env::file::reader const& in, char end = fmt::eol) : from(in), eol(end)
+		{ }
+
+		explicit lines(string::in::ref in, char end = fmt::eol);
+		// Read through the stream buffer in chunks, or a line at a time if it cannot seek, failing the stream at its end
+
+		~lines();
+		// Give back what was read ahead
+
+		bool next(view&);
+		// Next line without its end, valid until the following call
+
+		class iterator
+		{
+			lines* that;
+			view line;
+
+		public:
+
+			explicit iterator(lines* from = nullptr) : that(from)
+			{
+				if (that) ++*this;
+			}
+
+			view operator*() const
+			{
+				return line;
+			}
+
+			iterator& operator++()
+			{
+				if (not that->next(line)) that = nullptr;
+				return *this;
+			}
+
+			bool operator==(iterator const& it) const
+			{
+				return that == it.that;
+			}
+		};
+
+		iterator begin()
+		{
+			return iterator(this);
+		}
+
+		iterator end()
+		{
+			return iterator();
+		}
+	};
+}
+
+#endif // file
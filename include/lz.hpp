@@ -0,0 +1,136 @@
+#ifndef lz_hpp
+#define lz_hpp "Block Compression"
+
+#include "fmt.hpp"
+#include "file.hpp"
+#include "mode.hpp"
+#include "io.hpp"
+
+namespace fmt::lz
+{
+	std::size_t bound(std::size_t);
+	// Most bytes which compressing this many can give
+
+	std::size_t compress(string::view, char* out);
+	// Literals and matches within the last 64 KB in the manner of LZ4, returning the bytes written
+
+	bool decompress(string::view, char* out, std::size_t size);
+	// Exactly this many bytes or failure, never reading or writing outside of either buffer
+
+	bool pack(string::view, string& out, std::size_t block = 1 << 16, std::size_t threads = 0);
+	// Framed as a packer would write it, the blocks compressed at once on all cores by default
+
+	bool unpack(string::view, string& out, std::size_t threads = 0);
+	// Whole frame of independent blocks, each decoded by one of the threads
+}
+
+namespace env::file
+{
+	class packer : fwd::unique, public stream
+	// Compressed frame of independent blocks on another stream, written or read a block at a time
+	{
+	public:
+
+		explicit packer(stream const& file, mode am, size_t block = 1 << 16)
+		: file(file), am(am), block(block)
+		{ }
+
+		~packer();
+		// Finish the frame of a writer, even one with nothing written
+
+		ssize_t read(void *buf, size_t sz) const override;
+		ssize_t write(const void *buf, size_t sz) const override;
+
+		bool finish() const;
+		// Last block which is not full and the mark for the end
+
+	private:
+
+		stream const& file;
+		mode const am;
+		size_t const block;
+
+		mutable fmt::string source, output; // writing
+		mutable fmt::string plain, input;   // reading
+		mutable size_t at = 0, limit = 0;
+		mutable bool started = false, finished = false, opened = false, ended = false;
+
+		bool emit() const;
+		bool next() const;
+	};
+}
+
+namespace fmt
+{
+	namespace impl
+	{
+		template
+		<
+			class Char,
+			template <class> class Traits,
+			template <class> class Alloc,
+			template
+			<
+				class,
+				template <class> class,
+				template <class> class
+			> class Stream,
+			auto Default
+		>
+		class basic_packstream : public Stream<Char, Traits, Alloc>
+		{
+			using base = Stream<Char, Traits, Alloc>;
+			using size_t = env::file::size_t;
+
+			env::file::packer z;
+
+		public:
+
+			basic_packstream(env::file::stream const& file, size_t block = 1 << 16)
+			: base(z), z(file, Default, block)
+			{
+				auto const n = Default & env::file::rd ? block : 0;
+				auto const m = Default & env::file::wr ? block : 0;
+				base::setbufsiz(fmt::to<std::streamsize>(n), fmt::to<std::streamsize>(m));
+			}
+
+			~basic_packstream()
+			{
+				(void) this->pubsync();
+			}
+
+			bool finish()
+			{
+				return -1 == this->pubsync() or z.finish();
+			}
+		};
+	}
+
+	template
+	<
+		class Char,
+		template <class> class Traits = std::char_traits,
+		template <class> class Alloc = std::allocator
+	>
+	using basic_ipackstream = impl::basic_packstream
+	<
+		Char, Traits, Alloc, basic_istream, env::file::rd
+	>;
+
+	using ipackstream = basic_ipackstream<char>;
+
+	template
+	<
+		class Char,
+		template <class> class Traits = std::char_traits,
+		template <class> class Alloc = std::allocator
+	>
+	using basic_opackstream = impl::basic_packstream
+	<
+		Char, Traits, Alloc, basic_ostream, env::file::wr
+	>;
+
+	using opackstream = basic_opackstream<char>;
+}
+
+#endif // file
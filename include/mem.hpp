@@ -0,0 +1,247 @@
+#ifndef mem_hpp
+#define mem_hpp "Memory Allocators"
+
+#include "fmt.hpp"
+#include "ptr.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace fwd
+{
+	class arena : unique
+	// Monotonic bump allocation from blocks which are freed together
+	{
+		struct block
+		{
+			block* next;       // older block in use, or the next spare
+			std::size_t size;  // including this header
+			bool mapped;       // from the pages of the system
+		};
+
+		block* head = nullptr;  // newest block in use
+		block* spare = nullptr; // blocks kept after a rewind
+		std::uintptr_t pos = 0, end = 0;
+		std::size_t grain;
+		bool huge;
+
+		void* grow(std::size_t size, std::size_t align);
+		// Continue in a block with room for the request
+
+		block* make(std::size_t size);
+		// New block of at least one size from the heap or the system
+
+		static void free(block*);
+
+	public:
+
+		static constexpr std::size_t huge_page = 2 << 20;
+
+		explicit arena(std::size_t block = 1 << 16, bool huge = false);
+		// Blocks of at least one size, from huge pages when asked and the system has them
+
+		~arena();
+
+		void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t))
+		// Bump the position, only leaving the block when it is full
+		{
+			auto const at = (pos + align - 1) & ~(align - 1);
+			if (at < end and size <= end - at)
+			{
+				pos = at + size;
+				return reinterpret_cast<void*>(at);
+			}
+			return grow(size, align);
+		}
+
+		struct mark
+		{
+			block* head;
+			std::uintptr_t pos, end;
+		};
+
+		mark tell() const
+		// Position to rewind to
+		{
+			return { head, pos, end };
+		}
+
+		void rewind(mark);
+		// Free everything allocated after the mark, keeping the blocks
+
+		void reset()
+		// Free everything, keeping the blocks
+		{
+			rewind({ nullptr, 0, 0 });
+		}
+
+		std::size_t capacity() const;
+		// Bytes in blocks held, in use or spare
+
+		static arena& current();
+		// Arena of the innermost scope on this thread, or one for the thread
+
+		class scope : unique
+		// Make an arena current and free what it allocated on leaving
+		{
+			arena* that;
+			arena* last;
+			mark at;
+
+		public:
+
+			explicit scope(arena&);
+
+			scope() : scope(current())
+			// Nested scope which rewinds the current arena
+			{ }
+
+			~scope();
+		};
+	};
+
+	struct huge_arena : arena
+	// Blocks in pages which are large enough to spare the TLB
+	{
+		explicit huge_arena(std::size_t block = huge_page) : arena(block, true)
+		{ }
+	};
+
+	template <class Type> struct arena_allocator
+	// Allocate from the arena current when made, freeing only with the arena
+	{
+		using value_type = Type;
+
+		arena* from;
+
+		arena_allocator() : from(&arena::current())
+		{ }
+
+		explicit arena_allocator(arena& a) : from(&a)
+		{ }
+
+		template <class Other> arena_allocator(arena_allocator<Other> const& a) : from(a.from)
+		{ }
+
+		Type* allocate(std::size_t n)
+		{
+			if (std::numeric_limits<std::size_t>::max() / sizeof(Type) < n)
+			{
+				throw std::bad_array_new_length();
+			}
+			return static_cast<Type*>(from->allocate(n * sizeof(Type), alignof(Type)));
+		}
+
+		void deallocate(Type*, std::size_t)
+		{ }
+
+		template <class Other> bool operator==(arena_allocator<Other> const& a) const
+		{
+			return from == a.from;
+		}
+	};
+
+	class pool : unique
+	// Free lists of blocks in power of two size classes, carved from chunks
+	{
+	public:
+
+		static constexpr std::size_t smallest = 16, largest = 4096, classes = 9;
+		static constexpr std::size_t chunk = 1 << 16;
+
+		static constexpr std::size_t index(std::size_t size)
+		// Class of the smallest blocks which fit
+		{
+			std::size_t at = 0;
+			while ((smallest << at) < size) ++at;
+			return at;
+		}
+
+	protected:
+
+		struct node
+		{
+			node* next;
+		};
+
+		node* lists[classes] { };
+		fwd::vector<void*> chunks;
+		std::uintptr_t pos = 0, end = 0; // rest of the newest chunk
+
+		node* carve(std::size_t index, std::size_t count);
+		// New list of blocks in one class
+
+	public:
+
+		~pool();
+
+		void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+		void deallocate(void*, std::size_t size, std::size_t align = alignof(std::max_align_t));
+		// Blocks are aligned to their class, larger sizes go to the heap
+
+		struct shared
+		// One pool for all threads behind a lock
+		{
+			static void* allocate(std::size_t size, std::size_t align);
+			static void deallocate(void*, std::size_t size, std::size_t align);
+		};
+
+		struct cached
+		// Lists for each thread in front of the shared pool, taken and given back in batches
+		{
+			static void* allocate(std::size_t size, std::size_t align);
+			static void deallocate(void*, std::size_t size, std::size_t align);
+		};
+	};
+
+	template <class Type, class Source> struct pool_adapter
+	// Stateless allocator over one of the pools
+	{
+		using value_type = Type;
+
+		pool_adapter() = default;
+
+		template <class Other> pool_adapter(pool_adapter<Other, Source> const&)
+		{ }
+
+		Type* allocate(std::size_t n)
+		{
+			if (std::numeric_limits<std::size_t>::max() / sizeof(Type) < n)
+			{
+				throw std::bad_array_new_length();
+			}
+			return static_cast<Type*>(Source::allocate(n * sizeof(Type), alignof(Type)));
+		}
+
+		void deallocate(Type* ptr, std::size_t n)
+		{
+			Source::deallocate(ptr, n * sizeof(Type), alignof(Type));
+		}
+
+		template <class Other> bool operator==(pool_adapter<Other, Source> const&) const
+		{
+			return true;
+		}
+	};
+
+	template <class Type> using pool_allocator = pool_adapter<Type, pool::shared>;
+	template <class Type> using cache_allocator = pool_adapter<Type, pool::cached>;
+}
+
+namespace fmt
+{
+	// Temporary text freed with the current arena
+	using arena_string = basic_string<char, fwd::character, fwd::arena_allocator>;
+	using arena_wstring = basic_string<wchar_t, fwd::character, fwd::arena_allocator>;
+
+	// Text of small blocks recycled by size
+	using pool_string = basic_string<char, fwd::character, fwd::pool_allocator>;
+	using cache_string = basic_string<char, fwd::character, fwd::cache_allocator>;
+
+	template <class Type> using arena_vector = fwd::vector<Type, fwd::arena_allocator>;
+	template <class Type> using pool_vector = fwd::vector<Type, fwd::pool_allocator>;
+	template <class Type> using cache_vector = fwd::vector<Type, fwd::cache_allocator>;
+}
+
+#endif // file
@@ -26,6 +26,7 @@ namespace env::file
 		lnk  = 1 << 015, // symbolic link
 		reg  = 1 << 016, // regulare file
 		sock = 1 << 017, // domain socket
+		dio  = 1 << 020, // direct, around the cache
 
 		rw   = rd | wr, // read & write
 		wo   = rw | ok, // write & exists
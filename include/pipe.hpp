@@ -5,9 +5,23 @@
 #include "ptr.hpp"
 #include "file.hpp"
 #include "mode.hpp"
+#include <functional>
 
 namespace env::file
 {
+	// Hints for positional transfers, dropped where the system lacks them
+	enum hint : int
+	{
+		nowait = 1 << 0, // fail rather than wait for pages which are not cached
+		hipri  = 1 << 1, // poll for completion on devices which allow it
+	};
+
+	// Expected use of a range, so that the cache can read ahead or make room
+	enum advice : int
+	{
+		normal, sequential, random, willneed, dontneed, noreuse,
+	};
+
 	struct descriptor : fwd::unique, stream
 	{
 		ssize_t read(void *buf, size_t sz) const override;
@@ -15,6 +29,23 @@ namespace env::file
 		bool open(fmt::string::view path, mode = rw, permit = owner(rw));
 		bool close();
 
+		ssize_t pread(void *buf, size_t sz, size_t at, int hints = 0) const;
+		ssize_t pwrite(const void *buf, size_t sz, size_t at, int hints = 0) const;
+		// At an offset without moving the cursor, so that threads can share the descriptor
+
+		ssize_t preadv(fwd::span<fwd::span<char> const> bufs, size_t at, int hints = 0) const;
+		ssize_t pwritev(fwd::span<fwd::span<char const> const> bufs, size_t at, int hints = 0) const;
+		// Scatter or gather buffers at an offset in one call
+
+		size_t size() const;
+		// Bytes in the file, or zero if it cannot be known
+
+		size_t align() const;
+		// Boundary for the buffers, offsets and sizes of direct transfers
+
+		bool advise(advice, size_t at = 0, size_t sz = 0) const;
+		// Tell the cache how a range will be used, to the end when no size is given
+
 		explicit descriptor(fmt::string::view path, mode am = rw, permit pm = owner(rw))
 		{
 			(void) open(path, am, pm);
@@ -50,6 +81,28 @@ namespace env::file
 		int fd;
 	};
 
+	struct slice : reader
+	// Range of a shared descriptor read at its own offset, so that each thread may have one without a lock
+	{
+		descriptor const& from;
+		mutable size_t at;
+		size_t end;
+
+		slice(descriptor const& in, size_t begin, size_t stop) : from(in), at(begin), end(stop)
+		{ }
+
+		ssize_t read(void *buf, size_t sz) const override;
+	};
+
+	using block = std::function<bool(size_t at, fmt::string::view data)>;
+	// Part of a file which was read, returning true to stop
+
+	bool scan(descriptor const&, block const&, size_t size = 4 << 20, size_t threads = 0);
+	// Every block read by one of the threads and handed over there in no order, failure on an error
+
+	bool load(descriptor const&, fmt::string& out, size_t threads = 0);
+	// Whole file in one buffer, with the threads reading parts of it at once
+
 	struct pipe : fwd::unique, stream
 	{
 		explicit pipe();
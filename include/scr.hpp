@@ -0,0 +1,110 @@
+#ifndef scr_hpp
+#define scr_hpp "Terminal Screen"
+
+#include "fmt.hpp"
+#include "file.hpp"
+#include "ptr.hpp"
+#include <cstdint>
+
+namespace fmt
+{
+	struct cell
+	// One character position with its colours and attributes
+	{
+		enum : unsigned char
+		{
+			intense   = 1 << 0,
+			faint     = 1 << 1,
+			italic    = 1 << 2,
+			underline = 1 << 3,
+			blink     = 1 << 4,
+			reverse   = 1 << 5,
+			strike    = 1 << 6,
+		};
+
+		static constexpr std::uint16_t plain = 256;
+		// Colour of the terminal default, otherwise 0 to 255 of the palette
+
+		static constexpr char32_t trail = 0;
+		// Code of the cell after a double width character, which it covers
+
+		char32_t code = U' ';
+		std::uint16_t fg = plain, bg = plain;
+		unsigned char attr = 0;
+
+		bool operator==(cell const&) const = default;
+
+		bool same(cell const& that) const
+		// Whether both are drawn with the same rendition
+		{
+			return fg == that.fg and bg == that.bg and attr == that.attr;
+		}
+	};
+
+	class screen : fwd::unique
+	// Double buffered grid written out as the difference between frames
+	{
+		std::size_t width = 0, height = 0;
+		fwd::vector<cell> next, last;
+		string buf;
+		cell pen; // rendition the terminal is in
+		std::size_t x = 0, y = 0; // cursor
+		bool fresh = true, known = false;
+
+		void move(std::size_t col, std::size_t row);
+		// Shortest way from the cursor to the position
+
+		void style(cell const&);
+		// Shortest change from the pen to the rendition
+
+		void glyph(char32_t);
+		// Encode one character as UTF-8
+
+	public:
+
+		screen(std::size_t cols, std::size_t rows)
+		{
+			resize(cols, rows);
+		}
+
+		void resize(std::size_t cols, std::size_t rows);
+		// Change the size, which redraws everything on the next frame
+
+		void invalidate()
+		// Redraw everything on the next frame
+		{
+			fresh = true;
+		}
+
+		std::size_t cols() const
+		{
+			return width;
+		}
+
+		std::size_t rows() const
+		{
+			return height;
+		}
+
+		cell& operator()(std::size_t col, std::size_t row)
+		{
+			return next[row * width + col];
+		}
+
+		void fill(cell = {});
+		// Set every position of the next frame
+
+		std::size_t put(std::size_t col, std::size_t row, view text, cell style = {});
+		// Write UTF-8 text clipped at the end of the row, returning the
+		// column after the last character, which takes two for one of
+		// double width
+
+		view render();
+		// Escape codes which turn the last frame into the next
+
+		bool flush(env::file::writer const&);
+		// Render the next frame and write it in one call
+	};
+}
+
+#endif // file
@@ -13,7 +13,7 @@ namespace fwd::sig
 	{
 		using signature = void(args...);
 		using function = std::function<signature>;
-		using container = std::map<slot, function>;
+		using container = std::map<slot, function>; // nodes stay put while a handler walks them
 		using size_type = typename container::size_type;
 
 		size_type const invalid = ~size_type(0);
@@ -0,0 +1,18 @@
+#ifndef sort_hpp
+#define sort_hpp "String Sorting"
+
+#include "fmt.hpp"
+
+namespace fwd
+{
+	void sort_strings(span<fmt::string::view>, std::size_t threads = 0);
+	// Byte order by radix from the front, small buckets by multikey quicksort, on all cores by default
+
+	span<fmt::string::view> unique_strings(span<fmt::string::view>);
+	// Sorted views each once at the front, which are returned
+
+	vector<fmt::string::view> sorted_merge(span<fmt::string::view const>, span<fmt::string::view const>);
+	// Union of sorted runs, keeping one of the views that are in both
+}
+
+#endif // file
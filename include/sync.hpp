@@ -9,6 +9,10 @@
 #else
 #include "uni/pthread.hpp"
 #endif
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 namespace sys
 {
@@ -138,12 +142,73 @@ namespace sys
 			auto const unlock = lock.write();
 			return value = n;
 		}
+	};
 
-		atomic(Type n)
+	inline std::size_t workers(std::size_t threads, std::size_t tasks)
+	// Threads which share will use, one for each core if zero are wanted, but no more than there are tasks
+	{
+		if (0 == threads)
 		{
-			operator=(n);
+			threads = std::max(1u, std::thread::hardware_concurrency());
 		}
-	};
+		return std::max<std::size_t>(1, std::min(threads, tasks));
+	}
+
+	template <class Work> void share(std::size_t threads, std::size_t tasks, Work&& work)
+	// Each task index taken in order by one of the workers until none are left,
+	// also passing the number of the worker when the work takes a second one.
+	// The first exception thrown by any of them is thrown again after the join
+	{
+		threads = workers(threads, tasks);
+		std::atomic<std::size_t> next = 0;
+		std::atomic<bool> thrown = false;
+		std::exception_ptr error;
+		auto const run = [&](std::size_t worker)
+		{
+			try
+			{
+				for (auto i = next++; i < tasks; i = next++)
+				{
+					if constexpr (std::is_invocable_v<Work&, std::size_t, std::size_t>)
+					{
+						work(i, worker);
+					}
+					else
+					{
+						work(i);
+					}
+				}
+			}
+			catch (...)
+			{
+				next = tasks; // no more are taken
+				if (not thrown.exchange(true))
+				{
+					error = std::current_exception();
+				}
+			}
+		};
+
+		fwd::vector<std::thread> pool;
+		pool.reserve(threads - 1);
+		for (std::size_t i = 1; i < threads; ++i)
+		{
+			try
+			{
+				pool.emplace_back(run, i);
+			}
+			catch (...)
+			{
+				break; // the rest are done by those already running
+			}
+		}
+		run(0);
+		for (auto& t : pool) t.join();
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
 }
 
 #endif
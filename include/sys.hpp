@@ -91,6 +91,8 @@ namespace sys
 	constexpr auto fdopen = ::_fdopen;
 	constexpr auto fileno = ::_fileno;
 	constexpr auto fstat = ::_fstat;
+	constexpr auto fsync = ::_commit;
+	constexpr auto ftruncate = ::_chsize;
 	constexpr auto getcwd = ::_getcwd;
 	constexpr auto getpid = ::_getpid;
 	constexpr auto isatty = ::_isatty;
@@ -166,6 +168,8 @@ namespace sys
 	constexpr auto fdopen = ::fdopen;
 	constexpr auto fileno = ::fileno;
 	constexpr auto fstat = ::fstat;
+	constexpr auto fsync = ::fsync;
+	constexpr auto ftruncate = ::ftruncate;
 	constexpr auto getcwd = ::getcwd;
 	constexpr auto getpid = ::getpid;
 	constexpr auto getppid = ::getppid;
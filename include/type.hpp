@@ -33,6 +33,7 @@ namespace fmt
 		using span = typename view::span;
 		using pair = typename view::pair;
 		using vector = typename view::vector;
+		using small = typename view::small;
 		using size_type = typename view::size_type;
 
 		static_assert(null == ~npos);
@@ -118,7 +119,7 @@ namespace fmt
 		auto split(view u, mask x = space) const
 		// Split strings in $u delimited by $x
 		{
-			vector t;
+			small t;
 			auto const begin = u.data(), end = begin + u.size();
 			for (auto i = skip(begin, end, x), j = end; i != end; i = skip(j, end, x))
 			{
@@ -354,7 +355,7 @@ namespace fmt
 		static auto split(view u, view v)
 		// Split strings in $u delimited by $v
 		{
-			vector t;
+			small t;
 			auto const uz = u.size(), vz = v.size();
 			for (auto i = null, j = u.find(v); i < uz; j = u.find(v, i))
 			{
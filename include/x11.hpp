@@ -22,13 +22,13 @@ namespace x11
 		using cref = typename span::const_reference;
 		using ref = typename span::reference;
 
-		friend bytes::out::ref operator<<(bytes::out::ref out, cref obj)
+		friend bytes::out::ref operator<<(bytes::out::ref out, Protocol const& obj)
 		{
 			auto const ptr = reinterpret_cast<bytes::const_pointer>(&obj);
 			return out.write(ptr, Size);
 		}
 
-		friend bytes::in::ref operator>>(bytes::in::ref in, ref obj)
+		friend bytes::in::ref operator>>(bytes::in::ref in, Protocol& obj)
 		{
 			auto const ptr = reinterpret_cast<bytes::pointer>(&obj);
 			return in.read(ptr, Size);
@@ -39,29 +39,32 @@ namespace x11
 	<
 		char ReqType, 
 		class Req = xReq, unsigned short ReqSize = sz_xReq, 
-		class Reply = xGenericReply, unsigned short ReplySize = sz_xReply
+		class Rep = xGenericReply, unsigned short RepSize = sz_xReply
 	>
 	struct Request : Protocol<Req, ReqSize>
 	{
 		static constexpr auto requestType = ReqType;
 		using request = Req;
 		static constexpr auto requestSize = ReqSize;
-		using reply = Reply;
-		static constexpr auto replySize = ReplySize;
+		using reply = Rep;
+		static constexpr auto replySize = RepSize;
 
 		static_assert(sizeof (Req) == requestSize);
-		static_assert(sizeof (Reply) == replySize);
+		static_assert(sizeof (Rep) == replySize);
 
-		Request() 
-		: Req::reqType(requestType), Req::length(requestSize) 
-		{ }
+		Request() : Protocol<Req, ReqSize>()
+		{
+			// Length is counted in four byte units
+			Req::reqType = requestType;
+			Req::length = requestSize / 4;
+		}
 	};
 
 	template
 	<
-		char ReqType, class Reply = xGenericReply, unsigned short ReplySize = sz_xReply
+		char ReqType, class Rep = xGenericReply, unsigned short RepSize = sz_xReply
 	>
-	using Reply = Request<ReqType, xReq, sz_xReq, Reply, ReplySize>;
+	using Reply = Request<ReqType, xReq, sz_xReq, Rep, RepSize>;
 };
 
 #endif // Xproto
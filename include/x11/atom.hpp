@@ -0,0 +1,52 @@
+#ifndef xatom_hpp
+#define xatom_hpp
+
+#include "x11.hpp"
+#include "conn.hpp"
+#include "str.hpp"
+#include <unordered_map>
+
+namespace x11
+{
+	class atoms : fwd::unique
+	// Interned atoms cached both ways, with lookups batched into one round trip
+	{
+		connection& conn;
+		std::unordered_map<fmt::name, CARD32> ids;
+		std::unordered_map<CARD32, fmt::name> names;
+		std::unordered_map<fmt::name, cookie> interning;
+		std::unordered_map<CARD32, cookie> naming;
+
+		void learn(fmt::name, CARD32);
+		// Store a pair in both directions
+
+	public:
+
+		explicit atoms(connection&, fmt::string::view::init = {});
+		// Cache the predefined atoms, then resolve the given names together
+
+		void want(fmt::string::view, bool exists = false);
+		// Queue an InternAtom request unless the name is known or pending,
+		// where a name found missing is only asked for again to create it
+
+		void want(CARD32);
+		// Queue a GetAtomName request unless the atom is known or pending
+
+		bool resolve();
+		// Flush once and collect every pending reply, remembering what failed
+
+		CARD32 find(fmt::string::view) const;
+		// Cached atom for a name, or None without a round trip
+
+		fmt::string::view find(CARD32) const;
+		// Cached name of an atom, or empty without a round trip
+
+		CARD32 operator[](fmt::string::view);
+		// CARD32 for a name, resolving what is pending if it is not cached
+
+		fmt::string::view operator[](CARD32);
+		// Name of an atom, resolving what is pending if it is not cached
+	};
+}
+
+#endif // file
@@ -1,9 +1,12 @@
 #ifndef xauth_hpp
 #define xauth_hpp
 
-#include <iosfwd>
 #include "env.hpp"
+#include "shm.hpp"
 #include "x11.hpp"
+#include <memory>
+#include <tuple>
+#include <map>
 
 namespace x11
 {
@@ -12,16 +15,54 @@ namespace x11
 
 namespace x11::auth
 {
-	struct info : fmt::struct_brief<info>
+	constexpr unsigned short local = 256;
+	// Family of a host name for local connections
+
+	constexpr unsigned short wild = 0xFFFF;
+	// Family that matches any address
+
+	struct entry
+	// Record viewed in place in the mapped file
 	{
 		unsigned short family;
-		fmt::string address;
-		fmt::string number;
-		fmt::string name;
-		fmt::string data;
+		fmt::string::view address;
+		fmt::string::view number;
+		fmt::string::view name;
+		fmt::string::view data;
+	};
+
+	class file : fwd::unique
+	// Records of a mapped file indexed by family, address and display
+	{
+		using key = std::tuple<unsigned short, fmt::string::view, fmt::string::view>;
+
+		env::file::map_ptr map;
+		fwd::vector<entry> entries;
+		std::map<key, std::size_t> index;
+
+	public:
+
+		unsigned long long device = 0, inode = 0;
+		long long modified = 0, size = 0;
+
+		bool open(fmt::string::view path);
+		// Map the file and parse every record
+
+		bool parse(fmt::string::view);
+		// Index records in a buffer which must outlive this
+
+		entry const* find(unsigned short family, fmt::string::view address, fmt::string::view number) const;
+		// First record for the display, falling back to any display and
+		// then to wild families as libXau does
+
+		fwd::span<entry const> records() const
+		{
+			return entries;
+		}
 	};
 
-	bytes::in::ref operator>>(bytes::in::ref, info::ref);
+	std::shared_ptr<file const> load(fmt::string::view path = authority());
+	// Parsed file shared between calls, read again only once it changed
 };
 
 #endif
@@ -0,0 +1,123 @@
+#ifndef xconn_hpp
+#define xconn_hpp
+
+#include "x11.hpp"
+#include "wire.hpp"
+#include "ptr.hpp"
+#include <type_traits>
+#include <map>
+#include <deque>
+
+namespace x11
+{
+	struct cookie
+	// Widened sequence number of a request that was queued
+	{
+		unsigned long long sequence = 0;
+	};
+
+	class connection : fwd::unique
+	// Pipelined requests with replies matched to cookies by sequence
+	{
+		struct part
+		{
+			char const* data; // external bytes or null for the buffer
+			std::size_t at, size;
+		};
+
+		int fd;
+		bytes out;
+		decoder in;
+		std::size_t pending = 0;
+		fwd::vector<part> parts;
+		unsigned long long sent = 0, written = 0, expect = 0, last = 0;
+		CARD32 base = 0, mask = 0, next = 0;
+		fwd::vector<int> fds;
+		std::map<unsigned long long, bytes> replies;
+		fwd::set<unsigned long long> ignore;
+		fwd::set<unsigned long long> checked; // errors which someone will ask for
+		std::deque<bytes> queue;
+		bytes held; // reply taken from the others, handed out last
+
+		static constexpr int none = 0, any = -1;
+
+		bool fill(bool wait = true);
+		// Read at least one more chunk from the socket
+
+		packet parse(unsigned long long reply = 0, int event = none);
+		// Copy complete packets in the read buffer to their owners until the reply
+		// or event wanted, which is handed out in place until the next fill
+
+		unsigned long long widen(unsigned short) const;
+		// Full sequence number of the latest request with these low bits
+
+	public:
+
+		static constexpr std::size_t limit = 1 << 16;
+		// Buffered bytes which cause an implicit flush
+
+		explicit connection(int fd = -1) : fd(fd)
+		{ }
+
+		~connection();
+
+		static int open(int display);
+		// Connect to the local socket for a display number
+
+		int get() const
+		{
+			return fd;
+		}
+
+		cookie send(void const* req, std::size_t size, fmt::string::view data = {}, bool reply = false);
+		// Queue request header with trailing data padded to four bytes,
+		// where large data is referenced and must outlive the next flush
+
+		template <class Req> cookie send(Req& req, fmt::string::view data = {})
+		// Queue a typed request, expecting a reply if it declares one
+		{
+			constexpr bool reply = not std::is_same_v<typename Req::reply, xGenericReply>;
+			return send(&req, Req::requestSize, data, reply);
+		}
+
+		void pass(int fd);
+		// Send a descriptor with the next flush, which then closes it
+
+		bool flush();
+		// Write every queued request in one vectored write
+
+		void ids(CARD32 base, CARD32 mask);
+		// Resource id range given in the connection setup
+
+		CARD32 xid();
+		// Allocate a new resource id, or zero when the range is spent
+
+		fmt::string::view reply(cookie);
+		// Wait for the reply to a request, or empty after reporting its error,
+		// valid until the next one is asked for
+
+		cookie check(cookie id)
+		// Keep the error of a request without a reply for error, where otherwise it is only reported
+		{
+			if (0 < id.sequence)
+			{
+				(void) checked.insert(id.sequence);
+			}
+			return id;
+		}
+
+		bool error(cookie, xError* = nullptr);
+		// Whether the request failed, optionally with the error
+
+		bool event(bytes::ref);
+		// Take the next queued event, reading more if none
+
+		bool poll(bytes::ref);
+		// Take the next queued event without blocking
+
+		bool event(bytes::ref, int type);
+		// Take the next event of one type, leaving the others queued
+	};
+}
+
+#endif // file
@@ -9,7 +9,8 @@ namespace x11
 	(
 		fmt::string::io::ref io, 
 		fmt::string::view proto, 
-		fmt::string::view string
+		fmt::string::view string,
+		layout* = nullptr
 	);
 }
 
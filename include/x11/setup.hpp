@@ -2,6 +2,8 @@
 #define xsetup_hpp
 
 #include "x11.hpp"
+#include "wire.hpp"
+#include <unordered_map>
 
 namespace x11
 {
@@ -39,6 +41,49 @@ namespace x11
 	<
 		xWindowRoot, sz_xWindowRoot
 	>;
+
+	struct screen
+	// Root window with its range in the flat array of depths
+	{
+		view<xWindowRoot> root;
+		std::size_t first, count;
+	};
+
+	struct depth
+	// Depth with its range in the flat array of visuals
+	{
+		view<xDepth> head;
+		std::size_t first, count;
+	};
+
+	class layout : fwd::unique
+	// Whole setup block read at once and indexed in place
+	{
+		fwd::vector<CARD32> store; // keeps every structure word aligned
+		bool swapped = false;
+
+		bool split(std::size_t);
+		// Index the given number of bytes at the start of the store
+
+	public:
+
+		view<xConnSetup> head { nullptr, false };
+		fmt::string::view vendor;
+		fwd::vector<view<xPixmapFormat>> formats;
+		fwd::vector<screen> screens;
+		fwd::vector<depth> depths;
+		fwd::vector<view<xVisualType>> visuals;
+		std::unordered_map<CARD32, std::size_t> index;
+
+		bool read(bytes::in::ref, SetupPrefix const&);
+		// Read the block following a successful prefix in one go
+
+		bool parse(fmt::string::view, char order = native);
+		// Split a copy of the block into views in a single pass
+
+		view<xVisualType> const* visual(CARD32 id) const;
+		// Visual with the given id or null if there is none
+	};
 }
 
 #endif
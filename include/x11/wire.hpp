@@ -0,0 +1,162 @@
+#ifndef xwire_hpp
+#define xwire_hpp
+
+#include "x11.hpp"
+#include "file.hpp"
+#include "ptr.hpp"
+#include <algorithm>
+#include <cstring>
+#include <bit>
+
+namespace x11
+{
+	constexpr char native = std::endian::little == std::endian::native ? 'l' : 'B';
+	// Byte order sent in the connection prefix by this client
+
+	template <class Type> inline Type swap(Type value)
+	// Reverse the byte order of an integer
+	{
+		if constexpr (1 < sizeof value)
+		{
+			auto const ptr = reinterpret_cast<unsigned char*>(&value);
+			std::reverse(ptr, ptr + sizeof value);
+		}
+		return value;
+	}
+
+	template <class Structure> class view
+	// Fields of a protocol structure read in place from the buffer
+	{
+		char const* ptr;
+		bool swapped;
+
+	public:
+
+		view(char const* at, bool swap) : ptr(at), swapped(swap)
+		{ }
+
+		template <class Field> Field operator()(Field Structure::* member) const
+		// Value of one field in our byte order
+		{
+			static constexpr Structure probe { };
+			auto const base = reinterpret_cast<char const*>(&probe);
+			auto const at = reinterpret_cast<char const*>(&(probe.*member)) - base;
+
+			Field value;
+			std::memcpy(&value, ptr + at, sizeof value);
+			return swapped ? swap(value) : value;
+		}
+
+		Structure const* operator->() const
+		// Direct access which is only valid when nothing is swapped
+		{
+			return reinterpret_cast<Structure const*>(ptr);
+		}
+	};
+
+	struct packet
+	// A reply, error or event lying in the read buffer
+	{
+		fmt::string::view data;
+		bool swapped = false;
+
+		explicit operator bool() const
+		{
+			return not data.empty();
+		}
+
+		int type() const
+		// Reply, error or event code without the sent flag
+		{
+			return data.front() & 0x7F;
+		}
+
+		bool sent() const
+		// Whether the event came from a SendEvent request
+		{
+			return data.front() & 0x80;
+		}
+
+		CARD16 sequence() const
+		{
+			return as<xGenericReply>()(&xGenericReply::sequenceNumber);
+		}
+
+		template <class Structure> view<Structure> as() const
+		{
+			return view<Structure>(data.data(), swapped);
+		}
+
+		fmt::string::view payload(std::size_t header = sz_xReply) const
+		// Variable length data following the fixed header
+		{
+			return data.substr(std::min(header, data.size()));
+		}
+
+		template <class Type> Type item(std::size_t index, std::size_t header = sz_xReply) const
+		// One element of the payload in our byte order, or zero past its end
+		{
+			Type value { };
+			auto const at = header + index * sizeof value;
+			if (data.size() < at or data.size() - at < sizeof value)
+			{
+				return value;
+			}
+			std::memcpy(&value, data.data() + at, sizeof value);
+			return swapped ? swap(value) : value;
+		}
+
+		template <class Type> fwd::span<Type const> items(std::size_t header = sz_xReply) const
+		// Payload elements in place which is only valid when nothing is swapped
+		{
+			auto const bytes = payload(header);
+			auto const ptr = reinterpret_cast<Type const*>(bytes.data());
+			return { ptr, bytes.size() / sizeof (Type) };
+		}
+	};
+
+	class decoder : fwd::unique
+	// Large reads split into packets without copying them out
+	{
+		fwd::vector<CARD32> store; // keeps every packet word aligned
+		std::size_t head = 0, tail = 0;
+		bool swapped;
+
+		char* bytes()
+		{
+			return reinterpret_cast<char*>(store.data());
+		}
+
+	public:
+
+		static constexpr std::size_t chunk = 1 << 16;
+
+		explicit decoder(char order = native) : swapped(native != order)
+		{ }
+
+		bool swap() const
+		{
+			return swapped;
+		}
+
+		std::size_t size() const
+		// Bytes read but not yet decoded
+		{
+			return tail - head;
+		}
+
+		fwd::span<char> space(std::size_t least = chunk);
+		// Room to read into, moving what is left to the front
+
+		void commit(std::size_t);
+		// Count bytes that were read into the space
+
+		bool fill(env::file::reader const&);
+		// Read one chunk, failing at the end of the stream
+
+		packet next();
+		// Next complete packet, which is valid until space is called
+	};
+}
+
+#endif // file
@@ -13,6 +13,26 @@
 #include "file.hpp"
 #include "x11/auth.hpp"
 #include "x11/setup.hpp"
+#include "x11/dpy.hpp"
+#include "x11/conn.hpp"
+#include "x11/proto.hpp"
+#include "x11/atom.hpp"
+#include "x11/xshm.hpp"
+#include "uni/mman.hpp"
+#include "sync.hpp"
+#include "pipe.hpp"
+#include "sys.hpp"
+#include "err.hpp"
+#include <X11/X.h>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <climits>
+#include <atomic>
+#include <X11/Xatom.h>
 
 namespace
 {
@@ -26,43 +46,165 @@ namespace
 		s = 1;
 		return *c ? 'l' : 'B';
 	}
+
+	void report(x11::packet const& p)
+	// Error which nobody is going to ask for
+	{
+		auto const e = p.as<xError>();
+		auto const code = static_cast<int>(e(&xError::errorCode));
+		auto const major = static_cast<int>(e(&xError::majorCode));
+		sys::warn(here, "error", code, major, e(&xError::sequenceNumber));
+	}
 }
 
 namespace x11::auth
 {
-	bytes::in::ref operator>>(bytes::in::ref in, info::ref out)
+	static long long stamp(sys::stat_t const& st)
+	// Modification time in nanoseconds
+	{
+		return st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+	}
+
+	bool file::open(fmt::string::view path)
+	{
+		entries.clear();
+		index.clear();
+		map.reset();
+
+		env::file::descriptor fd(path, env::file::rd);
+		if (sys::fail(fd.get()))
+		{
+			return failure;
+		}
+
+		struct sys::stat st(fd.get());
+		if (sys::fail(st))
+		{
+			sys::err(here, "stat", path);
+			return failure;
+		}
+
+		device = st.st_dev;
+		inode = st.st_ino;
+		modified = stamp(st);
+		size = st.st_size;
+
+		if (0 == size)
+		{
+			return success;
+		}
+
+		std::size_t length = 0;
+		map = env::file::make_map(fd.get(), 0, 0, env::file::rd, &length);
+		if (nullptr == map or MAP_FAILED == map.get())
+		{
+			return failure;
+		}
+		return parse(fmt::string::view(static_cast<char const*>(map.get()), length));
+	}
+
+	bool file::parse(fmt::string::view buf)
+	{
+		std::size_t at = 0;
+
+		// Counts are two bytes with the most significant first
+		auto const count = [&](std::size_t& n)
+		{
+			if (buf.size() < at + 2)
+			{
+				return failure;
+			}
+			auto const hi = static_cast<unsigned char>(buf[at]);
+			auto const lo = static_cast<unsigned char>(buf[at + 1]);
+			n = (std::size_t(hi) << 8) | lo;
+			at += 2;
+			return success;
+		};
+
+		auto const field = [&](fmt::string::view& out)
+		{
+			std::size_t n;
+			if (count(n) or buf.size() < at + n)
+			{
+				return failure;
+			}
+			out = buf.substr(at, n);
+			at += n;
+			return success;
+		};
+
+		while (at < buf.size())
+		{
+			std::size_t family;
+			entry e;
+			if (count(family) or field(e.address) or field(e.number) or field(e.name) or field(e.data))
+			{
+				sys::warn(here, "truncated", at);
+				return failure;
+			}
+			e.family = static_cast<unsigned short>(family);
+
+			// Wild families match on the display alone
+			auto const address = wild == e.family ? fmt::string::view() : e.address;
+			(void) index.emplace(key(e.family, address, e.number), entries.size());
+			entries.push_back(e);
+		}
+		return success;
+	}
+
+	entry const* file::find(unsigned short family, fmt::string::view address, fmt::string::view number) const
 	{
-		union {
-			char b[2];
-			unsigned short sz;
+		key const order[] =
+		{
+			{ family, address, number },
+			{ family, address, {} },
+			{ wild, {}, number },
+			{ wild, {}, {} },
 		};
 
-		if (in.get(b, 2))
+		for (auto const& k : order)
+		{
+			auto const it = index.find(k);
+			if (index.end() != it)
+			{
+				return entries.data() + it->second;
+			}
+		}
+		return nullptr;
+	}
+
+	std::shared_ptr<file const> load(fmt::string::view path)
+	{
+		static sys::exclusive<std::map<fmt::string, std::shared_ptr<file const>, std::less<>>> cache;
+
+		fmt::string const name(path);
+		struct sys::stat st(name.c_str());
+		if (sys::fail(st))
 		{
-			out.family = sz;
-		
-			auto ptr = 
-			{ 
-				&out.address, 
-				&out.number,
-				&out.name,
-				&out.data
-			};
+			return nullptr;
+		}
 
-			for (auto s : ptr)
+		// Same file unchanged since it was parsed
+		{
+			auto const reader = cache.read();
+			auto const it = reader->find(path);
+			if (reader->end() != it)
 			{
-				if (in.get(b, 2))
+				auto const& f = *it->second;
+				if (f.device == st.st_dev and f.inode == st.st_ino and f.modified == stamp(st) and f.size == st.st_size)
 				{
-					s->resize(sz);
-					if (in.get(s->data(), sz))
-					{
-						continue;
-					}
+					return it->second;
 				}
-				break;
 			}
 		}
-		return in;
+
+		auto ptr = std::make_shared<file>();
+		if (ptr->open(path))
+		{
+			return nullptr;
+		}
+		cache.write()->insert_or_assign(name, ptr);
+		return ptr;
 	}
 };
 
@@ -85,7 +227,7 @@ namespace x11
 		return u;
 	}
 
-	fmt::string setup(bytes::io::ref io, fmt::string::view proto, fmt::string::view data)
+	fmt::string setup(bytes::io::ref io, fmt::string::view proto, fmt::string::view data, layout* out)
 	{
 		fmt::string reason;
 
@@ -111,8 +253,2070 @@ namespace x11
 				reason.resize(prefix.lengthReason);
 				verify(io.read(reason.data(), prefix.lengthReason));
 			}
+			else
+			if (io and out)
+			{
+				if (out->read(io, prefix))
+				{
+					reason = "Malformed setup";
+				}
+			}
+			else
+			if (io)
+			{
+				verify(io.ignore(4 * static_cast<std::streamsize>(prefix.length)));
+			}
 		}
 
 		return reason;
 	}
+
+	bool layout::read(bytes::in::ref in, SetupPrefix const& prefix)
+	{
+		auto const size = 4 * static_cast<std::size_t>(prefix.length);
+		store.resize(prefix.length);
+		if (not in.read(reinterpret_cast<char*>(store.data()), size))
+		{
+			return failure;
+		}
+		swapped = false;
+		return split(size);
+	}
+
+	bool layout::parse(fmt::string::view data, char order)
+	{
+		store.resize((data.size() + 3) / 4);
+		std::memcpy(store.data(), data.data(), data.size());
+		swapped = native != order;
+		return split(data.size());
+	}
+
+	bool layout::split(std::size_t size)
+	{
+		auto const ptr = reinterpret_cast<char const*>(store.data());
+		std::size_t at = 0;
+
+		auto const take = [&](std::size_t bytes)
+		{
+			auto const start = ptr + at;
+			at += bytes;
+			return at <= size ? start : nullptr;
+		};
+
+		formats.clear();
+		screens.clear();
+		depths.clear();
+		visuals.clear();
+		index.clear();
+
+		auto const fixed = take(sz_xConnSetup);
+		if (nullptr == fixed)
+		{
+			return failure;
+		}
+
+		head = view<xConnSetup>(fixed, swapped);
+		std::size_t const length = head(&xConnSetup::nbytesVendor);
+		auto const name = take((length + 3) & ~3u);
+		if (nullptr == name)
+		{
+			return failure;
+		}
+		vendor = fmt::string::view(name, length);
+
+		for (auto n = head(&xConnSetup::numFormats); 0 < n; --n)
+		{
+			auto const format = take(sz_xPixmapFormat);
+			if (nullptr == format)
+			{
+				return failure;
+			}
+			formats.emplace_back(format, swapped);
+		}
+
+		for (auto n = head(&xConnSetup::numRoots); 0 < n; --n)
+		{
+			auto const root = take(sz_xWindowRoot);
+			if (nullptr == root)
+			{
+				return failure;
+			}
+
+			view<xWindowRoot> const v(root, swapped);
+			std::size_t const count = v(&xWindowRoot::nDepths);
+			screens.push_back({ v, depths.size(), count });
+
+			for (auto d = count; 0 < d; --d)
+			{
+				auto const deep = take(sz_xDepth);
+				if (nullptr == deep)
+				{
+					return failure;
+				}
+
+				view<xDepth> const w(deep, swapped);
+				std::size_t const visible = w(&xDepth::nVisuals);
+				depths.push_back({ w, visuals.size(), visible });
+
+				for (auto k = visible; 0 < k; --k)
+				{
+					auto const type = take(sz_xVisualType);
+					if (nullptr == type)
+					{
+						return failure;
+					}
+
+					auto const& visual = visuals.emplace_back(type, swapped);
+					index[visual(&xVisualType::visualID)] = visuals.size() - 1;
+				}
+			}
+		}
+
+		return success;
+	}
+
+	view<xVisualType> const* layout::visual(CARD32 id) const
+	{
+		auto const it = index.find(id);
+		return index.end() == it ? nullptr : visuals.data() + it->second;
+	}
 }
+
+namespace x11
+{
+	connection::~connection()
+	{
+		for (int const desc : fds)
+		{
+			(void) ::close(desc);
+		}
+
+		if (-1 != fd and -1 == ::close(fd))
+		{
+			sys::err(here, "close", fd);
+		}
+	}
+
+	int connection::open(int display)
+	{
+		sockaddr_un name;
+		std::memset(&name, 0, sizeof name);
+		name.sun_family = AF_UNIX;
+		auto const path = "/tmp/.X11-unix/X" + fmt::to_string(static_cast<long>(display), 10);
+		if (sizeof name.sun_path <= path.size())
+		{
+			sys::err(here, "path", path);
+			return -1;
+		}
+		std::memcpy(name.sun_path, path.data(), path.size());
+
+		int const sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (-1 == sock)
+		{
+			sys::err(here, "socket");
+			return -1;
+		}
+
+		auto const addr = reinterpret_cast<sockaddr const*>(&name);
+		if (-1 == ::connect(sock, addr, sizeof name))
+		{
+			sys::err(here, "connect", path);
+			(void) ::close(sock);
+			return -1;
+		}
+		return sock;
+	}
+
+	unsigned long long connection::widen(unsigned short low) const
+	{
+		// The server cannot have seen requests not yet written
+		auto const gap = static_cast<unsigned short>(static_cast<unsigned short>(written) - low);
+		return written - gap;
+	}
+
+	cookie connection::send(void const* req, std::size_t size, fmt::string::view data, bool reply)
+	{
+		if (not reply and 0xFFF0 <= sent - expect)
+		{
+			// Sync so that 16 bits always tell which request is meant
+			xReq sync;
+			std::memset(&sync, 0, sizeof sync);
+			sync.reqType = X_GetInputFocus;
+			sync.length = 1;
+			(void) ignore.insert(send(&sync, sz_xReq, {}, true).sequence);
+		}
+
+		auto const pad = (4 - data.size() % 4) % 4;
+		auto const total = size + data.size() + pad;
+		if (total % 4 or 0xFFFF < total / 4)
+		{
+			sys::err(here, "length", total);
+			return {};
+		}
+
+		auto const keep = [this](std::size_t at, std::size_t n)
+		{
+			if (not parts.empty() and nullptr == parts.back().data)
+			{
+				auto& back = parts.back();
+				if (back.at + back.size == at)
+				{
+					back.size += n;
+					return;
+				}
+			}
+			parts.push_back({ nullptr, at, n });
+		};
+
+		// Header with the length in four byte units
+		auto at = out.size();
+		out.append(static_cast<char const*>(req), size);
+		auto const length = static_cast<CARD16>(total / 4);
+		std::memcpy(out.data() + at + 2, &length, sizeof length);
+		keep(at, size);
+
+		// Large data is gathered from where it lies
+		if (limit / 16 <= data.size())
+		{
+			parts.push_back({ data.data(), 0, data.size() });
+		}
+		else
+		{
+			at = out.size();
+			out.append(data.data(), data.size());
+			keep(at, data.size());
+		}
+
+		if (0 < pad)
+		{
+			at = out.size();
+			out.append(pad, '\0');
+			keep(at, pad);
+		}
+
+		pending += total;
+		if (reply)
+		{
+			expect = sent + 1;
+			(void) checked.insert(expect);
+		}
+
+		cookie const id { ++ sent };
+		if (limit <= pending and flush())
+		{
+			return {};
+		}
+		return id;
+	}
+
+	void connection::pass(int desc)
+	{
+		fds.push_back(desc);
+	}
+
+	bool connection::flush()
+	{
+		fwd::vector<iovec> iov;
+		iov.reserve(parts.size());
+		for (auto const& p : parts)
+		{
+			auto const start = nullptr == p.data ? out.data() + p.at : p.data;
+			iov.push_back({ const_cast<char*>(start), p.size });
+		}
+
+		for (std::size_t first = 0; first < iov.size(); )
+		{
+			auto const count = std::min<std::size_t>(iov.size() - first, IOV_MAX);
+			ssize_t n;
+			if (fds.empty())
+			{
+				n = ::writev(fd, iov.data() + first, static_cast<int>(count));
+			}
+			else
+			{
+				// Descriptors ride along with the first bytes
+				fwd::vector<char> control(CMSG_SPACE(fds.size() * sizeof (int)));
+				msghdr msg;
+				std::memset(&msg, 0, sizeof msg);
+				msg.msg_iov = iov.data() + first;
+				msg.msg_iovlen = count;
+				msg.msg_control = control.data();
+				msg.msg_controllen = control.size();
+				auto const cmsg = CMSG_FIRSTHDR(&msg);
+				cmsg->cmsg_level = SOL_SOCKET;
+				cmsg->cmsg_type = SCM_RIGHTS;
+				cmsg->cmsg_len = CMSG_LEN(fds.size() * sizeof (int));
+				std::memcpy(CMSG_DATA(cmsg), fds.data(), fds.size() * sizeof (int));
+
+				n = ::sendmsg(fd, &msg, 0);
+				if (0 <= n)
+				{
+					for (int const desc : fds)
+					{
+						if (-1 == ::close(desc))
+						{
+							sys::err(here, "close", desc);
+						}
+					}
+					fds.clear();
+				}
+			}
+
+			if (n < 0)
+			{
+				if (EINTR == errno) continue;
+				sys::err(here, "writev", fd);
+				return failure;
+			}
+
+			// Skip what was written, keeping the rest of a partial vector
+			auto left = static_cast<std::size_t>(n);
+			while (first < iov.size() and iov[first].iov_len <= left)
+			{
+				left -= iov[first].iov_len;
+				++ first;
+			}
+			if (0 < left)
+			{
+				iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+				iov[first].iov_len -= left;
+			}
+		}
+
+		out.clear();
+		parts.clear();
+		pending = 0;
+		written = sent;
+		return success;
+	}
+
+	void connection::ids(CARD32 first, CARD32 range)
+	{
+		base = first;
+		mask = range;
+		next = 0;
+	}
+
+	CARD32 connection::xid()
+	{
+		// Step by the lowest bit of the mask
+		auto const step = mask & (~mask + 1);
+		if (0 == step or (next + step) & ~mask)
+		{
+			sys::err(here, "xid", base, mask);
+			return 0;
+		}
+		next += step;
+		return base | next;
+	}
+
+	fwd::span<char> decoder::space(std::size_t least)
+	{
+		// Move the partial packet at the end to the front
+		if (head == tail)
+		{
+			head = tail = 0;
+		}
+		else
+		if (0 < head)
+		{
+			std::memmove(bytes(), bytes() + head, tail - head);
+			tail -= head;
+			head = 0;
+		}
+
+		constexpr auto word = sizeof (CARD32);
+		if (store.size() * word < tail + least)
+		{
+			store.resize((tail + least + word - 1) / word);
+		}
+		return { bytes() + tail, store.size() * word - tail };
+	}
+
+	void decoder::commit(std::size_t size)
+	{
+		assert(tail + size <= store.size() * sizeof (CARD32));
+		tail += size;
+	}
+
+	bool decoder::fill(env::file::reader const& in)
+	{
+		auto const room = space();
+		auto const n = in.read(room.data(), room.size());
+		if (n <= 0)
+		{
+			return failure;
+		}
+		commit(static_cast<std::size_t>(n));
+		return success;
+	}
+
+	packet decoder::next()
+	{
+		if (size() < sz_xEvent)
+		{
+			return {};
+		}
+
+		auto const ptr = bytes() + head;
+		auto const type = ptr[0] & 0x7F;
+		std::size_t length = sz_xEvent;
+		if (X_Reply == type or GenericEvent == type)
+		{
+			CARD32 extra;
+			std::memcpy(&extra, ptr + 4, sizeof extra);
+			if (swapped) extra = x11::swap(extra);
+			length += 4 * static_cast<std::size_t>(extra);
+		}
+
+		if (size() < length)
+		{
+			return {};
+		}
+		head += length;
+		return { fmt::string::view(ptr, length), swapped };
+	}
+
+	bool connection::fill(bool wait)
+	{
+		auto const room = in.space();
+		auto const flags = wait ? 0 : MSG_DONTWAIT;
+		ssize_t n;
+		do n = ::recv(fd, room.data(), room.size(), flags);
+		while (n < 0 and EINTR == errno);
+
+		if (n < 0 and (EAGAIN == errno or EWOULDBLOCK == errno))
+		{
+			return success;
+		}
+		if (n <= 0)
+		{
+			if (n < 0) sys::err(here, "recv", fd);
+			return failure;
+		}
+		in.commit(static_cast<std::size_t>(n));
+		return success;
+	}
+
+	packet connection::parse(unsigned long long reply, int event)
+	{
+		while (auto const p = in.next())
+		{
+			auto const type = p.type();
+			if (KeymapNotify != type)
+			{
+				last = std::max(last, widen(p.sequence()));
+			}
+
+			if (X_Error == type or X_Reply == type)
+			{
+				auto const wanted = 0 < checked.erase(last);
+				if (0 < ignore.erase(last))
+				{
+					continue;
+				}
+				if (X_Reply == type and reply == last)
+				{
+					return p;
+				}
+				if (X_Reply == type or wanted)
+				{
+					replies[last] = bytes(p.data);
+				}
+				else
+				{
+					// Nothing is kept for requests that nobody checks
+					report(p);
+				}
+			}
+			else
+			if (any == event or type == event)
+			{
+				return p;
+			}
+			else
+			{
+				queue.emplace_back(p.data);
+			}
+		}
+		return {};
+	}
+
+	fmt::string::view connection::reply(cookie id)
+	{
+		if (written < id.sequence and flush())
+		{
+			return {};
+		}
+
+		for (;;)
+		{
+			auto const it = replies.find(id.sequence);
+			if (replies.end() != it)
+			{
+				if (X_Reply != it->second.front())
+				{
+					report({ it->second, in.swap() });
+					replies.erase(it);
+					return {};
+				}
+				held = std::move(it->second);
+				replies.erase(it);
+				return held;
+			}
+
+			// Buffered packets before it are kept and the reply itself is not copied
+			if (auto const p = parse(id.sequence))
+			{
+				return p.data;
+			}
+
+			if (replies.end() == replies.find(id.sequence) and fill())
+			{
+				return {};
+			}
+		}
+	}
+
+	bool connection::error(cookie id, xError* buf)
+	{
+		if (last < id.sequence and expect < id.sequence)
+		{
+			// Nothing later would reply so ask for something that does
+			xReq sync;
+			std::memset(&sync, 0, sizeof sync);
+			sync.reqType = X_GetInputFocus;
+			sync.length = 1;
+			(void) ignore.insert(send(&sync, sz_xReq, {}, true).sequence);
+		}
+
+		if (written < id.sequence and flush())
+		{
+			return failure;
+		}
+
+		// Packets left in the buffer by a reply come first
+		(void) parse();
+		while (last < id.sequence and replies.find(id.sequence) == replies.end())
+		{
+			if (fill())
+			{
+				return failure;
+			}
+			(void) parse();
+		}
+
+		auto const it = replies.find(id.sequence);
+		if (replies.end() != it and X_Error == it->second.front())
+		{
+			if (nullptr != buf)
+			{
+				std::memcpy(buf, it->second.data(), sz_xError);
+			}
+			replies.erase(it);
+			return failure;
+		}
+		return success;
+	}
+
+	bool connection::event(bytes::ref buf)
+	{
+		if (not queue.empty())
+		{
+			buf = std::move(queue.front());
+			queue.pop_front();
+			return success;
+		}
+
+		if (flush())
+		{
+			return failure;
+		}
+
+		for (;;)
+		{
+			// Copied straight into the space the caller keeps
+			if (auto const p = parse(0, any))
+			{
+				buf.assign(p.data);
+				return success;
+			}
+
+			if (fill())
+			{
+				return failure;
+			}
+		}
+	}
+
+	bool connection::event(bytes::ref buf, int type)
+	{
+		for (;;)
+		{
+			auto const it = std::find_if(queue.begin(), queue.end(), [type](auto const& ev)
+			{
+				return type == (ev.front() & 0x7F);
+			});
+
+			if (queue.end() != it)
+			{
+				buf = std::move(*it);
+				queue.erase(it);
+				return success;
+			}
+
+			if (auto const p = parse(0, type))
+			{
+				buf.assign(p.data);
+				return success;
+			}
+
+			if (flush() or fill())
+			{
+				return failure;
+			}
+		}
+	}
+
+	bool connection::poll(bytes::ref buf)
+	{
+		if (not queue.empty())
+		{
+			buf = std::move(queue.front());
+			queue.pop_front();
+			return success;
+		}
+
+		auto p = parse(0, any);
+		if (not p)
+		{
+			if (fill(false))
+			{
+				return failure;
+			}
+			p = parse(0, any);
+		}
+
+		if (not p)
+		{
+			return failure;
+		}
+		buf.assign(p.data);
+		return success;
+	}
+}
+
+namespace x11
+{
+	namespace
+	{
+		constexpr char const* predefined[] =
+		{
+			"PRIMARY", "SECONDARY", "ARC", "ATOM", "BITMAP", "CARDINAL",
+			"COLORMAP", "CURSOR", "CUT_BUFFER0", "CUT_BUFFER1", "CUT_BUFFER2",
+			"CUT_BUFFER3", "CUT_BUFFER4", "CUT_BUFFER5", "CUT_BUFFER6",
+			"CUT_BUFFER7", "DRAWABLE", "FONT", "INTEGER", "PIXMAP", "POINT",
+			"RECTANGLE", "RESOURCE_MANAGER", "RGB_COLOR_MAP", "RGB_BEST_MAP",
+			"RGB_BLUE_MAP", "RGB_DEFAULT_MAP", "RGB_GRAY_MAP", "RGB_GREEN_MAP",
+			"RGB_RED_MAP", "STRING", "VISUALID", "WINDOW", "WM_COMMAND",
+			"WM_HINTS", "WM_CLIENT_MACHINE", "WM_ICON_NAME", "WM_ICON_SIZE",
+			"WM_NAME", "WM_NORMAL_HINTS", "WM_SIZE_HINTS", "WM_ZOOM_HINTS",
+			"MIN_SPACE", "NORM_SPACE", "MAX_SPACE", "END_SPACE",
+			"SUPERSCRIPT_X", "SUPERSCRIPT_Y", "SUBSCRIPT_X", "SUBSCRIPT_Y",
+			"UNDERLINE_POSITION", "UNDERLINE_THICKNESS", "STRIKEOUT_ASCENT",
+			"STRIKEOUT_DESCENT", "ITALIC_ANGLE", "X_HEIGHT", "QUAD_WIDTH",
+			"WEIGHT", "POINT_SIZE", "RESOLUTION", "COPYRIGHT", "NOTICE",
+			"FONT_NAME", "FAMILY_NAME", "FULL_NAME", "CAP_HEIGHT", "WM_CLASS",
+			"WM_TRANSIENT_FOR",
+		};
+
+		static_assert(XA_LAST_PREDEFINED == std::size(predefined));
+	}
+
+	atoms::atoms(connection& c, fmt::string::view::init list) : conn(c)
+	{
+		// Server defines these ids without being asked
+		for (CARD32 id = 1; id <= XA_LAST_PREDEFINED; ++id)
+		{
+			learn(fmt::put(predefined[id - 1]), id);
+		}
+
+		for (auto const name : list)
+		{
+			want(name);
+		}
+
+		if (resolve())
+		{
+			sys::warn(here, "atoms", list.size());
+		}
+	}
+
+	void atoms::learn(fmt::name key, CARD32 id)
+	{
+		ids[key] = id;
+		names[id] = key;
+	}
+
+	void atoms::want(fmt::string::view name, bool exists)
+	{
+		auto const key = fmt::put(name);
+		if (interning.contains(key))
+		{
+			return;
+		}
+
+		auto const it = ids.find(key);
+		if (ids.end() != it and (None != it->second or exists))
+		{
+			return;
+		}
+
+		InternAtom req;
+		req.onlyIfExists = exists;
+		req.nbytes = static_cast<CARD16>(name.size());
+		interning[key] = conn.send(req, name);
+	}
+
+	void atoms::want(CARD32 id)
+	{
+		if (None == id or names.contains(id) or naming.contains(id))
+		{
+			return;
+		}
+
+		GetAtomName req;
+		req.id = id;
+		naming[id] = conn.send(req);
+	}
+
+	bool atoms::resolve()
+	{
+		if (interning.empty() and naming.empty())
+		{
+			return success;
+		}
+
+		bool result = conn.flush();
+		for (auto const& [key, id] : interning)
+		{
+			auto const rep = conn.reply(id);
+			if (rep.size() < sz_xInternAtomReply)
+			{
+				// Missing like a name which does not exist
+				ids[key] = None;
+				result = failure;
+				continue;
+			}
+
+			xInternAtomReply atom;
+			std::memcpy(&atom, rep.data(), sz_xInternAtomReply);
+			if (None != atom.atom)
+			{
+				learn(key, atom.atom);
+			}
+			else
+			{
+				ids[key] = None;
+			}
+		}
+		interning.clear();
+
+		for (auto const& [atom, id] : naming)
+		{
+			auto const rep = conn.reply(id);
+			if (rep.size() < sz_xGetAtomNameReply)
+			{
+				// No name rather than asking again
+				names[atom] = fmt::put({});
+				result = failure;
+				continue;
+			}
+
+			xGetAtomNameReply name;
+			std::memcpy(&name, rep.data(), sz_xGetAtomNameReply);
+			auto const data = fmt::string::view(rep).substr(sz_xGetAtomNameReply, name.nameLength);
+			learn(fmt::put(data), atom);
+		}
+		naming.clear();
+
+		return result;
+	}
+
+	CARD32 atoms::find(fmt::string::view name) const
+	{
+		if (not fmt::got(name))
+		{
+			return None;
+		}
+		auto const it = ids.find(fmt::put(name));
+		return ids.end() == it ? None : it->second;
+	}
+
+	fmt::string::view atoms::find(CARD32 id) const
+	{
+		auto const it = names.find(id);
+		return names.end() == it ? fmt::string::view() : fmt::get(it->second);
+	}
+
+	CARD32 atoms::operator[](fmt::string::view name)
+	{
+		auto id = find(name);
+		if (None == id)
+		{
+			want(name);
+			(void) resolve();
+			id = find(name);
+		}
+		return id;
+	}
+
+	fmt::string::view atoms::operator[](CARD32 id)
+	{
+		auto name = find(id);
+		if (name.empty())
+		{
+			want(id);
+			(void) resolve();
+			name = find(id);
+		}
+		return name;
+	}
+}
+
+namespace x11::shm
+{
+	bool query(connection& conn, CARD8& major, CARD8& event)
+	{
+		constexpr fmt::string::view name = "MIT-SHM";
+		QueryExtension ext;
+		ext.nbytes = static_cast<CARD16>(name.size());
+		auto const rep = conn.reply(conn.send(ext, name));
+		if (rep.size() < sz_xQueryExtensionReply)
+		{
+			return failure;
+		}
+
+		xQueryExtensionReply info;
+		std::memcpy(&info, rep.data(), sz_xQueryExtensionReply);
+		if (not info.present)
+		{
+			return failure;
+		}
+
+		ShmQueryVersion query(info.major_opcode);
+		auto const ver = conn.reply(conn.send(query));
+		if (ver.size() < sz_xShmQueryVersionReply)
+		{
+			return failure;
+		}
+
+		// Descriptors can be attached since version 1.2
+		xShmQueryVersionReply version;
+		std::memcpy(&version, ver.data(), sz_xShmQueryVersionReply);
+		if (version.majorVersion < 1 or (1 == version.majorVersion and version.minorVersion < 2))
+		{
+			return failure;
+		}
+
+		major = info.major_opcode;
+		event = info.first_event;
+		return success;
+	}
+
+	pool::pool(connection& c, CARD8 op, CARD8 ev, std::size_t n)
+	: conn(c), major(op), event(ev), count(n)
+	{ }
+
+	pool::~pool()
+	{
+		for (auto& s : segments)
+		{
+			detach(s);
+		}
+		(void) conn.flush();
+	}
+
+	bool pool::attach(segment& s, std::size_t size)
+	{
+		auto const page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+		size = (size + page - 1) / page * page;
+
+		// Name is unlinked at once so only descriptors refer to it
+		static std::atomic<unsigned> serial = 0; // pools on other threads count too
+		auto const pid = static_cast<long>(::getpid());
+		auto const name = "/x11-shm-" + fmt::to_string(pid, 10) + "-" + fmt::to_string(static_cast<long>(++ serial), 10);
+		auto desc = sys::uni::shm::open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (sys::fail(desc.get()))
+		{
+			return failure;
+		}
+		(void) ::shm_unlink(name.c_str());
+
+		if (sys::fail(::ftruncate(desc.get(), static_cast<off_t>(size))))
+		{
+			sys::err(here, "ftruncate", size);
+			return failure;
+		}
+
+		auto map = sys::uni::shm::map(size, PROT_READ | PROT_WRITE, MAP_SHARED, desc.get());
+		if (MAP_FAILED == map.get())
+		{
+			return failure;
+		}
+
+		auto const id = conn.xid();
+		if (0 == id)
+		{
+			return failure;
+		}
+
+		ShmAttachFd req(major);
+		req.shmseg = id;
+		req.readOnly = false;
+		conn.pass(desc.set());
+		(void) conn.send(req);
+
+		s.id = id;
+		s.map = std::move(map);
+		s.size = size;
+		s.busy = false;
+		return success;
+	}
+
+	void pool::detach(segment& s)
+	{
+		if (0 != s.id)
+		{
+			ShmDetach req(major);
+			req.shmseg = s.id;
+			(void) conn.send(req);
+		}
+		s.id = 0;
+		s.map.reset();
+		s.size = 0;
+	}
+
+	segment* pool::acquire(std::size_t size)
+	{
+		for (;;)
+		{
+			segment* spare = nullptr;
+			for (auto& s : segments)
+			{
+				if (not s.busy)
+				{
+					if (size <= s.size)
+					{
+						s.busy = true;
+						return &s;
+					}
+					spare = &s;
+				}
+			}
+
+			if (segments.size() < count)
+			{
+				auto& s = segments.emplace_back();
+				if (attach(s, size))
+				{
+					segments.pop_back();
+					return nullptr;
+				}
+				s.busy = true;
+				return &s;
+			}
+
+			if (nullptr != spare)
+			{
+				// Replace a free segment that is too small
+				detach(*spare);
+				if (attach(*spare, size))
+				{
+					return nullptr;
+				}
+				spare->busy = true;
+				return spare;
+			}
+
+			if (wait())
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	void pool::release(segment& s)
+	{
+		s.busy = false;
+	}
+
+	cookie pool::put(segment& s, ShmPutImage& req)
+	{
+		req.reqType = major;
+		req.shmseg = s.id;
+		req.sendEvent = true;
+		s.busy = true;
+		return conn.send(req);
+	}
+
+	bytes pool::get(segment& s, ShmGetImage& req)
+	{
+		req.reqType = major;
+		req.shmseg = s.id;
+		s.busy = true;
+		return bytes(conn.reply(conn.send(req)));
+	}
+
+	bool pool::wait()
+	{
+		bytes buf;
+		if (conn.event(buf, event + ShmCompletion))
+		{
+			return failure;
+		}
+
+		xShmCompletionEvent done;
+		std::memcpy(&done, buf.data(), sz_xShmCompletionEvent);
+		for (auto& s : segments)
+		{
+			if (done.shmseg == s.id)
+			{
+				s.busy = false;
+			}
+		}
+		return success;
+	}
+}
+
+#if defined(test_unit) || defined(bench_unit)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+	using Pointer = decltype(xEvent::u.keyButtonPointer);
+
+	struct memory : env::file::reader
+	// Stream of packets handed out a few bytes at a time
+	{
+		fmt::string::view data;
+		std::size_t step;
+		mutable std::size_t at = 0;
+
+		memory(fmt::string::view data, std::size_t step) : data(data), step(step)
+		{ }
+
+		ssize_t read(fwd::as_ptr<void> buf, std::size_t sz) const override
+		{
+			auto const n = std::min({ sz, step, data.size() - at });
+			std::memcpy(buf, data.data() + at, n);
+			at += n;
+			return static_cast<ssize_t>(n);
+		}
+	};
+
+	template <class Type> void put(x11::bytes& s, Type value, bool swap)
+	{
+		if (swap) value = x11::swap(value);
+		s.append(reinterpret_cast<char const*>(&value), sizeof value);
+	}
+
+	x11::bytes stream(std::size_t count, char order)
+	// Pointer and key events with a property reply every so often
+	{
+		bool const swap = x11::native != order;
+		x11::bytes s;
+		for (std::size_t n = 0; n < count; ++n)
+		{
+			auto const seq = static_cast<CARD16>(n);
+			if (63 == n % 64)
+			{
+				auto const items = static_cast<CARD32>(n % 16);
+				put<CARD8>(s, X_Reply, swap);
+				put<CARD8>(s, 32, swap);
+				put<CARD16>(s, seq, swap);
+				put<CARD32>(s, items, swap);
+				put<CARD32>(s, XA_INTEGER, swap);
+				put<CARD32>(s, 0, swap);
+				put<CARD32>(s, items, swap);
+				s.append(12, '\0');
+				for (CARD32 item = 0; item < items; ++item)
+				{
+					put<CARD32>(s, static_cast<CARD32>(n) + item, swap);
+				}
+				continue;
+			}
+
+			constexpr CARD8 types[] = { MotionNotify, KeyPress, ButtonPress };
+			put<CARD8>(s, types[n % 3], swap);
+			put<CARD8>(s, static_cast<CARD8>(n), swap);
+			put<CARD16>(s, seq, swap);
+			put<CARD32>(s, static_cast<CARD32>(n), swap);
+			put<CARD32>(s, 1, swap);
+			put<CARD32>(s, 2, swap);
+			put<CARD32>(s, 0, swap);
+			put<INT16>(s, static_cast<INT16>(n % 1000), swap);
+			put<INT16>(s, static_cast<INT16>(n % 700), swap);
+			put<INT16>(s, 0, swap);
+			put<INT16>(s, 0, swap);
+			put<CARD16>(s, 0, swap);
+			put<CARD8>(s, 1, swap);
+			put<CARD8>(s, 0, swap);
+		}
+		return s;
+	}
+}
+
+namespace
+{
+	class mock : fwd::unique
+	// Server end of a socket pair that checks the framing it reads
+	{
+		struct segment
+		{
+			char* data;
+			std::size_t size;
+		};
+
+		int fd;
+		unsigned short sequence = 0;
+		std::map<CARD32, fmt::string> interned;
+		std::map<CARD32, segment> segments;
+		std::deque<int> fds;
+
+		bool read(void* buf, std::size_t size)
+		{
+			auto ptr = static_cast<char*>(buf);
+			while (0 < size)
+			{
+				// Keep any descriptors that were passed along
+				char control[CMSG_SPACE(4 * sizeof (int))];
+				iovec iov { ptr, size };
+				msghdr msg;
+				std::memset(&msg, 0, sizeof msg);
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				msg.msg_control = control;
+				msg.msg_controllen = sizeof control;
+
+				auto const n = ::recvmsg(fd, &msg, 0);
+				if (n <= 0) return failure;
+
+				for (auto cmsg = CMSG_FIRSTHDR(&msg); nullptr != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+				{
+					if (SOL_SOCKET == cmsg->cmsg_level and SCM_RIGHTS == cmsg->cmsg_type)
+					{
+						auto const count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof (int);
+						for (std::size_t k = 0; k < count; ++k)
+						{
+							int desc;
+							std::memcpy(&desc, CMSG_DATA(cmsg) + k * sizeof desc, sizeof desc);
+							fds.push_back(desc);
+						}
+					}
+				}
+
+				ptr += n;
+				size -= static_cast<std::size_t>(n);
+			}
+			return success;
+		}
+
+		void write(void const* buf, std::size_t size)
+		{
+			if (static_cast<ssize_t>(size) != ::send(fd, buf, size, 0))
+			{
+				++ broken;
+			}
+		}
+
+		void reply(CARD32 extra, void* head, fmt::string::view data = {})
+		{
+			auto const rep = static_cast<xGenericReply*>(head);
+			rep->type = X_Reply;
+			rep->sequenceNumber = sequence;
+			rep->length = extra;
+			write(head, sz_xReply);
+			write(data.data(), data.size());
+			fmt::string const pad(4 * extra - data.size(), '\0');
+			write(pad.data(), pad.size());
+		}
+
+		void error(CARD8 code, CARD8 major)
+		{
+			xError error;
+			std::memset(&error, 0, sizeof error);
+			error.type = X_Error;
+			error.errorCode = code;
+			error.sequenceNumber = sequence;
+			error.majorCode = major;
+			write(&error, sz_xError);
+		}
+
+		void shm(char const* buf, std::size_t size)
+		{
+			switch (buf[1])
+			{
+			case X_ShmQueryVersion:
+				{
+					xShmQueryVersionReply rep;
+					std::memset(&rep, 0, sizeof rep);
+					rep.majorVersion = 1;
+					rep.minorVersion = 2;
+					reply(0, &rep);
+				}
+				break;
+
+			case X_ShmAttachFd:
+				{
+					xShmAttachFdReq req;
+					std::memcpy(&req, buf, sz_xShmAttachFdReq);
+					struct stat st;
+					if (fds.empty() or size != sz_xShmAttachFdReq or -1 == ::fstat(fds.front(), &st))
+					{
+						++ broken;
+						break;
+					}
+
+					auto const length = static_cast<std::size_t>(st.st_size);
+					auto const ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fds.front(), 0);
+					(void) ::close(fds.front());
+					fds.pop_front();
+					if (MAP_FAILED == ptr)
+					{
+						++ broken;
+						break;
+					}
+
+					segments[req.shmseg] = { static_cast<char*>(ptr), length };
+					++ attached;
+				}
+				break;
+
+			case X_ShmDetach:
+				{
+					xShmDetachReq req;
+					std::memcpy(&req, buf, sz_xShmDetachReq);
+					auto const it = segments.find(req.shmseg);
+					if (segments.end() == it)
+					{
+						error(BadValue, shmop);
+						break;
+					}
+					(void) ::munmap(it->second.data, it->second.size);
+					segments.erase(it);
+					++ detached;
+				}
+				break;
+
+			case X_ShmPutImage:
+				{
+					xShmPutImageReq req;
+					std::memcpy(&req, buf, sz_xShmPutImageReq);
+					auto const it = segments.find(req.shmseg);
+					auto const length = 4 * std::size_t(req.totalWidth) * req.totalHeight;
+					if (segments.end() == it or it->second.size < req.offset + length)
+					{
+						error(BadValue, shmop);
+						break;
+					}
+
+					auto const ptr = it->second.data + req.offset;
+					checksum = std::accumulate(ptr, ptr + length, checksum);
+
+					if (req.sendEvent)
+					{
+						xShmCompletionEvent done;
+						std::memset(&done, 0, sizeof done);
+						done.type = shmevent + ShmCompletion;
+						done.sequenceNumber = sequence;
+						done.drawable = req.drawable;
+						done.minorEvent = X_ShmPutImage;
+						done.majorEvent = shmop;
+						done.shmseg = req.shmseg;
+						done.offset = req.offset;
+						write(&done, sz_xShmCompletionEvent);
+					}
+				}
+				break;
+
+			case X_ShmGetImage:
+				{
+					xShmGetImageReq req;
+					std::memcpy(&req, buf, sz_xShmGetImageReq);
+					auto const it = segments.find(req.shmseg);
+					auto const length = 4 * std::size_t(req.width) * req.height;
+					if (segments.end() == it or it->second.size < req.offset + length)
+					{
+						error(BadValue, shmop);
+						break;
+					}
+
+					std::memset(it->second.data + req.offset, sequence & 0xFF, length);
+					xShmGetImageReply rep;
+					std::memset(&rep, 0, sizeof rep);
+					rep.depth = 24;
+					rep.size = static_cast<CARD32>(length);
+					reply(0, &rep);
+				}
+				break;
+
+			default:
+				++ broken;
+			}
+		}
+
+	public:
+
+		static constexpr CARD8 shmop = 130, shmevent = 80;
+		std::size_t requests = 0, broken = 0, attached = 0, detached = 0;
+		unsigned long long checksum = 0;
+		bool noisy = true;
+
+		explicit mock(int fd) : fd(fd)
+		{ }
+
+		~mock()
+		{
+			for (auto const& [id, s] : segments)
+			{
+				(void) ::munmap(s.data, s.size);
+			}
+			for (int const desc : fds)
+			{
+				(void) ::close(desc);
+			}
+			(void) ::close(fd);
+		}
+
+		void run()
+		{
+			fwd::vector<char> store(1 << 18);
+			for (auto const buf = store.data(); not read(buf, sz_xReq); )
+			{
+				xReq head;
+				std::memcpy(&head, buf, sz_xReq);
+				auto const size = 4 * static_cast<std::size_t>(head.length);
+				if (size < sz_xReq or store.size() < size or read(buf + sz_xReq, size - sz_xReq))
+				{
+					++ broken;
+					return;
+				}
+
+				++ sequence;
+				++ requests;
+
+				// An event arrives ahead of every tenth reply
+				if (noisy and 0 == sequence % 10)
+				{
+					xEvent event;
+					std::memset(&event, 0, sizeof event);
+					event.u.u.type = MotionNotify;
+					event.u.u.sequenceNumber = sequence;
+					write(&event, sz_xEvent);
+				}
+
+				switch (head.reqType)
+				{
+				case X_InternAtom:
+					{
+						xInternAtomReq req;
+						std::memcpy(&req, buf, sz_xInternAtomReq);
+						auto const pad = (4 - req.nbytes % 4) % 4;
+						fmt::string::view const name(buf + sz_xInternAtomReq, req.nbytes);
+						if (size != sz_xInternAtomReq + req.nbytes + pad or name.substr(0, 5) != "ATOM_")
+						{
+							++ broken;
+						}
+						xInternAtomReply rep;
+						std::memset(&rep, 0, sizeof rep);
+						auto const known = std::any_of(interned.begin(), interned.end(), [name](auto const& pair)
+						{
+							return name == pair.second;
+						});
+						if (known or not req.onlyIfExists)
+						{
+							rep.atom = 100u + sequence;
+							interned[rep.atom] = name;
+						}
+						reply(0, &rep);
+					}
+					break;
+
+				case X_GetAtomName:
+					{
+						xResourceReq req;
+						std::memcpy(&req, buf, sz_xResourceReq);
+						auto const it = interned.find(req.id);
+						if (interned.end() == it)
+						{
+							error(BadAtom, X_GetAtomName);
+							break;
+						}
+						auto const& name = it->second;
+						xGetAtomNameReply rep;
+						std::memset(&rep, 0, sizeof rep);
+						rep.nameLength = static_cast<CARD16>(name.size());
+						reply(static_cast<CARD32>(name.size() + 3) / 4, &rep, name);
+					}
+					break;
+
+				case X_GetProperty:
+					{
+						xGetPropertyReq req;
+						std::memcpy(&req, buf, sz_xGetPropertyReq);
+						if (size != sz_xGetPropertyReq)
+						{
+							++ broken;
+						}
+						// Lengths are in units of four bytes, however many bits an item has
+						fmt::string const data(4 * std::size_t(req.longLength), static_cast<char>('a' + sequence % 26));
+						xGetPropertyReply rep;
+						std::memset(&rep, 0, sizeof rep);
+						rep.format = 8;
+						rep.nItems = static_cast<CARD32>(data.size());
+						rep.propertyType = req.type;
+						reply(req.longLength, &rep, data);
+					}
+					break;
+
+				case X_GetInputFocus:
+					{
+						xGetInputFocusReply rep;
+						std::memset(&rep, 0, sizeof rep);
+						reply(0, &rep);
+					}
+					break;
+
+				case X_DeleteProperty:
+					error(BadAtom, X_DeleteProperty);
+					break;
+
+				case X_QueryExtension:
+					{
+						xQueryExtensionReq req;
+						std::memcpy(&req, buf, sz_xQueryExtensionReq);
+						fmt::string::view const name(buf + sz_xQueryExtensionReq, req.nbytes);
+						xQueryExtensionReply rep;
+						std::memset(&rep, 0, sizeof rep);
+						rep.present = "MIT-SHM" == name;
+						rep.major_opcode = rep.present ? shmop : 0;
+						rep.first_event = rep.present ? shmevent : 0;
+						reply(0, &rep);
+					}
+					break;
+
+				case X_PutImage:
+					{
+						xPutImageReq req;
+						std::memcpy(&req, buf, sz_xPutImageReq);
+						auto const length = 4 * std::size_t(req.width) * req.height;
+						if (size < sz_xPutImageReq + length)
+						{
+							++ broken;
+							break;
+						}
+						auto const ptr = buf + sz_xPutImageReq;
+						checksum = std::accumulate(ptr, ptr + length, checksum);
+					}
+					break;
+
+				case shmop:
+					shm(buf, size);
+					break;
+
+				case X_NoOperation:
+					break;
+
+				default:
+					++ broken;
+				}
+			}
+		}
+	};
+}
+#endif
+
+#ifdef test_unit
+test_unit(x11)
+{
+	int fd[2];
+	verify(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fd));
+	x11::connection client(fd[0]);
+	mock server(fd[1]);
+	std::thread thread([&server] { server.run(); });
+
+	// Many round trips queued ahead of a single flush
+	fwd::vector<fmt::string> names;
+	fwd::vector<x11::cookie> atoms, props;
+	for (int n = 0; n < 64; ++n)
+	{
+		names.push_back("ATOM_" + fmt::to_string(static_cast<long>(n), 10));
+		x11::InternAtom req;
+		req.nbytes = static_cast<CARD16>(names.back().size());
+		atoms.push_back(client.send(req, names.back()));
+
+		x11::GetProperty get;
+		get.longLength = static_cast<CARD32>(n);
+		get.type = XA_STRING;
+		props.push_back(client.send(get));
+
+		x11::NoOperation nop;
+		(void) client.send(nop);
+	}
+
+	x11::DeleteProperty del;
+	auto const bad = client.check(client.send(del));
+	auto const lost = client.send(del);
+	assert(not client.flush());
+
+	// Replies are matched whatever order they are asked for
+	for (auto n = atoms.size(); 0 < n--; )
+	{
+		auto const rep = client.reply(atoms[n]);
+		assert(sz_xInternAtomReply == rep.size());
+		xInternAtomReply atom;
+		std::memcpy(&atom, rep.data(), sz_xInternAtomReply);
+		assert(100 + atoms[n].sequence == atom.atom);
+	}
+
+	for (std::size_t n = 0; n < props.size(); ++n)
+	{
+		auto const rep = client.reply(props[n]);
+		xGetPropertyReply prop;
+		assert(sz_xGetPropertyReply + 4 * n == rep.size());
+		std::memcpy(&prop, rep.data(), sz_xGetPropertyReply);
+		assert(4 * n == prop.nItems);
+		assert(XA_STRING == prop.propertyType);
+		auto const c = static_cast<char>('a' + props[n].sequence % 26);
+		assert(fmt::string(4 * n, c) == rep.substr(sz_xGetPropertyReply));
+	}
+
+	xError error;
+	assert(client.error(bad, &error));
+	assert(BadAtom == error.errorCode);
+	assert(not client.error(atoms.front()));
+	assert(not client.error(lost)); // reported rather than kept
+
+	// Events were queued in between the replies
+	std::size_t events = 0;
+	for (x11::bytes event; not client.poll(event); ++ events)
+	{
+		assert(MotionNotify == event.front());
+	}
+	assert(server.requests / 10 == events);
+
+	(void) ::shutdown(fd[0], SHUT_WR);
+	thread.join();
+	assert(0 == server.broken);
+	assert(3 * 64 + 1 <= server.requests);
+}
+
+test_unit(atom)
+{
+	int fd[2];
+	verify(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fd));
+	x11::connection client(fd[0]);
+	mock server(fd[1]);
+	std::thread thread([&server] { server.run(); });
+
+	// Predefined atoms are known without asking
+	x11::atoms cache(client, { "ATOM_FIRST", "ATOM_SECOND" });
+	assert(XA_WM_NAME == cache.find("WM_NAME"));
+	assert("STRING" == cache[XA_STRING]);
+	assert(None != cache.find("ATOM_FIRST"));
+	assert(None != cache.find("ATOM_SECOND"));
+
+	// Many names are resolved in one round trip
+	fwd::vector<fmt::string> names;
+	for (int n = 0; n < 32; ++n)
+	{
+		names.push_back("ATOM_" + fmt::to_string(static_cast<long>(n), 10));
+		cache.want(names.back());
+	}
+	assert(None == cache.find(names.front()));
+	assert(not cache.resolve());
+
+	for (auto const& name : names)
+	{
+		auto const id = cache.find(name);
+		assert(None != id);
+		assert(name == cache.find(id));
+		cache.want(name);
+	}
+	assert(not cache.resolve());
+
+	// Names of ids seen elsewhere are asked for
+	x11::atoms other(client);
+	assert(names[3] == other[cache.find(names[3])]);
+	assert(cache.find(names[3]) == other.find(names[3]));
+	assert(other[9999].empty());
+	assert(other[9999].empty()); // without asking again
+
+	// Names which do not exist are remembered too
+	cache.want("ATOM_MISSING", true);
+	assert(not cache.resolve());
+	assert(None == cache.find("ATOM_MISSING"));
+	cache.want("ATOM_MISSING", true);
+	assert(not cache.resolve());
+
+	(void) ::shutdown(fd[0], SHUT_WR);
+	thread.join();
+	assert(0 == server.broken);
+	assert(2 + 32 + 2 + 1 == server.requests);
+}
+
+test_unit(setup)
+{
+	constexpr int roots = 2, deep = 2, types = 3;
+	for (char const order : { 'l', 'B' })
+	{
+		bool const swap = x11::native != order;
+		fmt::string::view const vendor = "Oasys";
+
+		x11::bytes block;
+		put<CARD32>(block, 12000000, swap);
+		put<CARD32>(block, 0x200000, swap);
+		put<CARD32>(block, 0x1FFFFF, swap);
+		put<CARD32>(block, 256, swap);
+		put<CARD16>(block, static_cast<CARD16>(vendor.size()), swap);
+		put<CARD16>(block, 0xFFFF, swap);
+		put<CARD8>(block, roots, swap);
+		put<CARD8>(block, 2, swap);
+		block.append(6, '\0');
+		put<CARD32>(block, 0, swap);
+		block.append(vendor);
+		block.append(3, '\0');
+
+		for (CARD8 const format : { 1, 24 })
+		{
+			put<CARD8>(block, format, swap);
+			put<CARD8>(block, 1 == format ? 1 : 32, swap);
+			put<CARD8>(block, 32, swap);
+			block.append(5, '\0');
+		}
+
+		CARD32 id = 0x20;
+		for (int r = 0; r < roots; ++r)
+		{
+			put<CARD32>(block, 0x100 + r, swap);
+			block.append(16, '\0');
+			put<CARD16>(block, 1920, swap);
+			put<CARD16>(block, 1080, swap);
+			block.append(8, '\0');
+			put<CARD32>(block, id, swap);
+			block.append(3, '\0');
+			put<CARD8>(block, deep, swap);
+
+			for (int d = 0; d < deep; ++d)
+			{
+				put<CARD8>(block, static_cast<CARD8>(24 + 8 * d), swap);
+				put<CARD8>(block, 0, swap);
+				put<CARD16>(block, types, swap);
+				put<CARD32>(block, 0, swap);
+
+				for (int t = 0; t < types; ++t)
+				{
+					put<CARD32>(block, id++, swap);
+					put<CARD8>(block, TrueColor, swap);
+					put<CARD8>(block, 8, swap);
+					put<CARD16>(block, 256, swap);
+					put<CARD32>(block, 0xFF0000, swap);
+					put<CARD32>(block, 0x00FF00, swap);
+					put<CARD32>(block, 0x0000FF, swap);
+					put<CARD32>(block, 0, swap);
+				}
+			}
+		}
+
+		// Everything is indexed in one pass
+		x11::layout setup;
+		assert(not setup.parse(block, order));
+		assert(vendor == setup.vendor);
+		assert(0xFFFF == setup.head(&xConnSetup::maxRequestSize));
+		assert(2 == setup.formats.size());
+		assert(24 == setup.formats.back()(&xPixmapFormat::depth));
+		assert(roots == setup.screens.size());
+		assert(roots * deep == setup.depths.size());
+		assert(roots * deep * types == setup.visuals.size());
+
+		auto const& second = setup.screens[1];
+		assert(0x101 == second.root(&xWindowRoot::windowId));
+		assert(1080 == second.root(&xWindowRoot::pixHeight));
+		assert(deep == second.count);
+
+		auto const& last = setup.depths[second.first + second.count - 1];
+		assert(32 == last.head(&xDepth::depth));
+		assert(types == last.count);
+
+		auto const root = second.root(&xWindowRoot::rootVisualID);
+		auto const visual = setup.visual(root);
+		assert(nullptr != visual);
+		assert(root == (*visual)(&xVisualType::visualID));
+		assert(0xFF0000 == (*visual)(&xVisualType::redMask));
+		assert(nullptr == setup.visual(id));
+
+		// Truncated blocks are refused
+		assert(setup.parse(fmt::string::view(block).substr(0, block.size() - 4), order));
+		assert(setup.parse(fmt::string::view(block).substr(0, 20), order));
+
+		// Read straight from the stream after the prefix
+		if (not swap)
+		{
+			x11::SetupPrefix prefix;
+			prefix.length = static_cast<CARD16>(block.size() / 4);
+			fmt::string::stream in(block);
+			assert(not setup.read(in, prefix));
+			assert(roots * deep * types == setup.index.size());
+		}
+	}
+}
+
+test_unit(shm)
+{
+	int fd[2];
+	verify(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fd));
+	x11::connection client(fd[0]);
+	client.ids(0x200000, 0x1FFFFF);
+	mock server(fd[1]);
+	std::thread thread([&server] { server.run(); });
+
+	CARD8 major, event;
+	assert(not x11::shm::query(client, major, event));
+	assert(mock::shmop == major);
+	assert(mock::shmevent == event);
+
+	constexpr CARD16 width = 64, height = 48;
+	constexpr std::size_t size = 4 * width * height;
+	unsigned long long sum = 0;
+	{
+		// Two segments are cycled through by completion events
+		x11::shm::pool pool(client, major, event, 2);
+		for (int frame = 1; frame <= 6; ++frame)
+		{
+			auto const seg = pool.acquire(size);
+			assert(nullptr != seg);
+			if (nullptr == seg)
+			{
+				break;
+			}
+			assert(size <= seg->size);
+			std::memset(seg->data(), frame, size);
+			sum += frame * size;
+
+			x11::ShmPutImage req;
+			req.drawable = 1;
+			req.gc = 2;
+			req.totalWidth = req.srcWidth = width;
+			req.totalHeight = req.srcHeight = height;
+			req.depth = 24;
+			req.format = ZPixmap;
+			(void) pool.put(*seg, req);
+		}
+
+		// Images come back through the segment too
+		auto const seg = pool.acquire(size);
+		assert(nullptr != seg);
+		if (nullptr != seg)
+		{
+			x11::ShmGetImage req;
+			req.drawable = 1;
+			req.width = width;
+			req.height = height;
+			req.planeMask = ~0u;
+			req.format = ZPixmap;
+			auto const rep = pool.get(*seg, req);
+			assert(sz_xShmGetImageReply == rep.size());
+			xShmGetImageReply image;
+			std::memcpy(&image, rep.data(), sz_xShmGetImageReply);
+			assert(size == image.size);
+			assert(seg->data()[0] == seg->data()[size - 1]);
+			assert(0 != seg->data()[0]);
+			pool.release(*seg);
+		}
+	}
+
+	(void) ::shutdown(fd[0], SHUT_WR);
+	thread.join();
+	assert(0 == server.broken);
+	assert(2 == server.attached);
+	assert(2 == server.detached);
+	assert(sum == server.checksum);
+}
+
+test_unit(auth)
+{
+	auto const record = [](x11::bytes& s, unsigned short family, fmt::string::view::init fields)
+	{
+		s += static_cast<char>(family >> 8);
+		s += static_cast<char>(family & 0xFF);
+		for (auto const field : fields)
+		{
+			s += static_cast<char>(field.size() >> 8);
+			s += static_cast<char>(field.size() & 0xFF);
+			s += field;
+		}
+	};
+
+	fmt::string::view const loopback("\x7F\0\0\x01", 4);
+	x11::bytes data;
+	record(data, x11::auth::local, { "host", "0", "MIT-MAGIC-COOKIE-1", "first" });
+	record(data, x11::auth::local, { "host", "0", "MIT-MAGIC-COOKIE-1", "shadowed" });
+	record(data, x11::auth::local, { "host", "", "MIT-MAGIC-COOKIE-1", "any" });
+	record(data, x11::auth::wild, { "ignored", "7", "MIT-MAGIC-COOKIE-1", "wild" });
+
+	auto const path = fmt::dir::join({ env::temp(), "oasys.xauth" });
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << data;
+	}
+
+	// Lookups fall back to any display then to wild families
+	auto const auth = x11::auth::load(path);
+	assert(nullptr != auth);
+	assert(4 == auth->records().size());
+	assert("first" == auth->find(x11::auth::local, "host", "0")->data);
+	assert("any" == auth->find(x11::auth::local, "host", "1")->data);
+	assert("wild" == auth->find(FamilyInternet, loopback, "7")->data);
+	assert(nullptr == auth->find(FamilyInternet, loopback, "8"));
+
+	// Unchanged files are not parsed again
+	assert(auth == x11::auth::load(path));
+
+	record(data, FamilyInternet, { loopback, "8", "MIT-MAGIC-COOKIE-1", "more" });
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << data;
+	}
+	auto const again = x11::auth::load(path);
+	assert(nullptr != again);
+	assert(auth != again);
+	assert("more" == again->find(FamilyInternet, loopback, "8")->data);
+
+	// Truncated records are refused
+	x11::auth::file part;
+	assert(part.parse(fmt::string::view(data).substr(0, data.size() - 1)));
+
+	(void) std::remove(path.c_str());
+}
+
+test_unit(wire)
+{
+	constexpr std::size_t count = 1000;
+	for (char const order : { 'l', 'B' })
+	{
+		auto const data = stream(count, order);
+		for (std::size_t const step : { 1, 7, 4096 })
+		{
+			// Packets split across reads come out whole
+			memory in(data, step);
+			x11::decoder decode(order);
+			assert((x11::native != order) == decode.swap());
+
+			std::size_t n = 0;
+			do while (auto const p = decode.next())
+			{
+				assert(p.sequence() == static_cast<CARD16>(n));
+				if (X_Reply == p.type())
+				{
+					auto const rep = p.as<xGetPropertyReply>();
+					auto const items = rep(&xGetPropertyReply::nItems);
+					assert(n % 16 == items);
+					assert(XA_INTEGER == rep(&xGetPropertyReply::propertyType));
+					assert(sz_xGetPropertyReply + 4 * items == p.data.size());
+					for (CARD32 item = 0; item < items; ++item)
+					{
+						assert(n + item == p.item<CARD32>(item));
+					}
+					assert(0 == p.item<CARD32>(items));
+					if (not p.swapped)
+					{
+						auto const span = p.items<CARD32>();
+						assert(items == span.size());
+						assert(0 == items or n == span.front());
+						assert(items == rep->nItems);
+					}
+				}
+				else
+				{
+					auto const ev = p.as<Pointer>();
+					assert(n % 1000 == static_cast<std::size_t>(ev(&Pointer::rootX)));
+					assert(n % 700 == static_cast<std::size_t>(ev(&Pointer::rootY)));
+					assert(static_cast<CARD32>(n) == ev(&Pointer::time));
+					assert(2 == ev(&Pointer::event));
+				}
+				++ n;
+			}
+			while (not decode.fill(in));
+
+			assert(count == n);
+			assert(0 == decode.size());
+		}
+	}
+}
+#endif
+
+#ifdef bench_unit
+#include <sstream>
+
+bench_unit(x11)
+{
+	constexpr std::size_t count = 1 << 14;
+	auto const native = stream(count, x11::native);
+	auto const foreign = stream(count, 'l' == x11::native ? 'B' : 'l');
+
+	// Each packet copied out of a stream by the protocol operators
+	bench("stream", native.size(), [&](std::size_t times)
+	{
+		while (times--)
+		{
+			std::istringstream in(native);
+			x11::Protocol<xEvent, sz_xEvent> ev;
+			long sum = 0;
+			while (in >> ev)
+			{
+				if (X_Reply == ev.u.u.type)
+				{
+					xGenericReply rep;
+					std::memcpy(&rep, &ev, sz_xReply);
+					x11::bytes data(4 * static_cast<std::size_t>(rep.length), '\0');
+					in.read(data.data(), data.size());
+					sum += static_cast<long>(data.size());
+				}
+				else
+				{
+					sum += ev.u.keyButtonPointer.rootX;
+				}
+			}
+			sys::bench::keep(sum);
+		}
+	});
+
+	// Fields read in place from large chunks
+	auto const decode = [&bench](fmt::string::view label, x11::bytes const& data, char order)
+	{
+		bench(label, data.size(), [&](std::size_t times)
+		{
+			while (times--)
+			{
+				memory in(data, x11::decoder::chunk);
+				x11::decoder decoder(order);
+				long sum = 0;
+				do while (auto const p = decoder.next())
+				{
+					if (X_Reply == p.type())
+					{
+						sum += static_cast<long>(p.payload().size());
+					}
+					else
+					{
+						sum += p.as<Pointer>()(&Pointer::rootX);
+					}
+				}
+				while (not decoder.fill(in));
+				sys::bench::keep(sum);
+			}
+		});
+	};
+
+	decode("decoder", native, x11::native);
+	decode("swapped", foreign, 'l' == x11::native ? 'B' : 'l');
+
+	// Structure pointers straight into the buffer when orders agree
+	bench("direct", native.size(), [&](std::size_t times)
+	{
+		while (times--)
+		{
+			memory in(native, x11::decoder::chunk);
+			x11::decoder decoder;
+			long sum = 0;
+			do while (auto const p = decoder.next())
+			{
+				if (X_Reply == p.type())
+				{
+					sum += static_cast<long>(p.items<CARD32>().size());
+				}
+				else
+				{
+					sum += p.as<Pointer>()->rootX;
+				}
+			}
+			while (not decoder.fill(in));
+			sys::bench::keep(sum);
+		}
+	});
+}
+bench_unit(shm)
+{
+	int fd[2];
+	verify(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fd));
+	x11::connection client(fd[0]);
+	client.ids(0x200000, 0x1FFFFF);
+	mock server(fd[1]);
+	server.noisy = false;
+	std::thread thread([&server] { server.run(); });
+
+	CARD8 major, event;
+	verify(not x11::shm::query(client, major, event));
+	{
+		x11::shm::pool pool(client, major, event, 2);
+		for (CARD16 const side : { 64, 128, 240 })
+		{
+			std::size_t const size = 4 * side * side;
+			x11::bytes const pixels(size, '\x7F');
+			auto const label = fmt::to_string(static_cast<long>(side), 10);
+
+			// Every pixel is copied through the socket
+			bench("socket/" + label, size, [&](std::size_t times)
+			{
+				while (times--)
+				{
+					x11::PutImage req;
+					req.drawable = 1;
+					req.gc = 2;
+					req.width = req.height = side;
+					req.depth = 24;
+					req.format = ZPixmap;
+					(void) client.send(req, pixels);
+					x11::GetInputFocus sync;
+					(void) client.reply(client.send(sync));
+				}
+			});
+
+			// Pixels are written in place and only the request is sent
+			bench("segment/" + label, size, [&](std::size_t times)
+			{
+				while (times--)
+				{
+					auto const seg = pool.acquire(size);
+					if (nullptr == seg)
+					{
+						sys::err(here, "acquire", size);
+						break;
+					}
+					std::memcpy(seg->data(), pixels.data(), size);
+					x11::ShmPutImage req;
+					req.drawable = 1;
+					req.gc = 2;
+					req.totalWidth = req.srcWidth = side;
+					req.totalHeight = req.srcHeight = side;
+					req.depth = 24;
+					req.format = ZPixmap;
+					(void) pool.put(*seg, req);
+					verify(not pool.wait());
+				}
+			});
+		}
+	}
+
+	(void) ::shutdown(fd[0], SHUT_WR);
+	thread.join();
+	if (0 < server.broken)
+	{
+		sys::err(here, "broken", server.broken);
+	}
+}
+#endif
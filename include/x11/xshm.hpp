@@ -0,0 +1,120 @@
+#ifndef xshm_hpp
+#define xshm_hpp
+
+#include "x11.hpp"
+#include "conn.hpp"
+#include "ptr.hpp"
+#include <X11/extensions/shmproto.h>
+#include <deque>
+
+namespace x11
+{
+	template
+	<
+		char ShmReqType,
+		class Req, unsigned short ReqSize,
+		class Rep = xGenericReply, unsigned short RepSize = sz_xReply
+	>
+	struct ShmRequest : Protocol<Req, ReqSize>
+	{
+		static constexpr auto requestType = ShmReqType;
+		using request = Req;
+		static constexpr auto requestSize = ReqSize;
+		using reply = Rep;
+		static constexpr auto replySize = RepSize;
+
+		static_assert(sizeof (Req) == requestSize);
+		static_assert(sizeof (Rep) == replySize);
+
+		explicit ShmRequest(CARD8 major = 0) : Protocol<Req, ReqSize>()
+		{
+			// Extension opcode is only known after QueryExtension
+			Req::reqType = major;
+			Req::shmReqType = requestType;
+			Req::length = requestSize / 4;
+		}
+	};
+
+	using ShmQueryVersion = ShmRequest
+	<
+		X_ShmQueryVersion, xShmQueryVersionReq, sz_xShmQueryVersionReq, xShmQueryVersionReply, sz_xShmQueryVersionReply
+	>;
+
+	using ShmAttachFd = ShmRequest
+	<
+		X_ShmAttachFd, xShmAttachFdReq, sz_xShmAttachFdReq
+	>;
+
+	using ShmDetach = ShmRequest
+	<
+		X_ShmDetach, xShmDetachReq, sz_xShmDetachReq
+	>;
+
+	using ShmPutImage = ShmRequest
+	<
+		X_ShmPutImage, xShmPutImageReq, sz_xShmPutImageReq
+	>;
+
+	using ShmGetImage = ShmRequest
+	<
+		X_ShmGetImage, xShmGetImageReq, sz_xShmGetImageReq, xShmGetImageReply, sz_xShmGetImageReply
+	>;
+}
+
+namespace x11::shm
+{
+	bool query(connection&, CARD8& major, CARD8& event);
+	// Opcode and first event of MIT-SHM if it can attach descriptors
+
+	struct segment
+	// Memory shared with the server under a resource id
+	{
+		CARD32 id = 0;
+		fwd::extern_ptr<void> map;
+		std::size_t size = 0;
+		bool busy = false;
+
+		char* data() const
+		{
+			return static_cast<char*>(map.get());
+		}
+	};
+
+	class pool : fwd::unique
+	// Segments attached once and reused, freed again by completion events
+	{
+		connection& conn;
+		CARD8 major, event;
+		std::size_t count;
+		std::deque<segment> segments;
+
+		bool attach(segment&, std::size_t size);
+		// Map new memory and send its descriptor to the server
+
+		void detach(segment&);
+		// Release the memory on both sides
+
+	public:
+
+		pool(connection&, CARD8 major, CARD8 event, std::size_t count = 4);
+		~pool();
+
+		segment* acquire(std::size_t size);
+		// Free segment with room for size bytes, waiting on the server when
+		// every segment is busy, or null on failure
+
+		void release(segment&);
+		// Give back a segment that was not sent
+
+		cookie put(segment&, ShmPutImage&);
+		// Draw from the segment, which stays busy until the server is done
+
+		bytes get(segment&, ShmGetImage&);
+		// Copy into the segment and wait for the reply, or empty on error
+
+		bool wait();
+		// Take one completion event and free its segment
+	};
+}
+
+#endif // file
@@ -0,0 +1,511 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "bench.hpp"
+#include "fmt.hpp"
+#include "dig.hpp"
+#include "type.hpp"
+#include "err.hpp"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <latch>
+#include <cmath>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using clock = std::chrono::steady_clock;
+	using timed = std::function<double(size_t)>;
+	// Seconds elapsed performing an operation the given number of times
+
+	double seconds(clock::time_point begin)
+	{
+		std::chrono::duration<double> const d = clock::now() - begin;
+		return d.count();
+	}
+
+	#ifdef __linux__
+	class events : fwd::unique
+	// Hardware counters read as one group around the timed samples
+	{
+		struct kind
+		{
+			char const* name;
+			unsigned type;
+			unsigned long long config;
+		};
+
+		static constexpr kind table[] =
+		{
+			{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		};
+
+		static constexpr auto size = std::size(table);
+
+		int fd[size];
+		char const* name[size];
+		size_t count = 0;
+
+		int leader() const
+		{
+			return 0 < count ? fd[0] : -1;
+		}
+
+	public:
+
+		events()
+		{
+			for (auto const& k : table)
+			{
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof attr);
+				attr.size = sizeof attr;
+				attr.type = k.type;
+				attr.config = k.config;
+				attr.disabled = 0 == count;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP;
+
+				auto const no = syscall(SYS_perf_event_open, &attr, 0, -1, leader(), 0);
+				if (no < 0)
+				{
+					if (0 == count)
+					{
+						sys::warn(here, "perf_event_open", k.name);
+						break;
+					}
+					continue;
+				}
+
+				fd[count] = static_cast<int>(no);
+				name[count] = k.name;
+				++ count;
+			}
+		}
+
+		~events()
+		{
+			for (size_t n = 0; n < count; ++n)
+			{
+				(void) close(fd[n]);
+			}
+		}
+
+		operator bool() const
+		{
+			return 0 < count;
+		}
+
+		void start() const
+		{
+			(void) ioctl(leader(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			(void) ioctl(leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+		void stop() const
+		{
+			(void) ioctl(leader(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+		auto read(double ops) const
+		{
+			fwd::vector<sys::bench::result::counter> out;
+			unsigned long long buf[1 + size];
+			auto const n = ::read(leader(), buf, sizeof buf);
+			if (n < 0)
+			{
+				sys::err(here, "read");
+			}
+			else
+			for (size_t i = 0; i < buf[0] and i < count; ++i)
+			{
+				out.emplace_back(name[i], buf[1 + i] / ops);
+			}
+			return out;
+		}
+	};
+	#endif
+
+	void measure(timed work, sys::bench::result& out, bool counters)
+	// Warm up, calibrate the iteration count, then take the samples
+	{
+		auto const& opt = sys::bench::settings();
+
+		// Warm up caches, predictors and the clock frequency
+		size_t n = 1;
+		for (auto const begin = clock::now(); seconds(begin) < opt.warmup; n *= 2)
+		{
+			(void) work(n);
+		}
+
+		// Grow the count until one sample fills the target time
+		n = std::max<size_t>(1, n / 4);
+		for (;;)
+		{
+			auto const t = work(n);
+			if (opt.target <= t)
+			{
+				break;
+			}
+			auto const scale = 0 < t ? 1.1 * opt.target / t : 100.0;
+			auto const next = static_cast<double>(n) * std::clamp(scale, 1.1, 100.0);
+			n = std::max(n + 1, static_cast<size_t>(next));
+		}
+
+		#ifdef __linux__
+		std::unique_ptr<events> hw;
+		if (counters)
+		{
+			hw = std::make_unique<events>();
+			if (not *hw) hw.reset();
+		}
+		if (hw) hw->start();
+		#else
+		(void) counters;
+		#endif
+
+		fwd::vector<double> ns;
+		auto const m = std::max<size_t>(1, opt.samples);
+		for (size_t sample = 0; sample < m; ++sample)
+		{
+			auto const t = work(n);
+			ns.push_back(1e9 * t / static_cast<double>(n));
+		}
+
+		#ifdef __linux__
+		if (hw)
+		{
+			hw->stop();
+			out.counters = hw->read(static_cast<double>(n * m));
+		}
+		#endif
+
+		std::sort(ns.begin(), ns.end());
+		auto const rank = static_cast<size_t>(std::ceil(0.99 * m));
+		out.iterations = n;
+		out.samples = m;
+		out.median = m % 2 ? ns[m / 2] : (ns[m / 2 - 1] + ns[m / 2]) / 2;
+		out.p99 = ns.at(std::clamp<size_t>(rank, 1, m) - 1);
+		out.mean = std::accumulate(ns.begin(), ns.end(), 0.0) / m;
+		out.rate = 0 < out.median ? 1e9 / out.median : 0;
+		if (0 < out.bytes)
+		{
+			out.rate *= out.bytes;
+		}
+	}
+}
+
+namespace sys::bench
+{
+	options& settings()
+	{
+		static options local;
+		return local;
+	}
+
+	namespace
+	{
+		size_t (*counter)() = nullptr;
+	}
+
+	size_t allocations()
+	{
+		return nullptr == counter ? 0 : counter();
+	}
+
+	void allocations(size_t (*hook)())
+	{
+		counter = hook;
+	}
+
+	result const& suite::operator()(fmt::string::view label, size_t bytes, body work)
+	{
+		auto& out = results.emplace_back();
+		out.name = fmt::join({ name, label }, "/");
+		out.bytes = static_cast<double>(bytes);
+
+		// Allocations of the last sample, which is a timed one
+		size_t ops = 0, news = 0;
+		measure([&](size_t n)
+		{
+			auto const count = allocations();
+			auto const begin = clock::now();
+			work(n);
+			auto const t = seconds(begin);
+			news = allocations() - count;
+			ops = n;
+			return t;
+		},
+		out, settings().counters);
+
+		if (0 < news)
+		{
+			out.counters.emplace_back("allocs", static_cast<double>(news) / static_cast<double>(ops));
+		}
+		return out;
+	}
+
+	result const& suite::parallel(fmt::string::view label, size_t threads, size_t bytes, task work)
+	{
+		auto& out = results.emplace_back();
+		auto const count = fmt::to_string(threads);
+		out.name = fmt::join({ name, label, count }, "/");
+		out.bytes = static_cast<double>(bytes);
+		threads = std::max<size_t>(1, threads);
+
+		measure([&](size_t n)
+		{
+			// Spread the operations over all threads
+			auto const share = std::max<size_t>(1, n / threads);
+			std::latch gate(fmt::to<std::ptrdiff_t>(threads + 1));
+			fwd::vector<std::thread> pool;
+			for (size_t id = 0; id < threads; ++id)
+			{
+				pool.emplace_back([&, id]
+				{
+					gate.arrive_and_wait();
+					work(share, id);
+				});
+			}
+
+			gate.arrive_and_wait();
+			auto const begin = clock::now();
+			for (auto& t : pool)
+			{
+				t.join();
+			}
+			// Scale to the operations that were requested
+			return seconds(begin) * n / (share * threads);
+		},
+		out, false);
+
+		return out;
+	}
+
+	fmt::string ascii(size_t bytes, unsigned long long seed)
+	{
+		constexpr fmt::string::view alpha = "abcdefghijklmnopqrstuvwxyz"
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-.,:;()[]{}";
+
+		random next(seed);
+		fmt::string s;
+		s.reserve(bytes);
+		while (s.size() < bytes)
+		{
+			auto n = 1 + next(12);
+			while (n-- and s.size() < bytes)
+			{
+				s += alpha[next(alpha.size())];
+			}
+
+			if (s.size() < bytes)
+			{
+				auto const k = next(16);
+				s += 0 == k ? '\n' : 1 == k ? '\t' : ' ';
+			}
+		}
+		return s;
+	}
+
+	fmt::string utf8(size_t bytes, unsigned long long seed)
+	{
+		random next(seed);
+		fmt::string s;
+		s.reserve(bytes);
+		// Leave room for the longest sequence
+		while (s.size() + 4 < bytes)
+		{
+			auto const k = next(20);
+			if (0 == k)
+			{
+				s += ' ';
+			}
+			else
+			if (k < 12)
+			{
+				s += static_cast<char>('a' + next(26));
+			}
+			else
+			if (k < 16)
+			{
+				// Latin supplements and extensions
+				auto const c = 0xC0 + next(0x190);
+				s += static_cast<char>(0xC0 | (c >> 6));
+				s += static_cast<char>(0x80 | (c & 0x3F));
+			}
+			else
+			if (k < 19)
+			{
+				// CJK ideographs
+				auto const c = 0x4E00 + next(0x5000);
+				s += static_cast<char>(0xE0 | (c >> 12));
+				s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				s += static_cast<char>(0x80 | (c & 0x3F));
+			}
+			else
+			{
+				// Emoji outside the basic plane
+				auto const c = 0x1F600 + next(0x50);
+				s += static_cast<char>(0xF0 | (c >> 18));
+				s += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+				s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				s += static_cast<char>(0x80 | (c & 0x3F));
+			}
+		}
+		s.resize(bytes, ' ');
+		return s;
+	}
+
+	fmt::string worst(size_t bytes, fmt::string::view pattern)
+	{
+		fmt::string s;
+		if (not std::empty(pattern))
+		{
+			s.reserve(bytes + pattern.size());
+			while (s.size() < bytes)
+			{
+				s += pattern;
+			}
+			s.resize(bytes);
+		}
+		return s;
+	}
+
+	fmt::string::vector words(size_t count, unsigned long long seed)
+	{
+		constexpr fmt::string::view alpha = "abcdefghijklmnopqrstuvwxyz";
+
+		random next(seed);
+		fmt::string::vector t;
+		t.reserve(count);
+		for (size_t index = 0; index < count; ++index)
+		{
+			fmt::string s;
+			auto n = 3 + next(8);
+			while (n--)
+			{
+				s += alpha[next(alpha.size())];
+			}
+			// Suffix keeps every word distinct
+			s += fmt::to_string(index, 36);
+			t.emplace_back(std::move(s));
+		}
+		return t;
+	}
+
+	fmt::string label(fmt::string::view op, size_t n)
+	{
+		auto const count = fmt::to_string(n);
+		return fmt::join({ op, count }, "/");
+	}
+
+	bool compare(result const& now, double baseline, double threshold)
+	{
+		return 0 < baseline and baseline * (1 + threshold / 100) < now.median;
+	}
+
+	fmt::string::out::ref operator<<(fmt::string::out::ref out, result const& r)
+	{
+		out << r.name
+		    << fmt::tab << r.iterations
+		    << fmt::tab << fmt::to_string(r.median, 1)
+		    << fmt::tab << fmt::to_string(r.p99, 1)
+		    << fmt::tab << fmt::to_string(r.rate, 0);
+
+		for (auto const& [event, value] : r.counters)
+		{
+			out << fmt::tab << event << '=' << fmt::to_string(value, 2);
+		}
+		return out;
+	}
+}
+
+#ifdef test_unit
+test_unit(bench)
+{
+	auto& opt = sys::bench::settings();
+	auto const old = opt;
+	opt.warmup = 0.001;
+	opt.target = 0.0001;
+	opt.samples = 5;
+
+	sys::bench::suite bench("test");
+	// Serial work
+	{
+		auto const& r = bench("sum", sizeof (long), [](size_t n)
+		{
+			long sum = 0;
+			while (n--)
+			{
+				sum += n;
+				sys::bench::keep(sum);
+			}
+		});
+		assert(r.name == "test/sum");
+		assert(0 < r.iterations);
+		assert(0 < r.median);
+		assert(r.median <= r.p99);
+		assert(0 < r.rate);
+	}
+	// Threaded work
+	{
+		auto const& r = bench.parallel("sum", 2, 0, [](size_t n, size_t id)
+		{
+			auto sum = id;
+			while (n--)
+			{
+				sum += n;
+				sys::bench::keep(sum);
+			}
+		});
+		assert(r.name == "test/sum/2");
+		assert(0 < r.median);
+	}
+	// Regression check
+	{
+		sys::bench::result r;
+		r.median = 110;
+		assert(sys::bench::compare(r, 100, 5));
+		assert(not sys::bench::compare(r, 100, 10));
+		assert(not sys::bench::compare(r, 0, 5));
+	}
+	// Deterministic data
+	{
+		assert(sys::bench::ascii(100, 7) == sys::bench::ascii(100, 7));
+		assert(sys::bench::ascii(100, 7) != sys::bench::ascii(100, 8));
+		assert(100 == sys::bench::utf8(100).size());
+		assert("{}{}{" == sys::bench::worst(5, "{}"));
+		auto const t = sys::bench::words(50);
+		auto const u = fmt::string::set(t.begin(), t.end());
+		assert(t.size() == u.size());
+	}
+	// Allocations counted per operation
+	{
+		auto const& r = bench("new", [](size_t n)
+		{
+			while (n--)
+			{
+				fmt::string s(64, static_cast<char>(n));
+				sys::bench::keep(s);
+			}
+		});
+		auto const& c = r.counters.back();
+		assert("allocs" == c.first and 1.0 == c.second);
+	}
+	assert(3 == bench.results.size());
+	opt = old;
+}
+#endif
@@ -0,0 +1,271 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "commit.hpp"
+#include "sys.hpp"
+#include "err.hpp"
+#include <algorithm>
+#ifndef _WIN32
+# include <fcntl.h>
+#endif
+
+namespace env::file
+{
+	committer::committer() : committer(options { })
+	{ }
+
+	committer::committer(options o) : opt(o)
+	{
+		thread = std::thread([this] { run(); });
+	}
+
+	committer::~committer()
+	{
+		{
+			std::lock_guard const guard(lock);
+			stop = true;
+		}
+		work.notify_one();
+		thread.join();
+	}
+
+	committer::ticket committer::mark(descriptor const& file)
+	{
+		auto const fd = file.get();
+		#ifdef SYNC_FILE_RANGE_WRITE
+		if (opt.early and fail(sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE)))
+		{
+			sys::warn(here, "sync_file_range", fd);
+		}
+		#endif
+
+		ticket id;
+		bool wake;
+		{
+			std::lock_guard const guard(lock);
+			id = ++issued;
+			dirty.emplace_back(fd, id);
+			// The first waiter starts the delay, and a full batch ends it
+			wake = 1 == issued - durable or opt.batch <= issued - durable;
+		}
+		if (wake)
+		{
+			work.notify_one();
+		}
+		return id;
+	}
+
+	bool committer::wait(ticket id)
+	{
+		std::unique_lock guard(lock);
+		done.wait(guard, [&] { return id <= durable; });
+		auto const it = std::find(failed.begin(), failed.end(), id);
+		if (failed.end() == it)
+		{
+			return success;
+		}
+		// Told once, so the list only holds what is still to be waited on
+		*it = failed.back();
+		failed.pop_back();
+		return failure;
+	}
+
+	size_t committer::flushes() const
+	{
+		std::lock_guard const guard(lock);
+		return batches;
+	}
+
+	bool committer::flush(int fd) const
+	{
+		#ifdef _WIN32
+		auto const no = sys::fsync(fd);
+		#elif defined(__linux__)
+		auto const no = opt.data ? fdatasync(fd) : sys::fsync(fd);
+		#else
+		auto const no = sys::fsync(fd);
+		#endif
+		if (fail(no))
+		{
+			sys::err(here, "sync", fd);
+			return failure;
+		}
+		return success;
+	}
+
+	void committer::run()
+	{
+		fwd::vector<std::pair<int, ticket>> marks;
+		fwd::vector<ticket> errors;
+		std::unique_lock guard(lock);
+		for (;;)
+		{
+			work.wait(guard, [this] { return stop or durable < issued; });
+			if (durable == issued)
+			{
+				break; // stopping with nothing left
+			}
+
+			// Let more writers join unless the batch is already full
+			if (clock::duration::zero() < opt.delay and not stop)
+			{
+				auto const until = clock::now() + opt.delay;
+				work.wait_until(guard, until, [this]
+				{
+					return stop or opt.batch <= issued - durable;
+				});
+			}
+
+			auto const last = issued;
+			marks.swap(dirty);
+			dirty.clear();
+			guard.unlock();
+
+			// Each descriptor once however many times it was marked, failing only its own tickets
+			std::sort(marks.begin(), marks.end());
+			errors.clear();
+			for (auto it = marks.begin(); it != marks.end(); )
+			{
+				auto const fd = it->first;
+				auto const end = std::find_if(it, marks.end(), [fd](auto const& mark)
+				{
+					return fd != mark.first;
+				});
+
+				if (flush(fd))
+				{
+					for (; it != end; ++it)
+					{
+						errors.push_back(it->second);
+					}
+				}
+				it = end;
+			}
+
+			guard.lock();
+			failed.insert(failed.end(), errors.begin(), errors.end());
+			durable = last;
+			++batches;
+			done.notify_all();
+		}
+	}
+}
+
+#ifdef test_unit
+#include "dir.hpp"
+#include "env.hpp"
+
+test_unit(commit)
+{
+	auto const base = fmt::dir::join({ env::temp(), "oasys.commit" });
+	constexpr std::size_t writers = 4, count = 25;
+
+	// Every writer's records arrive and are durable when the wait returns
+	{
+		env::file::committer group({ std::chrono::milliseconds(1), writers, true, true });
+		fwd::vector<std::thread> pool;
+		for (std::size_t id = 0; id < writers; ++id)
+		{
+			pool.emplace_back([&, id]
+			{
+				auto const path = base + fmt::to_string(static_cast<long>(id));
+				env::file::descriptor out(path, env::file::ov);
+				for (std::size_t n = 0; n < count; ++n)
+				{
+					constexpr char record[] = "0123456789abcdef";
+					assert(not group.append(out, record, 16));
+				}
+			});
+		}
+		for (auto& t : pool) t.join();
+		assert(0 < group.flushes() and group.flushes() <= writers * count);
+
+		for (std::size_t id = 0; id < writers; ++id)
+		{
+			auto const path = base + fmt::to_string(static_cast<long>(id));
+			env::file::descriptor in(path, env::file::rd);
+			assert(16 * count == in.size());
+			(void) sys::unlink(path.c_str());
+		}
+	}
+
+	// A descriptor which cannot be flushed fails only its own tickets
+	{
+		env::file::committer group;
+		env::file::descriptor none;
+		assert(group.commit(none));
+
+		env::file::descriptor out(base, env::file::ov);
+		assert(not group.commit(out));
+
+		// Even when they share a flush with it
+		env::file::committer shared({ std::chrono::seconds(10), 3 });
+		auto const first = shared.mark(out);
+		auto const bad = shared.mark(none);
+		auto const second = shared.mark(out);
+		assert(not shared.wait(first));
+		assert(shared.wait(bad));
+		assert(not shared.wait(second));
+		assert(1 == shared.flushes());
+		(void) sys::unlink(base.c_str());
+	}
+}
+
+#endif
+#ifdef bench_unit
+#include "dir.hpp"
+#include "env.hpp"
+#include <atomic>
+#include <memory>
+
+bench_unit(commit)
+{
+	// Small durable writes from each thread to its own file, alone and as a group
+	constexpr std::size_t size = 64;
+	char const record[size] { };
+	auto const base = fmt::dir::join({ env::temp(), "oasys.commit." });
+
+	for (std::size_t threads : { 1, 2, 4, 8 })
+	{
+		fwd::vector<fmt::string> paths;
+		fwd::vector<std::unique_ptr<env::file::descriptor>> files;
+		for (std::size_t id = 0; id < threads; ++id)
+		{
+			paths.push_back(base + fmt::to_string(static_cast<long>(id)));
+			files.push_back(std::make_unique<env::file::descriptor>(paths.back(), env::file::ov));
+		}
+
+		bench.parallel("alone", threads, size, [&](std::size_t n, std::size_t id)
+		{
+			auto const& out = *files[id];
+			while (n--)
+			{
+				(void) out.write(record, size);
+				(void) sys::fsync(out.get());
+			}
+		});
+
+		env::file::committer group({ std::chrono::microseconds(200), threads });
+		std::atomic<std::size_t> writes = 0;
+		bench.parallel("group", threads, size, [&](std::size_t n, std::size_t id)
+		{
+			auto const& out = *files[id];
+			writes += n;
+			while (n--)
+			{
+				(void) group.append(out, record, size);
+			}
+		});
+		// Writes which shared each flush
+		auto const batches = static_cast<double>(group.flushes());
+		bench.results.back().counters.emplace_back("batch", 0 < batches ? static_cast<double>(writes) / batches : 0);
+
+		files.clear();
+		for (auto const& path : paths)
+		{
+			(void) sys::unlink(path.c_str());
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,437 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "csv.hpp"
+#include "pipe.hpp"
+#include "sync.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	constexpr std::size_t least = 1 << 20; // bytes worth a thread of their own
+
+	std::size_t quotes(doc::csv::view u, char quote)
+	{
+		return static_cast<std::size_t>(std::count(u.begin(), u.end(), quote));
+	}
+}
+
+namespace doc::csv
+{
+	bool records::next(fwd::vector<field>& out)
+	{
+		auto const n = data.size();
+		auto const p = data.data();
+		out.clear();
+		problem = { };
+
+		// Blank lines are not records
+		while (pos < n and ('\n' == p[pos] or ('\r' == p[pos] and pos + 1 < n and '\n' == p[pos + 1])))
+		{
+			pos += '\r' == p[pos] ? 2 : 1;
+		}
+		if (n <= pos) return false;
+
+		start = pos;
+		++count;
+		for (;;)
+		{
+			field f;
+			if (form.quote and form.quote == p[pos])
+			{
+				f.quoted = true;
+				auto const from = ++pos;
+				for (;;)
+				{
+					auto const at = static_cast<char const*>(std::memchr(p + pos, form.quote, n - pos));
+					if (nullptr == at)
+					{
+						problem = "quote is not closed";
+						f.text = data.substr(from);
+						pos = n;
+						out.push_back(f);
+						return true;
+					}
+					pos = static_cast<std::size_t>(at - p) + 1;
+					if (pos < n and form.quote == p[pos])
+					{
+						f.doubled = true;
+						++pos;
+						continue;
+					}
+					break;
+				}
+				f.text = data.substr(from, pos - 1 - from);
+
+				// Nothing may follow the closing quote but the end of the field
+				auto const rest = pos;
+				while (pos < n and form.sep != p[pos] and '\n' != p[pos]) ++pos;
+				if (rest < pos and not (rest + 1 == pos and '\r' == p[rest]))
+				{
+					problem = "text after a closing quote";
+				}
+			}
+			else
+			{
+				auto const from = pos;
+				while (pos < n and form.sep != p[pos] and '\n' != p[pos]) ++pos;
+				auto to = pos;
+				if (from < to and '\r' == p[to - 1] and (n == pos or '\n' == p[pos])) --to;
+				f.text = data.substr(from, to - from);
+			}
+			out.push_back(f);
+
+			if (n <= pos) return true;
+			if ('\n' == p[pos++]) return true;
+		}
+	}
+
+	fmt::string unquote(field const& f, char quote)
+	{
+		fmt::string out;
+		out.reserve(f.text.size());
+		for (std::size_t i = 0; i < f.text.size(); ++i)
+		{
+			out += f.text[i];
+			if (quote == f.text[i] and i + 1 < f.text.size() and quote == f.text[i + 1]) ++i;
+		}
+		return out;
+	}
+
+	view body(view data, format form, fwd::vector<field>* names)
+	{
+		if (not form.header) return data;
+
+		records in(data, form);
+		fwd::vector<field> fields;
+		if (not in.next(fields)) return { };
+		if (names) *names = fields;
+		return data.substr(in.tell());
+	}
+
+	fwd::vector<view> split(view data, format form, std::size_t parts)
+	{
+		parts = std::max<std::size_t>(1, std::min(parts, data.size() / least));
+		fwd::vector<std::size_t> cut(parts + 1), parity(parts);
+		for (std::size_t k = 0; k <= parts; ++k)
+		{
+			cut[k] = data.size() * k / parts;
+		}
+
+		// Quotes before each cut tell whether it falls inside a quoted field
+		if (form.quote)
+		{
+			run(parts, [&](std::size_t k)
+			{
+				parity[k] = quotes(data.substr(cut[k], cut[k + 1] - cut[k]), form.quote) & 1;
+			});
+			for (std::size_t k = 0, odd = 0; k < parts; ++k)
+			{
+				odd ^= parity[k];
+				parity[k] = odd ^ parity[k]; // parity at the start of k
+			}
+		}
+
+		// Move each cut forward past the next line end outside of quotes
+		run(parts, [&](std::size_t k)
+		{
+			if (0 == k) return;
+			auto inside = form.quote and parity[k];
+			auto at = cut[k];
+			for (; at < data.size(); ++at)
+			{
+				auto const c = data[at];
+				if (form.quote == c and form.quote) inside = not inside;
+				else
+				if ('\n' == c and not inside) break;
+			}
+			cut[k] = std::min(at + 1, data.size());
+		});
+
+		fwd::vector<view> out;
+		for (std::size_t k = 0, from = 0; k < parts; ++k)
+		{
+			auto const to = std::max(from, k + 1 < parts ? cut[k + 1] : data.size());
+			if (from < to) out.push_back(data.substr(from, to - from));
+			from = to;
+		}
+		if (out.empty()) out.push_back(data);
+		return out;
+	}
+
+	void run(std::size_t count, std::function<void(std::size_t)> const& work)
+	{
+		sys::share(count, count, work);
+	}
+
+	report merge(fwd::span<report const> parts, std::size_t first)
+	{
+		report out;
+		std::size_t before = first - 1;
+		for (auto const& r : parts)
+		{
+			if (r.fail() and not out.fail())
+			{
+				out.record = before + r.record;
+				out.offset = r.offset;
+				out.what = r.what;
+			}
+			out.skipped += r.skipped;
+			out.rows += r.rows;
+			before += r.rows + r.skipped;
+		}
+		return out;
+	}
+
+	std::size_t threads(std::size_t wanted)
+	{
+		return 0 < wanted ? wanted : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	table::table(fwd::span<kind const> kinds)
+	{
+		for (auto const k : kinds)
+		{
+			switch (k)
+			{
+			case integer:
+				columns.emplace_back(fwd::vector<long long>());
+				break;
+			case real:
+				columns.emplace_back(fwd::vector<double>());
+				break;
+			default:
+				columns.emplace_back(fwd::vector<fmt::string>());
+			}
+		}
+	}
+
+	std::size_t table::size() const
+	{
+		if (columns.empty()) return 0;
+		return std::visit([](auto const& c) { return c.size(); }, columns.front());
+	}
+
+	report load(view data, table& out, format form, std::size_t count)
+	{
+		fwd::vector<field> names;
+		auto const text = body(data, form, &names);
+		if (out.names.empty())
+		{
+			for (auto const& f : names) out.names.emplace_back(unquote(f, form.quote));
+		}
+
+		if (out.columns.empty())
+		{
+			// Text columns as many as the first record has
+			records in(form.header ? data : text, form);
+			fwd::vector<field> fields;
+			(void) in.next(fields);
+			out.columns.assign(fields.size(), fwd::vector<fmt::string>());
+		}
+
+		auto const parts = split(text, form, threads(count));
+		fwd::vector<fwd::vector<table::column>> chunks(parts.size());
+		fwd::vector<report> reports(parts.size());
+
+		run(parts.size(), [&](std::size_t i)
+		{
+			// Empty columns of the same kinds
+			auto& cols = chunks[i];
+			for (auto const& c : out.columns)
+			{
+				cols.push_back(std::visit([](auto const& v) { return table::column(std::decay_t<decltype(v)>()); }, c));
+			}
+
+			records in(parts[i], form);
+			fwd::vector<field> fields;
+			auto const base = static_cast<std::size_t>(parts[i].data() - data.data());
+			std::size_t rows = 0;
+			while (in.next(fields))
+			{
+				view why = in.problem;
+				if (why.empty() and cols.size() != fields.size())
+				{
+					why = "wrong number of fields";
+				}
+
+				// Convert every field before keeping any of them
+				for (std::size_t j = 0; why.empty() and j < cols.size(); ++j)
+				{
+					std::visit([&](auto& v)
+					{
+						typename std::decay_t<decltype(v)>::value_type value;
+						if (convert(fields[j], value, form.quote)) why = "field does not convert";
+						else v.push_back(std::move(value));
+					}, cols[j]);
+				}
+
+				if (not why.empty())
+				{
+					reports[i].fault(base + in.start, in.count, why);
+					for (auto& c : cols)
+					{
+						std::visit([rows](auto& v) { v.resize(rows); }, c);
+					}
+					continue;
+				}
+				++rows;
+			}
+			reports[i].rows = rows;
+		});
+
+		// Append every chunk to each column, one column to a thread
+		run(out.columns.size(), [&](std::size_t j)
+		{
+			std::visit([&](auto& v)
+			{
+				for (auto& cols : chunks)
+				{
+					auto& w = std::get<std::decay_t<decltype(v)>>(cols[j]);
+					v.insert(v.end(), std::make_move_iterator(w.begin()), std::make_move_iterator(w.end()));
+				}
+			}, out.columns[j]);
+		});
+
+		return merge(reports, form.header ? 2 : 1);
+	}
+
+	file::file(view path)
+	{
+		env::file::descriptor in(path, env::file::rd);
+		if (not env::file::fail(in.get()))
+		{
+			map = env::file::make_map(in.get(), 0, 0, env::file::rd, &size);
+		}
+	}
+}
+
+#ifdef test_unit
+
+test_unit(csv)
+{
+	// Quoted fields with separators, quotes and line ends inside
+	{
+		doc::csv::view const in = "name,qty,price\r\n\"a, b\",1,2.5\r\n\"say \"\"hi\"\"\",2,0.25\n\n\"two\nlines\",3,1e3\n";
+		fwd::matrix<fmt::string, int, double> m;
+		auto const r = doc::csv::load(in, m, { }, 1);
+		assert(not r.fail());
+		assert(3 == r.rows and 3 == m.size());
+		assert(std::get<0>(m.at(0)) == "a, b" and 1 == std::get<1>(m.at(0)) and 2.5 == std::get<2>(m.at(0)));
+		assert(std::get<0>(m.at(1)) == "say \"hi\"");
+		assert(std::get<0>(m.at(2)) == "two\nlines" and 1e3 == std::get<2>(m.at(2)));
+	}
+
+	// First error with its record and position, and the rest still loaded
+	{
+		doc::csv::view const in = "x,y\n1,2\n3,z\n4\n5,6";
+		fwd::matrix<long, long> m;
+		auto const r = doc::csv::load(in, m);
+		assert(r.fail() and 2 == r.skipped and 2 == r.rows);
+		assert(3 == r.record and 8 == r.offset and r.what == "field does not convert");
+		assert(5 == std::get<0>(m.at(1)));
+	}
+
+	// Tabs without quoting into columns typed at run time
+	{
+		doc::csv::view const in = "id\tname\tscore\n7\t\"q\t0.5\n8\tr\t1.5\n";
+		doc::csv::table::kind const kinds[] = { doc::csv::table::integer, doc::csv::table::text, doc::csv::table::real };
+		doc::csv::table t(kinds);
+		auto const r = doc::csv::load(in, t, doc::csv::tsv);
+		assert(not r.fail() and 2 == t.size());
+		assert(3 == t.names.size() and "score" == t.names[2]);
+		assert("\"q" == std::get<fwd::vector<fmt::string>>(t.columns[1])[0]);
+		assert(1.5 == std::get<fwd::vector<double>>(t.columns[2])[1]);
+	}
+
+	// Chunks split inside quoted fields still end on records
+	{
+		fmt::string text;
+		for (int i = 0; i < 200000; ++i)
+		{
+			text += fmt::to_string(static_cast<long>(i));
+			text += i % 3 ? ",plain\n" : ",\"multi\nline, \"\"quoted\"\"\"\n";
+		}
+		auto const parts = doc::csv::split(text, { }, 8);
+		assert(1 < parts.size());
+		for (auto const& part : parts)
+		{
+			assert('\n' == part.back());
+		}
+
+		fwd::matrix<long, fmt::string> serial, parallel;
+		doc::csv::format const form { ',', '"', false };
+		auto const a = doc::csv::load(text, serial, form, 1);
+		auto const b = doc::csv::load(text, parallel, form, 8);
+		assert(not a.fail() and not b.fail());
+		assert(200000 == a.rows and a.rows == b.rows);
+		for (std::size_t i = 0; i < serial.size(); i += 997)
+		{
+			assert(serial.at(i) == parallel.at(i));
+		}
+	}
+}
+
+#endif
+#ifdef bench_unit
+
+namespace
+{
+	fmt::string sheet(std::size_t rows)
+	// Table of numbers and short text with some quoting
+	{
+		sys::bench::random next(9);
+		auto const words = sys::bench::words(64);
+		fmt::string out = "id,name,count,ratio\n";
+		for (std::size_t i = 0; i < rows; ++i)
+		{
+			out += fmt::to_string(static_cast<long>(i));
+			out += ',';
+			auto const& w = words[next(words.size())];
+			if (next(8)) out += w;
+			else out += "\"" + w + ", " + w + "\"";
+			out += ',';
+			out += fmt::to_string(static_cast<long>(next(100000)));
+			out += ',';
+			out += fmt::to_string(static_cast<double>(next(1000)) / 8, 3);
+			out += '\n';
+		}
+		return out;
+	}
+}
+
+bench_unit(csv)
+{
+	auto const text = sheet(1 << 20);
+	auto const size = text.size();
+
+	auto const most = doc::csv::threads();
+	for (std::size_t threads = 1; threads <= most; threads *= 2)
+	{
+		bench(sys::bench::label("matrix", threads), size, [&](std::size_t n)
+		{
+			while (n--)
+			{
+				fwd::matrix<long, fmt::string, long, double> m;
+				sys::bench::keep(doc::csv::load(text, m, { }, threads).rows);
+			}
+		});
+
+		bench(sys::bench::label("table", threads), size, [&](std::size_t n)
+		{
+			doc::csv::table::kind const kinds[] =
+			{
+				doc::csv::table::integer, doc::csv::table::text, doc::csv::table::integer, doc::csv::table::real
+			};
+			while (n--)
+			{
+				doc::csv::table t(kinds);
+				sys::bench::keep(doc::csv::load(text, t, { }, threads).rows);
+			}
+		});
+	}
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include "dir.hpp"
 #include "ps.hpp"
 #include "fmt.hpp"
+#include "line.hpp"
 #include "type.hpp"
 #include "str.hpp"
 #include "sys.hpp"
@@ -163,7 +164,7 @@ namespace env::os
 			}
 		}
 
-		thread_local fmt::string::view::vector w;
+		thread_local fmt::string::view::small w;
 		w = fmt::dir::split(u);
 		return w;
 	}
@@ -278,7 +279,7 @@ namespace env
 
 	fmt::string::view::span paths()
 	{
-		static thread_local fmt::string::view::vector t;
+		static thread_local fmt::string::view::small t;
 		auto u = env::var::get("PATH");
 		t = fmt::path::split(u);
 		return t;
@@ -563,7 +564,7 @@ namespace env::usr
 
 	fmt::string::view::span data_dirs()
 	{
-		static fmt::string::view::vector t;
+		static fmt::string::view::small t;
 		auto u = env::var::get("XDG_DATA_DIRS");
 		if (empty(u))
 		{
@@ -583,7 +584,7 @@ namespace env::usr
 
 	fmt::string::view::span config_dirs()
 	{
-		static fmt::string::view::vector t;
+		static fmt::string::view::small t;
 		auto u = env::var::get("XDG_CONFIG_DIRS");
 		if (empty(u))
 		{
@@ -665,9 +666,11 @@ namespace env
 		auto second = first;
 		try // process can crash
 		{
-			while (--count and std::getline(put, last, end))
+			fmt::lines lines(put, end);
+			fmt::string::view line;
+			while (--count and lines.next(line))
 			{
-				cache.emplace_back(std::move(last));
+				cache.emplace_back(line);
 			}
 			// One past the end
 			second = cache.size();
@@ -837,7 +840,7 @@ namespace env
 		}
 
 		// Program is first command in paired
-		fwd::vector<char const*> list;
+		fwd::small_vector<char const*, 16> list;
 		list.push_back(data(program));
 
 		// Arguments null terminated
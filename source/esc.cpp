@@ -0,0 +1,663 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "esc.hpp"
+#include "char.hpp"
+#include "err.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr bool within(unsigned char c, unsigned char lo, unsigned char hi)
+	{
+		return lo <= c and c <= hi;
+	}
+
+	constexpr bool isC1(char c)
+	{
+		return within(static_cast<unsigned char>(c), 0x80, 0x9F);
+	}
+
+	constexpr char prefix = '\xC2'; // first byte of C1 in UTF-8
+
+	std::size_t scan(char const* p, std::size_t i, std::size_t n, bool utf8)
+	// Position of the first byte which might start a control function
+	{
+		#ifdef __SSE2__
+		{
+			auto const esc = _mm_set1_epi8(fmt::C0::ESC);
+			auto const two = _mm_set1_epi8(prefix);
+			auto const top = _mm_set1_epi8(-0x60); // signed 0xA0
+			for (; i + 16 <= n; i += 16)
+			{
+				auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i));
+				auto const c = utf8 ? _mm_cmpeq_epi8(v, two) : _mm_cmplt_epi8(v, top);
+				auto const m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, esc), c));
+				if (0 != m) return i + static_cast<std::size_t>(__builtin_ctz(m));
+			}
+		}
+		#endif
+
+		for (; i < n; ++i)
+		{
+			auto const c = p[i];
+			if (fmt::C0::ESC == c or (utf8 ? prefix == c : isC1(c))) break;
+		}
+		return i;
+	}
+}
+
+namespace fmt::esc
+{
+	int token::param(std::size_t index, int otherwise) const
+	{
+		auto it = params.begin();
+		// Private markers come before the numbers
+		while (it != params.end() and within(static_cast<unsigned char>(*it), 0x3C, 0x3F)) ++it;
+
+		for (; 0 < index and it != params.end(); ++it)
+		{
+			if (';' == *it) --index;
+		}
+		if (0 < index) return otherwise;
+
+		bool empty = true;
+		int value = 0;
+		for (; it != params.end() and ';' != *it and ':' != *it; ++it)
+		{
+			if (not within(static_cast<unsigned char>(*it), '0', '9')) break;
+			if (value < 100000000) value = value * 10 + (*it - '0');
+			empty = false;
+		}
+		return empty ? otherwise : value;
+	}
+
+	void parser::feed(view buf)
+	{
+		assert(chunk.size() <= pos);
+		chunk = buf;
+		pos = 0;
+	}
+
+	bool parser::emit(token& tok, token::kind type)
+	{
+		tok.type = type;
+		tok.final = code;
+		tok.params = tok.inter = tok.data = view();
+		view const all = seq;
+		switch (type)
+		{
+		case token::escape:
+			tok.inter = all;
+			break;
+		case token::csi:
+			tok.params = all.substr(0, mark);
+			tok.inter = all.substr(mark);
+			break;
+		case token::dcs:
+			tok.params = all.substr(0, mark);
+			tok.inter = all.substr(mark, body - mark);
+			tok.data = all.substr(body);
+			break;
+		default:
+			tok.final = 0;
+			tok.data = all;
+		}
+		now = ground;
+		return not discard;
+	}
+
+	bool parser::introduce(char fe, token& tok)
+	{
+		seq.clear();
+		mark = body = 0;
+		discard = false;
+		switch (fe)
+		{
+		case G0::CSI:
+			kind = token::csi;
+			now = param;
+			return false;
+		case G0::DCS:
+			kind = token::dcs;
+			now = param;
+			return false;
+		case G0::OSC:
+			kind = token::osc;
+			now = str;
+			return false;
+		case G0::SOS:
+			kind = token::sos;
+			now = str;
+			return false;
+		case G0::PM:
+			kind = token::pm;
+			now = str;
+			return false;
+		case G0::APC:
+			kind = token::apc;
+			now = str;
+			return false;
+		}
+
+		tok.type = token::control;
+		tok.final = static_cast<char>(fe + 0x40);
+		tok.params = tok.inter = tok.data = view();
+		now = ground;
+		return true;
+	}
+
+	bool parser::sequence(char c, token& tok)
+	{
+		auto const u = static_cast<unsigned char>(c);
+
+		if (C0::CAN == c or C0::SUB == c)
+		{
+			// Abandoned without effect
+			now = ground;
+			++pos;
+			return false;
+		}
+
+		if (C0::ESC == c)
+		{
+			now = escape;
+			++pos;
+			return false;
+		}
+
+		if (u < 0x20)
+		{
+			// Format effectors are still performed in the middle
+			tok.type = token::text;
+			tok.final = 0;
+			tok.params = tok.inter = view();
+			tok.data = chunk.substr(pos++, 1);
+			return true;
+		}
+
+		if (0x7F == u)
+		{
+			++pos;
+			return false;
+		}
+
+		if (0x7F < u)
+		{
+			// Not part of any sequence so start over on this byte
+			now = ground;
+			return false;
+		}
+
+		++pos;
+		switch (now)
+		{
+		case escape:
+			// Nothing of a string which was swallowed carries over
+			seq.clear();
+			mark = body = 0;
+			discard = false;
+			if (within(u, 0x40, 0x5F))
+			{
+				return introduce(c, tok);
+			}
+			[[fallthrough]];
+
+		case escape_inter:
+			if (within(u, 0x20, 0x2F))
+			{
+				if (seq.size() < limit) seq += c;
+				now = escape_inter;
+				return false;
+			}
+			code = c;
+			return emit(tok, token::escape);
+
+		case param:
+			if (within(u, 0x30, 0x3F))
+			{
+				// Too long to be meant, so it is ignored like a malformed one
+				if (limit <= seq.size()) now = ignore;
+				else seq += c;
+				return false;
+			}
+			mark = seq.size();
+			[[fallthrough]];
+
+		case inter:
+			if (within(u, 0x20, 0x2F))
+			{
+				if (limit <= seq.size()) now = ignore;
+				else
+				{
+					seq += c;
+					now = inter;
+				}
+				return false;
+			}
+			if (within(u, 0x30, 0x3F))
+			{
+				now = ignore;
+				return false;
+			}
+			code = c;
+			if (token::dcs == kind)
+			{
+				body = seq.size();
+				now = str;
+				return false;
+			}
+			return emit(tok, token::csi);
+
+		case ignore:
+			if (within(u, 0x40, 0x7E))
+			{
+				if (token::dcs == kind)
+				{
+					// Swallow the string that follows
+					discard = true;
+					now = str;
+				}
+				else now = ground;
+			}
+			return false;
+
+		default:
+			assert(not "sequence state");
+			now = ground;
+			return false;
+		}
+	}
+
+	bool parser::text(char c, token& tok)
+	{
+		if (str_esc == now)
+		{
+			if ('\\' == c)
+			{
+				++pos;
+				return emit(tok, kind);
+			}
+			// Any other escape ends the string and begins the next
+			auto const ended = emit(tok, kind);
+			now = escape;
+			return ended;
+		}
+
+		if (str_held == now)
+		{
+			if (C1::ST == c)
+			{
+				++pos;
+				return emit(tok, kind);
+			}
+			// The held byte was part of the body
+			if (seq.size() < limit) seq += prefix;
+			now = str;
+		}
+
+		++pos;
+		if (C0::ESC == c)
+		{
+			now = str_esc;
+		}
+		else
+		if ((C0::BEL == c and token::osc == kind) or (not utf8 and C1::ST == c))
+		{
+			return emit(tok, kind);
+		}
+		else
+		if (C0::CAN == c or C0::SUB == c)
+		{
+			now = ground;
+		}
+		else
+		if (utf8 and prefix == c)
+		{
+			now = str_held;
+		}
+		else
+		if (seq.size() < limit)
+		{
+			seq += c;
+		}
+		return false;
+	}
+
+	bool parser::next(token& tok)
+	{
+		auto const data = chunk.data();
+		auto const size = chunk.size();
+
+		while (pos < size)
+		{
+			auto const c = data[pos];
+			switch (now)
+			{
+			case ground:
+			{
+				auto const from = pos;
+				auto to = scan(data, pos, size, utf8);
+				// Other characters of the Latin-1 supplement are plain text
+				while (utf8 and to + 1 < size and prefix == data[to] and not isC1(data[to + 1]))
+				{
+					to = scan(data, to + 2, size, utf8);
+				}
+				if (from < to)
+				{
+					pos = to;
+					tok.type = token::text;
+					tok.final = 0;
+					tok.params = tok.inter = view();
+					tok.data = chunk.substr(from, to - from);
+					return true;
+				}
+
+				++pos;
+				if (C0::ESC == c)
+				{
+					now = escape;
+				}
+				else
+				if (not utf8)
+				{
+					if (introduce(static_cast<char>(c - 0x40), tok)) return true;
+				}
+				else
+				if (pos < size)
+				{
+					if (introduce(static_cast<char>(data[pos++] - 0x40), tok)) return true;
+				}
+				else now = held;
+				break;
+			}
+
+			case held:
+				if (isC1(c))
+				{
+					++pos;
+					if (introduce(static_cast<char>(c - 0x40), tok)) return true;
+				}
+				else
+				{
+					// The held byte was only text after all
+					now = ground;
+					tok.type = token::text;
+					tok.final = 0;
+					tok.params = tok.inter = view();
+					tok.data = view(&prefix, 1);
+					return true;
+				}
+				break;
+
+			case str:
+			case str_esc:
+			case str_held:
+				if (text(c, tok)) return true;
+				break;
+
+			default:
+				if (sequence(c, tok)) return true;
+			}
+		}
+		return false;
+	}
+
+	void parser::strip(view buf, string& out)
+	{
+		feed(buf);
+		token tok;
+		while (next(tok))
+		{
+			if (token::text == tok.type)
+			{
+				out.append(tok.data.data(), tok.data.size());
+			}
+		}
+	}
+
+	string strip(view buf)
+	{
+		string out;
+		out.reserve(buf.size());
+		parser().strip(buf, out);
+		return out;
+	}
+}
+
+#ifdef test_unit
+#include <deque>
+
+namespace
+{
+	fwd::vector<fmt::esc::token> tokens(fmt::esc::parser& p, fmt::view chunk, std::deque<fmt::string>& keep)
+	// Copy the tokens of a chunk since their views do not last
+	{
+		fwd::vector<fmt::esc::token> out;
+		fmt::esc::token tok;
+		p.feed(chunk);
+		while (p.next(tok))
+		{
+			keep.emplace_back(fmt::to_string(tok.params));
+			tok.params = keep.back();
+			keep.emplace_back(fmt::to_string(tok.inter));
+			tok.inter = keep.back();
+			keep.emplace_back(fmt::to_string(tok.data));
+			tok.data = keep.back();
+			out.push_back(tok);
+		}
+		return out;
+	}
+}
+
+test_unit(esc)
+{
+	using fmt::esc::token;
+
+	// Colours removed from the text
+	assert(fmt::esc::strip("\x1b[1;31mred\x1b[0m plain") == "red plain");
+	assert(fmt::esc::strip("\x1b]0;title\a\x1b(Bdone\r\n") == "done\r\n");
+
+	// Same result when split at every byte
+	{
+		fmt::view const in = "a\x1b[38;5;208mb\xc2\x9b" "1mc\x1b]2;x\x1b\\d\xc2\xa9\x1bP1$qm\x1b\\e";
+		fmt::esc::parser p;
+		fmt::string out;
+		for (std::size_t i = 0; i < in.size(); ++i) p.strip(in.substr(i, 1), out);
+		assert(out == "abcd\xc2\xa9" "e");
+		assert(out == fmt::esc::strip(in));
+	}
+
+	std::deque<fmt::string> keep;
+
+	// Control sequence with a private marker
+	{
+		fmt::esc::parser p;
+		auto const t = tokens(p, "\x1b[?25h", keep);
+		assert(1 == t.size());
+		assert(token::csi == t[0].type and 'h' == t[0].final);
+		assert(t[0].params == "?25" and 25 == t[0].param(0));
+		assert(7 == t[0].param(1, 7));
+	}
+
+	// Parameters with defaults
+	{
+		fmt::esc::parser p;
+		auto const t = tokens(p, "\x1b[;12;H", keep);
+		assert(1 == t.size() and fmt::CSI::CUP == t[0].final);
+		assert(1 == t[0].param(0, 1) and 12 == t[0].param(1, 1) and 1 == t[0].param(2, 1));
+	}
+
+	// Operating system command ended by either terminator
+	{
+		fmt::esc::parser p;
+		auto const t = tokens(p, "\x1b]0;one\a\x1b]2;two\x1b\\", keep);
+		assert(2 == t.size());
+		assert(token::osc == t[0].type and t[0].data == "0;one");
+		assert(token::osc == t[1].type and t[1].data == "2;two");
+	}
+
+	// Device control string with its own sequence
+	{
+		fmt::esc::parser p;
+		auto const t = tokens(p, "\x1bP1$qm\x1b\\", keep);
+		assert(1 == t.size() and token::dcs == t[0].type);
+		assert(t[0].params == "1" and t[0].inter == "$" and 'q' == t[0].final and t[0].data == "m");
+	}
+
+	// Other strings, escapes and single controls
+	{
+		fmt::esc::parser p;
+		auto const t = tokens(p, "\x1bXs\x1b\\\x1b^p\x1b\\\x1b_a\x1b\\\x1b(B\x1b" "E", keep);
+		assert(5 == t.size());
+		assert(token::sos == t[0].type and t[0].data == "s");
+		assert(token::pm == t[1].type and t[1].data == "p");
+		assert(token::apc == t[2].type and t[2].data == "a");
+		assert(token::escape == t[3].type and t[3].inter == "(" and 'B' == t[3].final);
+		assert(token::control == t[4].type and fmt::C1::NEL == t[4].final);
+	}
+
+	// Eight bit controls when the stream is not UTF-8
+	{
+		fmt::esc::parser p(false);
+		auto const t = tokens(p, "x\x9b" "1m\x85y", keep);
+		assert(4 == t.size());
+		assert(token::csi == t[1].type and 1 == t[1].param(0));
+		assert(token::control == t[2].type and fmt::C1::NEL == t[2].final);
+		assert(t[3].data == "y");
+	}
+
+	// Cancelled sequence and controls in the middle of one
+	{
+		fmt::esc::parser p;
+		assert(fmt::esc::strip("\x1b[12\x18x") == "x");
+		auto const t = tokens(p, "\x1b[1\n2m", keep);
+		assert(2 == t.size() and t[0].data == "\n" and 12 == t[1].param(0));
+	}
+
+	// Escapes after a device control string which was swallowed
+	{
+		fmt::esc::parser p;
+		auto const t = tokens(p, "\x1bP1$2qjunk\x1b\\\x1b(B\x1b" "7", keep);
+		assert(2 == t.size());
+		assert(token::escape == t[0].type and t[0].inter == "(" and 'B' == t[0].final);
+		assert(token::escape == t[1].type and '7' == t[1].final);
+	}
+
+	// Endless parameters are dropped with their sequence
+	{
+		fmt::esc::parser p;
+		fmt::string in = "\x1b[";
+		in.append(1 << 17, '1');
+		in += "mx\x1b[2m";
+		auto const t = tokens(p, in, keep);
+		assert(2 == t.size() and t[0].data == "x");
+		assert(token::csi == t[1].type and 2 == t[1].param(0));
+	}
+
+	// Held C1 lead byte which turns out to be text
+	{
+		fmt::esc::parser p;
+		fmt::string out;
+		p.strip("a\xc2", out);
+		p.strip("\xa9", out);
+		assert(out == "a\xc2\xa9");
+	}
+
+	// Escapes found on either side of a vector boundary
+	for (std::size_t at = 0; at < 40; ++at)
+	{
+		fmt::string in(48, 'x');
+		in.insert(at, "\x1b[m");
+		assert(fmt::esc::strip(in) == fmt::string(48, 'x'));
+	}
+}
+
+#endif
+#ifdef bench_unit
+
+namespace
+{
+	fmt::string colored(std::size_t bytes)
+	// Words wrapped in colour changes as from a compiler or test runner
+	{
+		sys::bench::random next(7);
+		auto const words = sys::bench::ascii(bytes);
+		fmt::string out;
+		out.reserve(bytes + bytes / 4);
+		for (std::size_t i = 0; i < words.size(); ++i)
+		{
+			if (' ' == words[i] and 0 == next(6))
+			{
+				auto const fg = static_cast<int>(30 + next(8));
+				out += "\x1b[";
+				out += fmt::to_string(static_cast<long>(fg));
+				out += 'm';
+			}
+			out += words[i];
+		}
+		return out;
+	}
+}
+
+bench_unit(esc)
+{
+	constexpr std::size_t size = 4 << 20;
+
+	struct data
+	{
+		fmt::string::view label;
+		fmt::string text;
+	}
+	const input[] =
+	{
+		{ "ascii", sys::bench::ascii(size) },
+		{ "utf8", sys::bench::utf8(size) },
+		{ "colored", colored(size) },
+		{ "escapes", sys::bench::worst(size, "\x1b[0m") },
+	};
+
+	for (auto const& in : input)
+	{
+		fmt::string::view const u = in.text;
+		fmt::string out;
+		out.reserve(u.size());
+
+		bench(fmt::to_string(in.label) + "/copy", u.size(), [&](std::size_t n)
+		{
+			while (n--)
+			{
+				out.assign(u.data(), u.size());
+				sys::bench::keep(out);
+			}
+		});
+
+		bench(fmt::to_string(in.label) + "/strip", u.size(), [&](std::size_t n)
+		{
+			fmt::esc::parser p;
+			while (n--)
+			{
+				out.clear();
+				p.strip(u, out);
+				sys::bench::keep(out);
+			}
+		});
+
+		bench(fmt::to_string(in.label) + "/tokens", u.size(), [&](std::size_t n)
+		{
+			fmt::esc::parser p;
+			fmt::esc::token tok;
+			while (n--)
+			{
+				std::size_t count = 0;
+				p.feed(u);
+				while (p.next(tok)) ++count;
+				sys::bench::keep(count);
+			}
+		});
+	}
+}
+
+#endif
@@ -23,6 +23,8 @@
 #include <algorithm>
 #include <regex>
 #include <stack>
+#include <thread>
+#include <atomic>
 
 #ifdef _WIN32
 # include "win/memory.hpp"
@@ -30,6 +32,9 @@
 #else
 # include "uni/dirent.hpp"
 # include "uni/mman.hpp"
+# include <sys/uio.h>
+# include <sys/stat.h>
+# include <fcntl.h>
 #endif
 
 namespace fmt::dir
@@ -44,7 +49,7 @@ namespace fmt::dir
 		return fmt::join(p, sys::sep::dir);
 	}
 
-	string::view::vector split(string::view u)
+	string::view::small split(string::view u)
 	{
 		return fmt::split(u, sys::sep::dir);
 	}
@@ -62,7 +67,7 @@ namespace fmt::path
 		return fmt::join(p, sys::sep::path);
 	}
 
-	string::view::vector split(string::view u)
+	string::view::small split(string::view u)
 	{
 		return fmt::split(u, sys::sep::path);
 	}
@@ -105,7 +110,7 @@ namespace env::file
 	{
 		int flags = 0;
 
-		if (am & rw)
+		if (rw == (am & rw))
 		{
 			flags |= O_RDWR;
 		}
@@ -150,6 +155,13 @@ namespace env::file
 			flags |= O_CREAT;
 		}
 
+		#ifdef O_DIRECT
+		if (am & dio)
+		{
+			flags |= O_DIRECT;
+		}
+		#endif
+
 		return flags;
 	}
 
@@ -475,9 +487,35 @@ namespace env::file
 
 	// pipe.hpp
 
+	namespace
+	{
+		bool cached(int fd)
+		// Go through the cache after a direct transfer was refused for want of alignment, true if it was direct
+		{
+			#ifdef O_DIRECT
+			if (EINVAL == errno)
+			{
+				auto const flags = fcntl(fd, F_GETFL);
+				if (not fail(flags) and (flags & O_DIRECT))
+				{
+					return not fail(fcntl(fd, F_SETFL, flags & ~O_DIRECT));
+				}
+			}
+			#else
+			(void) fd;
+			#endif
+			return false;
+		}
+	}
+
 	ssize_t descriptor::write(const void* buf, size_t sz) const
 	{
-		auto const n = sys::write(fd, buf, sz);
+		auto n = sys::write(fd, buf, sz);
+		if (fail(n) and cached(fd))
+		{
+			// The tail of a direct stream is rarely whole blocks
+			n = sys::write(fd, buf, sz);
+		}
 		if (fail(n))
 		{
 			sys::err(here, fd, sz);
@@ -487,7 +525,11 @@ namespace env::file
 
 	ssize_t descriptor::read(void* buf, size_t sz) const
 	{
-		auto const n = sys::read(fd, buf, sz);
+		auto n = sys::read(fd, buf, sz);
+		if (fail(n) and cached(fd))
+		{
+			n = sys::read(fd, buf, sz);
+		}
 		if (fail(n))
 		{
 			sys::err(here, fd, sz);
@@ -505,11 +547,24 @@ namespace env::file
 		auto const c = path.data();
 
 		fd = sys::open(c, convert(am), convert(pm));
+		#ifdef O_DIRECT
+		if (fail(fd) and (am & dio) and EINVAL == errno)
+		{
+			// File systems in memory have no direct mode
+			fd = sys::open(c, convert(mode(am & ~dio)), convert(pm));
+		}
+		#endif
 		if (fail(fd))
 		{
 			sys::err(here, path, am, pm);
 			return failure;
 		}
+		#if not defined(O_DIRECT) and defined(F_NOCACHE)
+		if ((am & dio) and fail(fcntl(fd, F_NOCACHE, 1)))
+		{
+			sys::warn(here, "F_NOCACHE", path);
+		}
+		#endif
 		return success;
 	}
 
@@ -524,6 +579,318 @@ namespace env::file
 		return success;
 	}
 
+	namespace
+	{
+		#ifdef _WIN32
+		struct iovec
+		{
+			void* iov_base;
+			size_t iov_len;
+		};
+		#endif
+
+		template <bool Out> ssize_t transfer(int fd, iovec* v, int count, size_t at, int hints)
+		// Positional read or write of every buffer, trying the hints first
+		{
+			#ifdef _WIN32
+			{
+				(void) hints;
+				auto const h = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+				ssize_t total = 0;
+				for (int i = 0; i < count; ++i)
+				{
+					auto const offset = static_cast<std::uint64_t>(at) + static_cast<std::uint64_t>(total);
+					OVERLAPPED o { };
+					o.Offset = static_cast<DWORD>(offset);
+					o.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+					auto const sz = static_cast<DWORD>(std::min<size_t>(v[i].iov_len, MAXDWORD));
+					DWORD n = 0;
+					auto const ok = Out
+						? WriteFile(h, v[i].iov_base, sz, &n, &o)
+						: ReadFile(h, v[i].iov_base, sz, &n, &o);
+					if (not ok and ERROR_HANDLE_EOF != GetLastError())
+					{
+						return 0 < total ? total : invalid;
+					}
+					total += n;
+					if (n < v[i].iov_len)
+					{
+						break;
+					}
+				}
+				return total;
+			}
+			#else
+			{
+				auto const offset = static_cast<sys::off_t>(at);
+				#ifdef RWF_HIPRI
+				if (0 != hints)
+				{
+					int flags = 0;
+					if (hints & nowait) flags |= RWF_NOWAIT;
+					if (hints & hipri) flags |= RWF_HIPRI;
+
+					auto const n = Out
+						? ::pwritev2(fd, v, count, offset, flags)
+						: ::preadv2(fd, v, count, offset, flags);
+					if (not fail(n) or (ENOSYS != errno and EOPNOTSUPP != errno))
+					{
+						return n;
+					}
+					// Older kernels lack the flags, so go on without them
+				}
+				#else
+				(void) hints;
+				#endif
+
+				for (bool retry = true;; retry = false)
+				{
+					auto const n = 1 == count
+						? Out
+							? ::pwrite(fd, v->iov_base, v->iov_len, offset)
+							: ::pread(fd, v->iov_base, v->iov_len, offset)
+						: Out
+							? ::pwritev(fd, v, count, offset)
+							: ::preadv(fd, v, count, offset);
+					if (not fail(n) or not retry or not cached(fd))
+					{
+						return n;
+					}
+				}
+			}
+			#endif
+		}
+
+		bool expected(int hints)
+		// Whether a failure is the answer to a hint rather than an error
+		{
+			return (hints & nowait) and EAGAIN == errno;
+		}
+	}
+
+	ssize_t descriptor::pread(void* buf, size_t sz, size_t at, int hints) const
+	{
+		iovec v { buf, sz };
+		auto const n = transfer<false>(fd, &v, 1, at, hints);
+		if (fail(n) and not expected(hints))
+		{
+			sys::err(here, fd, sz, at);
+		}
+		return n;
+	}
+
+	ssize_t descriptor::pwrite(const void* buf, size_t sz, size_t at, int hints) const
+	{
+		iovec v { const_cast<void*>(buf), sz };
+		auto const n = transfer<true>(fd, &v, 1, at, hints);
+		if (fail(n) and not expected(hints))
+		{
+			sys::err(here, fd, sz, at);
+		}
+		return n;
+	}
+
+	ssize_t descriptor::preadv(fwd::span<fwd::span<char> const> bufs, size_t at, int hints) const
+	{
+		fwd::small_vector<iovec, 16> v;
+		for (auto const& buf : bufs)
+		{
+			v.push_back({ buf.data(), buf.size() });
+		}
+		auto const n = transfer<false>(fd, v.data(), static_cast<int>(v.size()), at, hints);
+		if (fail(n) and not expected(hints))
+		{
+			sys::err(here, fd, bufs.size(), at);
+		}
+		return n;
+	}
+
+	ssize_t descriptor::pwritev(fwd::span<fwd::span<char const> const> bufs, size_t at, int hints) const
+	{
+		fwd::small_vector<iovec, 16> v;
+		for (auto const& buf : bufs)
+		{
+			v.push_back({ const_cast<char*>(buf.data()), buf.size() });
+		}
+		auto const n = transfer<true>(fd, v.data(), static_cast<int>(v.size()), at, hints);
+		if (fail(n) and not expected(hints))
+		{
+			sys::err(here, fd, bufs.size(), at);
+		}
+		return n;
+	}
+
+	size_t descriptor::size() const
+	{
+		struct sys::stat st(fd);
+		if (sys::fail(st))
+		{
+			sys::err(here, "stat", fd);
+			return 0;
+		}
+		return static_cast<size_t>(st.st_size);
+	}
+
+	size_t descriptor::align() const
+	{
+		constexpr size_t page = 4096; // safe on every device we know
+		#if defined(STATX_DIOALIGN)
+		{
+			struct statx st;
+			if (0 == ::statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &st) and (st.stx_mask & STATX_DIOALIGN))
+			{
+				auto const most = std::max(st.stx_dio_mem_align, st.stx_dio_offset_align);
+				if (0 < most)
+				{
+					return most;
+				}
+			}
+		}
+		#endif
+		#ifndef _WIN32
+		{
+			struct sys::stat st(fd);
+			if (not sys::fail(st) and 0 < st.st_blksize)
+			{
+				return std::max(static_cast<size_t>(st.st_blksize), size_t(512));
+			}
+		}
+		#endif
+		return page;
+	}
+
+	bool descriptor::advise(advice how, size_t at, size_t sz) const
+	{
+		#if defined(POSIX_FADV_NORMAL)
+		{
+			static constexpr int native[]
+			{
+				POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM,
+				POSIX_FADV_WILLNEED, POSIX_FADV_DONTNEED, POSIX_FADV_NOREUSE,
+			};
+			auto const off = static_cast<sys::off_t>(at), len = static_cast<sys::off_t>(sz);
+			auto const no = posix_fadvise(fd, off, len, native[how]);
+			if (0 != no)
+			{
+				errno = no;
+				sys::err(here, fd, how, at, sz);
+				return failure;
+			}
+			return success;
+		}
+		#else
+		{
+			// Only a hint, which the system does not take
+			(void) how;
+			(void) at;
+			(void) sz;
+			return success;
+		}
+		#endif
+	}
+
+	ssize_t slice::read(void* buf, size_t sz) const
+	{
+		sz = std::min(sz, end - std::min(at, end));
+		if (0 == sz)
+		{
+			return 0;
+		}
+		auto const n = from.pread(buf, sz, at);
+		if (0 < n)
+		{
+			at += static_cast<size_t>(n);
+		}
+		return n;
+	}
+
+	namespace
+	{
+		constexpr size_t chunk = 4 << 20; // bytes read by a thread at once
+
+		bool fill(slice& part, char* buf)
+		// Read the whole of a slice, which fails short of its end
+		{
+			while (part.at < part.end)
+			{
+				auto const n = part.read(buf, part.end - part.at);
+				if (n <= 0)
+				{
+					return failure;
+				}
+				buf += n;
+			}
+			return success;
+		}
+	}
+
+	bool scan(descriptor const& in, block const& work, size_t size, size_t threads)
+	{
+		size = std::max<size_t>(1, size);
+		auto const total = in.size();
+		auto const count = (total + size - 1) / size;
+
+		// One buffer for each worker, which keeps it for every block it takes
+		threads = sys::workers(threads, count);
+		fwd::vector<fmt::string> bufs(threads);
+		std::atomic<bool> stop = false, error = false;
+		sys::share(threads, count, [&](size_t i, size_t worker)
+		{
+			if (stop)
+			{
+				return;
+			}
+
+			auto const at = i * size;
+			slice part(in, at, std::min(at + size, total));
+			auto& buf = bufs[worker];
+			buf.resize(part.end - at);
+			if (fill(part, buf.data()))
+			{
+				error = stop = true;
+			}
+			else
+			if (work(at, buf))
+			{
+				stop = true;
+			}
+		});
+		return error ? failure : success;
+	}
+
+	bool load(descriptor const& in, fmt::string& out, size_t threads)
+	{
+		auto const base = out.size();
+		auto const total = in.size();
+		auto const count = (total + chunk - 1) / chunk;
+		out.resize(base + total);
+
+		// Each thread reads straight into its own parts of the buffer
+		std::atomic<bool> error = false;
+		sys::share(threads, count, [&](size_t i)
+		{
+			if (error)
+			{
+				return;
+			}
+
+			auto const at = i * chunk;
+			slice part(in, at, std::min(at + chunk, total));
+			if (fill(part, out.data() + base + at))
+			{
+				error = true;
+			}
+		});
+
+		if (error)
+		{
+			out.resize(base);
+			return failure;
+		}
+		return success;
+	}
+
 	pipe::pipe()
 	{
 		int fd[2];
@@ -543,7 +910,7 @@ namespace env::file
 	bool process::start(fmt::string::view::span args)
 	{
 		fmt::string::view const del("\0", 1);
-		std::vector<char const *> list;
+		fwd::small_vector<char const*, 16> list;
 		auto s = fmt::join(args, del);
 		for (auto u : fmt::split(s, del))
 		{
@@ -971,4 +1338,598 @@ test_unit(dir)
 	assert(not env::file::remove_dir(stem));
 }
 
+test_unit(pread)
+{
+	using env::file::ssize_t;
+	using view = fmt::string::view;
+
+	auto const path = fmt::dir::join({ env::temp(), "oasys.pread" });
+	auto const data = sys::bench::ascii((9 << 20) + 123, 11);
+	env::file::descriptor out(path, env::file::ov);
+	assert(static_cast<ssize_t>(data.size()) == out.pwrite(data.data(), data.size(), 0));
+	assert(data.size() == out.size());
+
+	// Positional reads leave the cursor where it was
+	env::file::descriptor in(path, env::file::rd);
+	char buf[16];
+	assert(16 == in.pread(buf, sizeof buf, 1000));
+	assert(view(buf, 16) == view(data).substr(1000, 16));
+	assert(16 == in.read(buf, sizeof buf));
+	assert(view(buf, 16) == view(data).substr(0, 16));
+
+	// Hints are dropped where they cannot be kept, and nowait may refuse
+	auto const n = in.pread(buf, sizeof buf, 2000, env::file::nowait | env::file::hipri);
+	assert(16 == n or (env::file::fail(static_cast<int>(n)) and EAGAIN == errno));
+
+	// Scatter and gather
+	{
+		char a[5], b[7];
+		fwd::span<char> const parts[] { a, b };
+		assert(12 == in.preadv(parts, 10));
+		assert(view(a, 5) == view(data).substr(10, 5) and view(b, 7) == view(data).substr(15, 7));
+
+		fwd::span<char const> const back[] { { b, 7 }, { a, 5 } };
+		assert(12 == out.pwritev(back, data.size()));
+		assert(12 == in.pread(buf, 12, data.size()));
+		assert(view(buf, 7) == view(data).substr(15, 7) and view(buf + 7, 5) == view(data).substr(10, 5));
+		assert(0 == sys::ftruncate(out.get(), static_cast<sys::off_t>(data.size())));
+	}
+
+	// Slices of one descriptor read by many threads
+	{
+		std::atomic<bool> same = true;
+		std::atomic<env::file::size_t> seen = 0;
+		assert(not env::file::scan(in, [&](auto at, view part)
+		{
+			same = same and part == view(data).substr(at, part.size());
+			seen += part.size();
+			return success;
+		}, 1 << 20, 3));
+		assert(same and data.size() == seen);
+
+		fmt::string copy;
+		assert(not env::file::load(in, copy, 4));
+		assert(copy == data);
+	}
+
+	(void) sys::unlink(path.c_str());
+}
+
+test_unit(direct)
+{
+	using view = fmt::string::view;
+	auto const dio = env::file::dio;
+
+	// Blocks go around the cache and the tail which is not whole goes through it
+	auto const path = fmt::dir::join({ env::temp(), "oasys.direct" });
+	auto const data = sys::bench::ascii((1 << 20) + 1234, 12);
+	{
+		fmt::ofdstream out(path, env::file::mode(env::file::ov | dio), 1 << 16);
+		assert(out.write(data.data(), fmt::to<std::streamsize>(data.size())));
+		assert(out.flush());
+	}
+	{
+		fmt::ifdstream in(path, env::file::mode(env::file::rd | dio), 1 << 16);
+		fmt::string copy(data.size() + 99, '\0');
+		in.read(copy.data(), fmt::to<std::streamsize>(copy.size()));
+		assert(data.size() == fmt::to_size(in.gcount()));
+		assert(view(copy).substr(0, data.size()) == view(data));
+	}
+
+	// Block size is a power of two and advice is taken
+	{
+		env::file::descriptor in(path, env::file::rd);
+		auto const align = in.align();
+		assert(0 < align and 0 == (align & (align - 1)));
+		assert(not in.advise(env::file::sequential));
+		assert(not in.advise(env::file::dontneed, 0, align));
+	}
+
+	(void) sys::unlink(path.c_str());
+}
+
+#endif
+
+#ifdef bench_unit
+#include "env.hpp"
+#include "fs.hpp"
+#include "ps.hpp"
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <numeric>
+#include <new>
+#include <cstring>
+
+#ifndef _WIN32
+# include "uni/mqueue.hpp"
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+namespace
+{
+	using env::file::size_t;
+	using env::file::ssize_t;
+
+	double resident(env::file::descriptor const& in)
+	// Part of the file which is in the cache
+	{
+		#ifdef _WIN32
+		{
+			(void) in;
+			return 0;
+		}
+		#else
+		{
+			auto const size = in.size();
+			auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			auto const ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, in.get(), 0);
+			if (MAP_FAILED == ptr)
+			{
+				return 0;
+			}
+			fwd::vector<unsigned char> pages((size + page - 1) / page);
+			auto const ok = 0 == mincore(ptr, size, pages.data());
+			(void) munmap(ptr, size);
+			if (not ok or pages.empty())
+			{
+				return 0;
+			}
+			auto const count = std::count_if(pages.begin(), pages.end(), [](auto c) { return c & 1; });
+			return static_cast<double>(count) / static_cast<double>(pages.size());
+		}
+		#endif
+	}
+
+	bool push(env::file::writer const& to, char const* buf, size_t sz)
+	// Write all of the message or fail
+	{
+		while (0 < sz)
+		{
+			auto const n = to.write(fwd::cast_as<const void>(buf), sz);
+			if (n <= 0)
+			{
+				return failure;
+			}
+			buf += n;
+			sz -= fmt::to_size(n);
+		}
+		return success;
+	}
+
+	bool pull(env::file::reader const& from, char* buf, size_t sz)
+	// Read all of the message or fail
+	{
+		while (0 < sz)
+		{
+			auto const n = from.read(fwd::cast_as<void>(buf), sz);
+			if (n <= 0)
+			{
+				return failure;
+			}
+			buf += n;
+			sz -= fmt::to_size(n);
+		}
+		return success;
+	}
+
+	void transport(sys::bench::suite& bench, fmt::string::view kind, size_t size,
+		env::file::writer const& ax, env::file::reader const& ay,
+		env::file::writer const& bx, env::file::reader const& by)
+	// Round trips out on $a and back on $b, then bulk data through $a
+	{
+		auto const label = sys::bench::label(kind, size);
+		auto const data = sys::bench::ascii(size);
+
+		// Either side which fails stops both, sending one more message to wake the other from its read
+		std::atomic<bool> stop;
+
+		bench(label + "/rtt", size, [&](size_t n)
+		{
+			stop = false;
+			std::thread echo([&, n]
+			{
+				fmt::string buf(size, '\0');
+				for (auto m = n; m-- and not stop; )
+				{
+					if (pull(ay, buf.data(), size) or push(bx, buf.data(), size))
+					{
+						stop = true;
+						(void) push(bx, data.data(), size);
+					}
+				}
+			});
+
+			fmt::string buf(size, '\0');
+			for (auto m = n; m-- and not stop; )
+			{
+				if (push(ax, data.data(), size) or pull(by, buf.data(), size))
+				{
+					stop = true;
+					(void) push(ax, data.data(), size);
+				}
+			}
+			echo.join();
+		});
+
+		bench(label + "/bulk", size, [&](size_t n)
+		{
+			stop = false;
+			std::thread sender([&, n]
+			{
+				for (auto m = n; m-- and not stop; )
+				{
+					if (push(ax, data.data(), size))
+					{
+						stop = true;
+						(void) push(ax, data.data(), size);
+					}
+				}
+			});
+
+			fmt::string buf(size, '\0');
+			for (auto m = n; m-- and not stop; )
+			{
+				if (pull(ay, buf.data(), size))
+				{
+					stop = true;
+				}
+			}
+			sender.join();
+		});
+	}
+
+	#ifndef _WIN32
+
+	struct endpoint : env::file::socket
+	// Connected end of a local socket pair
+	{
+		explicit endpoint(int fd) : socket(fd)
+		{ }
+	};
+
+	struct queue : fwd::unique, env::file::stream
+	// POSIX message queue carrying one message per call
+	{
+		fmt::string name;
+		mqd_t mqd;
+
+		queue(fmt::string::view id, size_t size)
+		{
+			auto const pid = static_cast<long>(getpid());
+			name = "/oasys." + fmt::to_string(id) + "." + fmt::to_string(pid, 10);
+			sys::uni::msg::attr attr;
+			std::memset(&attr, 0, sizeof attr);
+			attr.mq_maxmsg = 8;
+			attr.mq_msgsize = fmt::to<long>(size);
+			// Sizes above the system limit are skipped quietly
+			mqd = mq_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR, &attr);
+		}
+
+		~queue()
+		{
+			if (not sys::fail(mqd))
+			{
+				(void) mq_close(mqd);
+				(void) mq_unlink(name.c_str());
+			}
+		}
+
+		operator bool() const
+		{
+			return not sys::fail(mqd);
+		}
+
+		ssize_t read(void* buf, size_t sz) const override
+		{
+			return mq_receive(mqd, static_cast<char*>(buf), sz, nullptr);
+		}
+
+		ssize_t write(const void* buf, size_t sz) const override
+		{
+			return sys::fail(mq_send(mqd, static_cast<char const*>(buf), sz, 0)) ? -1 : fmt::to<ssize_t>(sz);
+		}
+	};
+
+	class ring : fwd::unique, public env::file::stream
+	// Single producer, single consumer byte ring in shared memory
+	{
+		struct header
+		{
+			alignas(64) std::atomic<size_t> head; // written by producer
+			alignas(64) std::atomic<size_t> tail; // written by consumer
+		};
+
+		static constexpr size_t capacity = 1 << 20;
+		env::file::map_ptr map;
+
+		header* control() const
+		{
+			return static_cast<header*>(map.get());
+		}
+
+		char* data() const
+		{
+			return static_cast<char*>(map.get()) + sizeof (header);
+		}
+
+	public:
+
+		ring()
+		: map(sys::uni::shm::map(sizeof (header) + capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1))
+		{
+			if (MAP_FAILED != map.get())
+			{
+				new (control()) header { { 0 }, { 0 } };
+			}
+		}
+
+		operator bool() const
+		{
+			return MAP_FAILED != map.get();
+		}
+
+		ssize_t write(const void* buf, size_t sz) const override
+		{
+			auto const h = control();
+			auto const head = h->head.load(std::memory_order_relaxed);
+			size_t tail;
+			// Wait for the consumer to make room
+			while (head - (tail = h->tail.load(std::memory_order_acquire)) == capacity)
+			{
+				std::this_thread::yield();
+			}
+
+			auto const n = std::min(sz, capacity - (head - tail));
+			auto const at = head % capacity;
+			auto const first = std::min(n, capacity - at);
+			std::memcpy(data() + at, buf, first);
+			std::memcpy(data(), static_cast<char const*>(buf) + first, n - first);
+			h->head.store(head + n, std::memory_order_release);
+			return fmt::to<ssize_t>(n);
+		}
+
+		ssize_t read(void* buf, size_t sz) const override
+		{
+			auto const h = control();
+			auto const tail = h->tail.load(std::memory_order_relaxed);
+			size_t head;
+			// Wait for the producer to fill some
+			while ((head = h->head.load(std::memory_order_acquire)) == tail)
+			{
+				std::this_thread::yield();
+			}
+
+			auto const n = std::min(sz, head - tail);
+			auto const at = tail % capacity;
+			auto const first = std::min(n, capacity - at);
+			std::memcpy(buf, data() + at, first);
+			std::memcpy(static_cast<char*>(buf) + first, data(), n - first);
+			h->tail.store(tail + n, std::memory_order_release);
+			return fmt::to<ssize_t>(n);
+		}
+	};
+
+	#endif
+}
+
+bench_unit(file)
+{
+	// Whole file read through each layer with a range of buffer sizes
+	auto const path = fmt::dir::join({ env::temp(), "oasys.bench" });
+	constexpr size_t total = 8 << 20;
+	{
+		auto const data = sys::bench::ascii(total);
+		env::file::descriptor out(path, env::file::ov);
+		if (push(out, data.data(), data.size()))
+		{
+			sys::warn(here, "write", path);
+			(void) sys::unlink(path.c_str());
+			return;
+		}
+	}
+
+	for (size_t size : { 512, 4 << 10, 64 << 10, 1 << 20 })
+	{
+		fmt::string buf(size, '\0');
+
+		bench(sys::bench::label("read", size), total, [&](size_t n)
+		{
+			while (n--)
+			{
+				env::file::descriptor in(path, env::file::rd);
+				while (0 < in.read(buf.data(), size));
+				sys::bench::clobber();
+			}
+		});
+
+		bench(sys::bench::label("fdstream", size), total, [&](size_t n)
+		{
+			while (n--)
+			{
+				fmt::ifdstream in(path, env::file::rd, size);
+				while (in.read(buf.data(), fmt::to<std::streamsize>(size)) or 0 < in.gcount());
+				sys::bench::clobber();
+			}
+		});
+
+		bench(sys::bench::label("ifstream", size), total, [&](size_t n)
+		{
+			fmt::string store(size, '\0');
+			while (n--)
+			{
+				std::ifstream in;
+				in.rdbuf()->pubsetbuf(store.data(), fmt::to<std::streamsize>(size));
+				in.open(path, std::ios::binary);
+				while (in.read(buf.data(), fmt::to<std::streamsize>(size)) or 0 < in.gcount());
+				sys::bench::clobber();
+			}
+		});
+	}
+
+	// Whole file read by threads at their own offsets
+	for (size_t threads : { 1, 2, 4 })
+	{
+		bench(sys::bench::label("load", threads), total, [&](size_t n)
+		{
+			while (n--)
+			{
+				env::file::descriptor in(path, env::file::rd);
+				fmt::string s;
+				(void) env::file::load(in, s, threads);
+				sys::bench::keep(s.size());
+			}
+		});
+	}
+
+	// Sequential scans warm, then with the file evicted before each as though under pressure,
+	// counting how much of it is left in the cache to crowd out other work
+	{
+		constexpr size_t size = 1 << 20;
+		fmt::string buf(size, '\0');
+		env::file::descriptor file(path, env::file::rd);
+
+		auto const scan = [&](env::file::mode am, bool cold, bool drop)
+		{
+			return [&, am, cold, drop](size_t n)
+			{
+				while (n--)
+				{
+					if (cold) (void) file.advise(env::file::dontneed);
+					fmt::ifdstream in(path, am, size);
+					while (in.read(buf.data(), fmt::to<std::streamsize>(size)) or 0 < in.gcount());
+					if (drop) (void) in.advise(env::file::dontneed);
+					sys::bench::clobber();
+				}
+			};
+		};
+
+		auto const direct = env::file::mode(env::file::rd | env::file::dio);
+		auto const cases =
+		{
+			std::tuple("scan/cached", env::file::rd, false, false),
+			std::tuple("scan/direct", direct, false, false),
+			std::tuple("scan/dontneed", env::file::rd, false, true),
+			std::tuple("cold/cached", env::file::rd, true, false),
+			std::tuple("cold/direct", direct, true, false),
+		};
+		for (auto const& [label, am, cold, drop] : cases)
+		{
+			(void) file.advise(env::file::dontneed);
+			bench(label, total, scan(am, cold, drop));
+			bench.results.back().counters.emplace_back("resident", resident(file));
+		}
+	}
+
+	// Mapped pages touched one cache line at a time
+	{
+		env::file::descriptor in(path, env::file::rd);
+		size_t size = 0;
+		auto const map = env::file::make_map(in.get(), 0, 0, env::file::rd, &size);
+		auto const base = static_cast<char const*>(map.get());
+		constexpr size_t line = 64;
+		auto const lines = size / line;
+		if (not map or 0 == lines)
+		{
+			sys::warn(here, "map", path, size);
+			(void) sys::unlink(path.c_str());
+			return;
+		}
+
+		fwd::vector<size_t> order(lines);
+		std::iota(order.begin(), order.end(), size_t(0));
+		sys::bench::random next(lines);
+		for (auto i = lines; 1 < i; --i)
+		{
+			std::swap(order[i - 1], order[next(i)]);
+		}
+
+		bench("map/sequential", line, [&](size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				sys::bench::keep(base[(i % lines) * line]);
+			}
+		});
+
+		bench("map/random", line, [&](size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				sys::bench::keep(base[order[i % lines] * line]);
+			}
+		});
+	}
+
+	(void) sys::unlink(path.c_str());
+}
+
+bench_unit(pstream)
+{
+	// Round trip through a child process that echoes its input
+	fmt::pstream cat({ "cat" });
+	for (size_t size : { 64, 1 << 10, 16 << 10 })
+	{
+		auto const data = sys::bench::ascii(size);
+		fmt::string buf(size, '\0');
+		auto const z = fmt::to<std::streamsize>(size);
+
+		bench(fmt::to_string(size, 10), size, [&](size_t n)
+		{
+			while (n-- and cat.write(data.data(), z).flush() and cat.read(buf.data(), z));
+		});
+	}
+	cat.close(0);
+	(void) cat.wait();
+}
+
+#ifndef _WIN32
+bench_unit(ipc)
+{
+	// Same message sizes over each transport
+	for (size_t size : { 64, 1 << 10, 8 << 10, 64 << 10 })
+	{
+		{
+			env::file::pipe a, b;
+			transport(bench, "pipe", size, a, a, b, b);
+		}
+		{
+			env::file::fifo a("bench.a", env::file::rw), b("bench.b", env::file::rw);
+			if (a.connect() and b.connect())
+			{
+				transport(bench, "fifo", size, a, a, b, b);
+			}
+		}
+		{
+			int fd[2];
+			if (sys::fail(socketpair(AF_UNIX, SOCK_STREAM, 0, fd)))
+			{
+				sys::warn(here, "socketpair");
+			}
+			else
+			{
+				endpoint a(fd[0]), b(fd[1]);
+				transport(bench, "socket", size, a, b, b, a);
+			}
+		}
+		{
+			// Bounded by the system message size limit
+			queue a("a", size), b("b", size);
+			if (a and b)
+			{
+				transport(bench, "mqueue", size, a, a, b, b);
+			}
+		}
+		{
+			ring a, b;
+			if (a and b)
+			{
+				transport(bench, "shm", size, a, a, b, b);
+			}
+		}
+	}
+}
+#endif
+
 #endif
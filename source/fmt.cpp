@@ -6,14 +6,18 @@
 #include "str.hpp"
 #include "type.hpp"
 #include "char.hpp"
+#include "line.hpp"
+#include "flat.hpp"
 #include "sync.hpp"
 #include "err.hpp"
 #include <sstream>
 #include <iomanip>
 #include <charconv>
+#include <cstring>
 #include <system_error>
 #include <cstdlib>
 #include <cmath>
+#include <thread>
 
 namespace
 {
@@ -23,7 +27,7 @@ namespace
 
 		sys::exclusive<fmt::string::set> cache;
 		sys::exclusive<fmt::view::vector> store;
-		sys::exclusive<std::map<fmt::view, fmt::name>> table;
+		sys::exclusive<fwd::hash_map<fmt::view, fmt::name>> table;
 
 	public:
 
@@ -130,10 +134,9 @@ namespace
 			auto wstore = store.write();
 			auto wtable = table.write();
 
-			fmt::string line;
-			while (std::getline(in, line, end))
+			for (auto const line : fmt::lines(in, end))
 			{
-				auto const p = wcache->emplace(move(line));
+				auto const p = wcache->emplace(line);
 				assert(p.second);
 
 				auto const size = wstore->size();
@@ -375,8 +378,156 @@ namespace fmt
 	{
 		return strings::registry().put(out, end);
 	}
+
+	// line.hpp
+
+	env::file::ssize_t lines::adapter::read(fwd::as_ptr<void> ptr, env::file::size_t sz) const
+	{
+		auto const buf = stream->rdbuf();
+		auto const out = static_cast<char*>(ptr);
+		if (whole)
+		{
+			return buf->sgetn(out, static_cast<std::streamsize>(sz));
+		}
+
+		// Nothing past the end of the line is taken out of the stream buffer
+		using traits = std::char_traits<char>;
+		env::file::size_t n = 0;
+		while (n < sz)
+		{
+			auto const c = buf->sbumpc();
+			if (traits::eq_int_type(c, traits::eof())) break;
+			out[n] = traits::to_char_type(c);
+			if (eol == out[n++]) break;
+		}
+		return static_cast<env::file::ssize_t>(n);
+	}
+
+	lines::lines(string::in::ref in, char end) : from(wrap), eol(end)
+	{
+		constexpr std::streamoff none = -1;
+		auto const at = in.rdbuf()->pubseekoff(0, std::ios::cur, std::ios::in);
+		wrap.whole = none != static_cast<std::streamoff>(at);
+		wrap.stream = &in;
+		wrap.eol = end;
+	}
+
+	lines::~lines()
+	{
+		if (wrap.stream and head < tail)
+		{
+			constexpr std::streamoff none = -1;
+			auto const back = -static_cast<std::streamoff>(tail - head);
+			auto const at = wrap.stream->rdbuf()->pubseekoff(back, std::ios::cur, std::ios::in);
+			if (none == static_cast<std::streamoff>(at))
+			{
+				sys::warn(here, "seek", back);
+			}
+		}
+	}
+
+	bool lines::fill()
+	{
+		if (0 < head)
+		{
+			// Only the partial line moves
+			std::memmove(buf.data(), buf.data() + head, tail - head);
+			seen -= head;
+			tail -= head;
+			head = 0;
+		}
+
+		if (buf.size() < tail + chunk)
+		{
+			// Lines longer than a chunk grow the buffer
+			buf.resize(std::max(2 * buf.size(), tail + chunk));
+		}
+
+		auto const n = from.read(buf.data() + tail, buf.size() - tail);
+		if (n <= 0)
+		{
+			if (n < 0) sys::warn(here, "read");
+			done = true;
+			return failure;
+		}
+		tail += static_cast<std::size_t>(n);
+		return success;
+	}
+
+	bool lines::next(view& line)
+	{
+		for (;;)
+		{
+			auto const data = buf.data();
+			if (seen < tail)
+			{
+				auto const at = static_cast<char const*>(std::memchr(data + seen, eol, tail - seen));
+				if (nullptr != at)
+				{
+					auto const stop = static_cast<std::size_t>(at - data);
+					line = view(data + head, stop - head);
+					head = seen = stop + 1;
+					return true;
+				}
+				seen = tail;
+			}
+
+			if (done)
+			{
+				// Last line without an end
+				if (head < tail)
+				{
+					line = view(data + head, tail - head);
+					head = seen = tail;
+					return true;
+				}
+				if (wrap.stream)
+				{
+					wrap.stream->setstate(std::ios::eofbit | std::ios::failbit);
+				}
+				return false;
+			}
+
+			fill();
+		}
+	}
+}
+
+#if defined(test_unit) || defined(bench_unit)
+
+namespace
+{
+	struct trickle : env::file::reader
+	// Memory read back a few bytes at a time
+	{
+		mutable fmt::string::view data;
+		std::size_t step;
+
+		trickle(fmt::string::view u, std::size_t n) : data(u), step(n)
+		{ }
+
+		env::file::ssize_t read(fwd::as_ptr<void> buf, env::file::size_t sz) const override
+		{
+			auto const n = std::min({ sz, step, data.size() });
+			std::memcpy(buf, data.data(), n);
+			data.remove_prefix(n);
+			return static_cast<env::file::ssize_t>(n);
+		}
+	};
+
+	struct unseekable : std::streambuf
+	// Memory behind a stream buffer which cannot seek, as for a pipe
+	{
+		fmt::string data;
+
+		explicit unseekable(fmt::string::view u) : data(u)
+		{
+			setg(data.data(), data.data(), data.data() + data.size());
+		}
+	};
 }
 
+#endif
 #ifdef test_unit
 
 test_unit(dig)
@@ -435,6 +586,12 @@ test_unit(type)
 			assert(t.front() == "1");
 			assert(t.back() == "3");
 		}
+
+		// Few fields are kept inline without allocating
+		auto const count = sys::bench::allocations();
+		auto const t = fmt::split("a,b,c,d", ",");
+		assert(4 == t.size() and not t.spilled());
+		assert(count == sys::bench::allocations());
 	}
 
 	// String view null terminator
@@ -484,6 +641,305 @@ test_unit(char)
 		ss << fmt::io::fg_green << "GREEN" << fmt::io::fg_off;
 		assert(ss.str() == "\x1b[32mGREEN\x1b[39m");
 	}
+
+	// Sequences are spelled out at compile time
+	{
+		constexpr auto& s = fmt::io::escaped<fmt::G0::CSI, fmt::CSI::CUP, 12, 0, 345>;
+		static_assert(11 == s.size and 'H' == s.data[10] and '0' == s.data[5]);
+		assert(fmt::string::view(s.data, s.size) == "\x1b[12;0;345H");
+
+		constexpr auto& t = fmt::io::escaped<fmt::G0::CSI, fmt::CSI::CUP>;
+		static_assert(3 == t.size);
+
+		fmt::string::stream ss;
+		ss << fmt::io::ctl<fmt::CSI::CUP, 1, 1> << fmt::io::enc<'a', 'b'>;
+		assert(ss.str() == "\x1b[1;1Hab");
+	}
+
+	// Parameters known at run time
+	{
+		fmt::string::stream ss;
+		ss << fmt::io::rendition({ fmt::SGR::fg, 5, 208 }) << fmt::io::control(fmt::CSI::CUP, { });
+		assert(ss.str() == "\x1b[38;5;208m\x1b[H");
+
+		// Too many parameters are dropped rather than overflowing
+		constexpr int n = 1000000000;
+		auto const big = fmt::io::control(fmt::CSI::SGR, { n, n, n, n, n, n, n, n, n, n, n, n });
+		assert(big.str().size() < 96 and big.str().ends_with('m'));
+		assert(big.str().starts_with("\x1b[1000000000;1000000000;"));
+	}
+}
+
+test_unit(lines)
+{
+	// Lines which straddle every read
+	{
+		fmt::string::view const text = "one\ntwo\n\nfour";
+		for (std::size_t step = 1; step < 6; ++step)
+		{
+			trickle in(text, step);
+			fmt::string::vector got;
+			for (auto const line : fmt::lines(in))
+			{
+				got.emplace_back(line);
+			}
+			assert(4 == got.size());
+			assert(got[0] == "one" and got[1] == "two" and got[2].empty() and got[3] == "four");
+		}
+	}
+
+	// Line longer than one chunk
+	{
+		fmt::string const text = fmt::string(3 * fmt::lines::chunk, 'x') + "\ny\n";
+		trickle in(text, fmt::lines::chunk / 3);
+		fmt::lines lines(in);
+		fmt::string::view line;
+		assert(lines.next(line) and line.size() == 3 * fmt::lines::chunk);
+		assert(lines.next(line) and line == "y");
+		assert(not lines.next(line));
+	}
+
+	// Streams fail at the end as with getline
+	{
+		fmt::string::stream ss("a;b;c");
+		fmt::string::vector got;
+		for (auto const line : fmt::lines(ss, ';'))
+		{
+			got.emplace_back(line);
+		}
+		assert(3 == got.size() and got[2] == "c");
+		assert(ss.fail() and ss.eof());
+	}
+
+	// Stopping early gives back what was read ahead
+	{
+		fmt::string::stream ss("first\nsecond\nthird\n");
+		{
+			fmt::lines lines(ss);
+			fmt::string::view line;
+			assert(lines.next(line) and line == "first");
+		}
+		fmt::string rest;
+		assert(std::getline(ss, rest) and rest == "second");
+	}
+
+	// Stopping early leaves the rest where nothing can be given back
+	{
+		unseekable buf("first\nsecond\nthird");
+		std::istream in(&buf);
+		{
+			fmt::lines lines(in);
+			fmt::string::view line;
+			assert(lines.next(line) and line == "first");
+		}
+		fmt::string rest;
+		assert(std::getline(in, rest) and rest == "second");
+		assert(std::getline(in, rest) and rest == "third");
+	}
+}
+
+#endif
+
+#ifdef bench_unit
+
+bench_unit(type)
+{
+	// Short tokens and multi-megabyte buffers of each kind
+	struct data
+	{
+		fmt::string::view label;
+		fmt::string text;
+	}
+	const input[] =
+	{
+		{ "word", sys::bench::ascii(16) },
+		{ "ascii", sys::bench::ascii(4 << 20) },
+		{ "utf8", sys::bench::utf8(4 << 20) },
+		{ "blank", sys::bench::worst(4 << 20, " \t\n") },
+		{ "solid", sys::bench::worst(4 << 20, "x") },
+		{ "nest", sys::bench::worst(4 << 20, "{{}") },
+	};
+
+	auto const label = [](fmt::string::view op, data const& in)
+	{
+		return fmt::to_string(op) + "/" + fmt::to_string(in.label);
+	};
+
+	for (auto const& in : input)
+	{
+		fmt::string::view const u = in.text;
+		auto const z = u.size();
+
+		bench(label("split", in), z, [u](size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::split(u));
+		});
+
+		bench(label("split,", in), z, [u](size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::split(u, ","));
+		});
+
+		bench(label("trim", in), z, [u](size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::trim(u));
+		});
+
+		bench(label("upper", in), z, [u](size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::to_upper(u));
+		});
+
+		bench(label("lower", in), z, [u](size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::to_lower(u));
+		});
+
+		bench(label("replace", in), z, [u](size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::replace(u, " ", "  "));
+		});
+
+		bench(label("embrace", in), z, [u](size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::embrace(u, "{}"));
+		});
+	}
+}
+
+bench_unit(dig)
+{
+	constexpr size_t size = 1 << 10;
+	sys::bench::random next(42);
+
+	fmt::string::vector integers, decimals;
+	fwd::vector<long> longs;
+	fwd::vector<double> doubles;
+	for (size_t i = 0; i < size; ++i)
+	{
+		auto const l = static_cast<long>(next()) >> next(64);
+		auto const d = static_cast<double>(l) / static_cast<double>(1 + next(1000));
+		integers.emplace_back(fmt::to_string(l, 10));
+		decimals.emplace_back(fmt::to_string(d, 6));
+		longs.push_back(l);
+		doubles.push_back(d);
+	}
+
+	bench("to_long", [&](size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			sys::bench::keep(fmt::to_long(integers[i % size]));
+		}
+	});
+
+	bench("to_double", [&](size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			sys::bench::keep(fmt::to_double(decimals[i % size]));
+		}
+	});
+
+	bench("to_string/long", [&](size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			sys::bench::keep(fmt::to_string(longs[i % size], 10));
+		}
+	});
+
+	bench("to_string/double", [&](size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			sys::bench::keep(fmt::to_string(doubles[i % size], 6));
+		}
+	});
+}
+
+bench_unit(name)
+{
+	// Words are interned before timing so only lookups are measured
+	auto const words = sys::bench::words(1 << 12);
+	auto const size = words.size();
+
+	fwd::vector<fmt::name> names;
+	fmt::string::view::vector keys;
+	for (auto const& word : words)
+	{
+		auto const id = fmt::set(word);
+		names.push_back(id);
+		keys.push_back(fmt::get(id));
+	}
+
+	auto const most = std::max(1u, std::thread::hardware_concurrency());
+	for (size_t threads = 1; threads <= most; threads *= 2)
+	{
+		bench.parallel("put", threads, 0, [&](size_t n, size_t id)
+		{
+			for (auto i = id * 997; n--; ++i)
+			{
+				sys::bench::keep(fmt::put(keys[i % size]));
+			}
+		});
+
+		bench.parallel("set", threads, 0, [&](size_t n, size_t id)
+		{
+			for (auto i = id * 997; n--; ++i)
+			{
+				sys::bench::keep(fmt::set(keys[i % size]));
+			}
+		});
+
+		bench.parallel("get", threads, 0, [&](size_t n, size_t id)
+		{
+			for (auto i = id * 997; n--; ++i)
+			{
+				sys::bench::keep(fmt::get(names[i % size]));
+			}
+		});
+	}
+}
+
+
+bench_unit(lines)
+{
+	auto const text = sys::bench::ascii(8 << 20);
+	auto const size = text.size();
+
+	bench("getline", size, [&text](size_t n)
+	{
+		while (n--)
+		{
+			fmt::string::stream ss(text);
+			std::size_t count = 0;
+			for (fmt::string line; std::getline(ss, line); ++count);
+			sys::bench::keep(count);
+		}
+	});
+
+	bench("stream", size, [&text](size_t n)
+	{
+		while (n--)
+		{
+			fmt::string::stream ss(text);
+			std::size_t count = 0;
+			for (auto const line : fmt::lines(ss)) count += not line.empty();
+			sys::bench::keep(count);
+		}
+	});
+
+	bench("reader", size, [&text](size_t n)
+	{
+		while (n--)
+		{
+			trickle in(text, fmt::lines::chunk);
+			std::size_t count = 0;
+			for (auto const line : fmt::lines(in)) count += not line.empty();
+			sys::bench::keep(count);
+		}
+	});
 }
 
 #endif
@@ -0,0 +1,400 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "hash.hpp"
+#include "fmt.hpp"
+#include "flat.hpp"
+#include "err.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <random>
+#if defined(__GNUC__) and defined(__x86_64__)
+# include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+# include <arm_acle.h>
+#endif
+
+namespace
+{
+	constexpr std::uint32_t poly = 0x82f63b78; // Castagnoli, reflected
+
+	constexpr auto slices = []
+	// Eight bytes at a time, each table one byte further along than the last
+	{
+		std::array<std::array<std::uint32_t, 256>, 8> table { };
+		for (std::uint32_t n = 0; n < 256; ++n)
+		{
+			auto crc = n;
+			for (int k = 0; k < 8; ++k)
+			{
+				crc = crc & 1 ? (crc >> 1) ^ poly : crc >> 1;
+			}
+			table[0][n] = crc;
+		}
+		for (std::uint32_t n = 0; n < 256; ++n)
+		{
+			for (std::size_t k = 1; k < 8; ++k)
+			{
+				auto const crc = table[k - 1][n];
+				table[k][n] = (crc >> 8) ^ table[0][crc & 0xff];
+			}
+		}
+		return table;
+	}();
+
+	std::uint32_t software(std::uint32_t crc, char const* p, std::size_t n)
+	{
+		auto const& t = slices;
+		for (; 8 <= n; p += 8, n -= 8)
+		{
+			auto const word = fmt::impl::read<8>(p) ^ crc;
+			crc = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^ t[4][(word >> 24) & 0xff]
+			    ^ t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^ t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+		}
+		for (; 0 < n; ++p, --n)
+		{
+			crc = (crc >> 8) ^ t[0][(crc ^ static_cast<unsigned char>(*p)) & 0xff];
+		}
+		return crc;
+	}
+
+	#if (defined(__GNUC__) and defined(__x86_64__)) or defined(__ARM_FEATURE_CRC32)
+	#define crc_hardware
+
+	using matrix = std::array<std::uint32_t, 32>;
+
+	constexpr std::uint32_t times(matrix const& m, std::uint32_t v)
+	{
+		std::uint32_t sum = 0;
+		for (std::size_t k = 0; 0 != v; v >>= 1, ++k)
+		{
+			if (v & 1) sum ^= m[k];
+		}
+		return sum;
+	}
+
+	constexpr matrix square(matrix const& m)
+	{
+		matrix r { };
+		for (std::size_t k = 0; k < 32; ++k)
+		{
+			r[k] = times(m, m[k]);
+		}
+		return r;
+	}
+
+	template <std::size_t Length> constexpr auto zeros = []
+	// Moves a checksum past this many zero bytes, one table for each of its bytes
+	{
+		static_assert(std::has_single_bit(Length));
+		matrix m { poly };
+		for (std::size_t k = 1; k < 32; ++k)
+		{
+			m[k] = std::uint32_t(1) << (k - 1);
+		}
+		for (auto bits = 8 * Length; 1 < bits; bits >>= 1)
+		{
+			m = square(m);
+		}
+		std::array<std::array<std::uint32_t, 256>, 4> table { };
+		for (std::uint32_t n = 0; n < 256; ++n)
+		{
+			for (std::size_t k = 0; k < 4; ++k)
+			{
+				table[k][n] = times(m, n << (8 * k));
+			}
+		}
+		return table;
+	}();
+
+	template <std::size_t Length> std::uint32_t shift(std::uint32_t crc)
+	{
+		auto const& t = zeros<Length>;
+		return t[0][crc & 0xff] ^ t[1][(crc >> 8) & 0xff] ^ t[2][(crc >> 16) & 0xff] ^ t[3][crc >> 24];
+	}
+
+	#ifdef __x86_64__
+	#define crc_target __attribute__((target("sse4.2")))
+
+	bool supported()
+	{
+		return __builtin_cpu_supports("sse4.2");
+	}
+
+	crc_target inline std::uint32_t step(std::uint32_t crc, std::uint64_t word)
+	{
+		return static_cast<std::uint32_t>(_mm_crc32_u64(crc, word));
+	}
+
+	crc_target inline std::uint32_t step(std::uint32_t crc, unsigned char byte)
+	{
+		return _mm_crc32_u8(crc, byte);
+	}
+	#else
+	#define crc_target
+
+	bool supported()
+	{
+		return true;
+	}
+
+	inline std::uint32_t step(std::uint32_t crc, std::uint64_t word)
+	{
+		return __crc32cd(crc, word);
+	}
+
+	inline std::uint32_t step(std::uint32_t crc, unsigned char byte)
+	{
+		return __crc32cb(crc, byte);
+	}
+	#endif
+
+	template <std::size_t Length> crc_target std::uint32_t lanes(std::uint32_t crc, char const*& p, std::size_t& n)
+	// Three runs at once hide the latency of the instruction, then are joined by shifting
+	{
+		for (; 3 * Length <= n; p += 3 * Length, n -= 3 * Length)
+		{
+			std::uint32_t b = 0, c = 0;
+			for (std::size_t k = 0; k < Length; k += 8)
+			{
+				std::uint64_t x, y, z;
+				std::memcpy(&x, p + k, 8);
+				std::memcpy(&y, p + k + Length, 8);
+				std::memcpy(&z, p + k + 2 * Length, 8);
+				crc = step(crc, x);
+				b = step(b, y);
+				c = step(c, z);
+			}
+			crc = shift<Length>(crc) ^ b;
+			crc = shift<Length>(crc) ^ c;
+		}
+		return crc;
+	}
+
+	crc_target std::uint32_t hardware(std::uint32_t crc, char const* p, std::size_t n)
+	{
+		crc = lanes<8192>(crc, p, n);
+		crc = lanes<256>(crc, p, n);
+		for (; 8 <= n; p += 8, n -= 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, p, 8);
+			crc = step(crc, word);
+		}
+		for (; 0 < n; ++p, --n)
+		{
+			crc = step(crc, static_cast<unsigned char>(*p));
+		}
+		return crc;
+	}
+	#endif
+}
+
+namespace fmt
+{
+	std::uint32_t crc32c(std::string_view s, std::uint32_t crc)
+	{
+		crc = ~crc;
+		#ifdef crc_hardware
+		static bool const fast = supported();
+		if (fast)
+		{
+			return ~hardware(crc, s.data(), s.size());
+		}
+		#endif
+		return ~software(crc, s.data(), s.size());
+	}
+
+	std::uint64_t entropy()
+	{
+		// Some systems give a fixed sequence, so the clock and the layout are mixed in
+		std::uint64_t bits = 0;
+		try
+		{
+			std::random_device device;
+			bits = (static_cast<std::uint64_t>(device()) << 32) ^ device();
+		}
+		catch (std::exception const& error)
+		{
+			sys::warn(here, error.what());
+		}
+		auto const now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+		auto const where = reinterpret_cast<std::uintptr_t>(&bits);
+		return hash(static_cast<std::uint64_t>(now) ^ where, bits);
+	}
+}
+
+#ifdef test_unit
+
+namespace
+{
+	constexpr auto compiled = fmt::hash("compile time key");
+}
+
+test_unit(hash)
+{
+	// Same value when evaluated by the compiler
+	{
+		static_assert(fmt::hash("") != fmt::hash("a"));
+		static_assert(fmt::hash("ab") != fmt::hash("ba"));
+		fmt::string::view const key = "compile time key";
+		assert(compiled == fmt::hash(key));
+	}
+	// Every length reads its bytes and no others
+	{
+		auto const data = sys::bench::ascii(512, 7);
+		fwd::vector<std::uint64_t> seen;
+		for (std::size_t size = 0; size < 300; ++size)
+		{
+			fmt::string::view const u(data.data(), size);
+			fmt::string copy(u);
+			copy += "guard";
+			auto const value = fmt::hash(u);
+			assert(value == fmt::hash(fmt::string::view(copy.data(), size)));
+			seen.push_back(value);
+		}
+		std::sort(seen.begin(), seen.end());
+		assert(seen.end() == std::adjacent_find(seen.begin(), seen.end()));
+	}
+	// Misaligned starts give the same value
+	{
+		char buffer[80] { };
+		fmt::string::view const key = "misaligned text longer than sixteen bytes";
+		for (std::size_t offset = 0; offset < 8; ++offset)
+		{
+			std::copy(key.begin(), key.end(), buffer + offset);
+			assert(fmt::hash(key) == fmt::hash(fmt::string::view(buffer + offset, key.size())));
+		}
+	}
+	// One changed bit changes about half of the hash
+	{
+		auto data = sys::bench::ascii(100, 3);
+		auto const before = fmt::hash(data);
+		int flipped = 0;
+		for (std::size_t bit = 0; bit < 8 * data.size(); ++bit)
+		{
+			data[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+			flipped += std::popcount(before ^ fmt::hash(data));
+			data[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+		}
+		auto const mean = static_cast<double>(flipped) / (8 * data.size());
+		assert(28 < mean and mean < 36);
+	}
+	// Seeds give unrelated values
+	{
+		fmt::string::view const key = "seeded";
+		assert(fmt::hash(key, 1) != fmt::hash(key, 2));
+		assert(fmt::hash(key, fmt::seed()) == fmt::hash(key, fmt::seed()));
+		assert(fmt::hash(1) != fmt::hash(2));
+		assert(fmt::hash(1, 1) != fmt::hash(1, 2));
+	}
+	// Combination depends on the order of the parts
+	{
+		auto const a = fmt::hash("first"), b = fmt::hash("second");
+		assert(fmt::combine(a, b) != fmt::combine(b, a));
+		fmt::diff::pair const p { 1, 2 }, q { 2, 1 };
+		assert(fmt::hash(p) != fmt::hash(q));
+		assert(fmt::hash(p) == fmt::hash(std::pair<long, long>(1, 2)));
+		fmt::string::view::pair const u { "key", "value" };
+		assert(fmt::hash(u) == fmt::combine(fmt::hash("key"), fmt::hash("value")));
+		assert(fwd::hash<fmt::diff::pair>()(p) == fmt::hash(p, fmt::seed()));
+	}
+	// Checksums agree with the bit at a time definition over every path
+	{
+		assert(0xe3069283 == fmt::crc32c("123456789"));
+		assert(0 == fmt::crc32c(""));
+
+		auto const bits = [](fmt::string::view u)
+		{
+			std::uint32_t crc = ~0u;
+			for (auto const c : u)
+			{
+				crc ^= static_cast<unsigned char>(c);
+				for (int k = 0; k < 8; ++k)
+				{
+					crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+				}
+			}
+			return ~crc;
+		};
+
+		auto const data = sys::bench::utf8(3 * 8192 + 3 * 256 + 100, 5);
+		for (std::size_t size : { 1, 7, 8, 9, 100, 3 * 256, 3 * 256 + 13, 3 * 8192, 3 * 8192 + 3 * 256 + 97 })
+		{
+			for (std::size_t offset : { 0, 3 })
+			{
+				fmt::string::view const u(data.data() + offset, size);
+				auto const crc = bits(u);
+				assert(crc == fmt::crc32c(u));
+				assert(crc == ~software(~0u, u.data(), u.size()));
+				// Continued from a checksum of the front
+				auto const half = size / 2;
+				assert(crc == fmt::crc32c(u.substr(half), fmt::crc32c(u.substr(0, half))));
+			}
+		}
+	}
+}
+
+#endif
+#ifdef bench_unit
+
+bench_unit(hash)
+{
+	// Throughput over inputs from one byte to one megabyte
+	auto const data = sys::bench::ascii(1 << 20, 9);
+	for (std::size_t size = 1; size <= data.size(); size *= 4)
+	{
+		fmt::string::view const u(data.data(), size);
+		bench(sys::bench::label("hash", size), size, [&](std::size_t n)
+		{
+			auto const seed = fmt::seed();
+			while (n--) sys::bench::keep(fmt::hash(u, seed));
+		});
+
+		bench(sys::bench::label("std", size), size, [&](std::size_t n)
+		{
+			std::hash<std::string_view> const h;
+			while (n--) sys::bench::keep(h(u));
+		});
+
+		bench(sys::bench::label("crc32c", size), size, [&](std::size_t n)
+		{
+			while (n--) sys::bench::keep(fmt::crc32c(u));
+		});
+
+		bench(sys::bench::label("crc32c/table", size), size, [&](std::size_t n)
+		{
+			while (n--) sys::bench::keep(software(~0u, u.data(), u.size()));
+		});
+	}
+
+	// Pairs of integers as in a diff
+	{
+		sys::bench::random next(4);
+		fwd::vector<fmt::diff::pair> pairs;
+		for (int i = 0; i < 4096; ++i)
+		{
+			pairs.emplace_back(static_cast<std::ptrdiff_t>(next(1 << 16)), static_cast<std::ptrdiff_t>(next(1 << 16)));
+		}
+
+		bench("pair/hash", 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(fmt::hash(pairs[i & 4095]));
+		});
+
+		bench("pair/std", 0, [&](std::size_t n)
+		{
+			std::hash<std::ptrdiff_t> const h;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				auto const& p = pairs[i & 4095];
+				sys::bench::keep(h(p.first) ^ (h(p.second) << 1));
+			}
+		});
+	}
+}
+
+#endif
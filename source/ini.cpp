@@ -16,6 +16,14 @@ namespace
 	}
 
 	constexpr auto separator = ";";
+
+	fmt::string::view clean(fmt::string::view line)
+	// Line without comment and whitespace, empty when nothing is left
+	{
+		constexpr char omit = '#';
+		auto const t = line.find(omit);
+		return fmt::trim(line.substr(0, t));
+	}
 }
 
 namespace doc
@@ -25,7 +33,7 @@ namespace doc
 		return fmt::join(list, separator);
 	}
 
-	ini::vector ini::split(view line)
+	ini::small ini::split(view line)
 	{
 		return fmt::split(line, separator);
 	}
@@ -39,33 +47,36 @@ namespace doc
 	{
 		while (std::getline(input, output))
 		{
-			// Read past comment
-			constexpr char omit = '#';
-			auto const begin = output.begin();
-			auto const end = output.end();
-			auto const it = fmt::skip(begin, end);
-			if (it != end and omit != *it)
+			view const u = clean(output);
+			if (not u.empty())
 			{
-				// Trim off whitespace
-				auto const t = output.find(omit);
-				output = output.substr(0, t);
-				view const u = fmt::trim(output);
-				if (not u.empty())
-				{
-					output = fmt::to_string(u);
-					break; // done
-				}
+				output = fmt::to_string(u);
+				break; // done
 			}
 		}
 		return input;
 	}
 
+	bool ini::getline(fmt::lines& input, view& output)
+	{
+		while (input.next(output))
+		{
+			output = clean(output);
+			if (not output.empty())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	ini::in::ref operator>>(ini::in::ref input, ini::ref output)
 	{
 		path::type group = 0;
-		ini::string token;
+		fmt::lines lines(input);
+		ini::view token;
 
-		while (ini::getline(input, token))
+		while (ini::getline(lines, token))
 		{
 			// Check for new group
 			if (header(token))
@@ -210,4 +221,63 @@ test_unit(ini)
 		}
 	}
 }
-#endif
\ No newline at end of file
+#endif
+
+#ifdef bench_unit
+
+bench_unit(ini)
+{
+	// Files from a handful of entries up to several megabytes
+	struct data
+	{
+		fmt::string::view label;
+		size_t groups, keys;
+		bool noisy;
+	}
+	const input[] =
+	{
+		{ "small", 4, 8, false },
+		{ "large", 1 << 10, 1 << 7, false },
+		{ "noisy", 1 << 10, 1 << 7, true },
+	};
+
+	for (auto const& in : input)
+	{
+		// Keys repeat across groups as they would in real files
+		auto const words = sys::bench::words(in.keys, 3);
+		auto const values = sys::bench::words(in.keys, 5);
+		sys::bench::random next(in.groups);
+		fmt::string::stream ss;
+		for (size_t group = 0; group < in.groups; ++group)
+		{
+			ss << "[Group" << group << ']' << fmt::eol;
+			for (auto const& key : words)
+			{
+				if (in.noisy)
+				{
+					// Comments and padding the parser has to skip
+					ss << "\t# " << values[next(in.keys)] << fmt::eol;
+					ss << "   " << key << '=' << values[next(in.keys)] << " # note \t" << fmt::eol;
+				}
+				else
+				{
+					ss << key << '=' << values[next(in.keys)] << fmt::eol;
+				}
+			}
+		}
+
+		auto const text = ss.str();
+		bench(in.label, text.size(), [&text](size_t n)
+		{
+			while (n--)
+			{
+				doc::ini init;
+				fmt::string::stream file { text };
+				while (file >> init);
+				sys::bench::keep(init);
+			}
+		});
+	}
+}
+
+#endif
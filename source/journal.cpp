@@ -0,0 +1,572 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "journal.hpp"
+#include "hash.hpp"
+#include "dig.hpp"
+#include "dir.hpp"
+#include "sys.hpp"
+#include "err.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+#endif
+
+namespace
+{
+	using env::file::size_t;
+	using view = fmt::string::view;
+
+	constexpr size_t header = 8;     // length and checksum, little endian
+	constexpr size_t digits = 16;    // of the number in each file name
+	constexpr view suffix = ".log";
+
+	void put(char* p, std::uint32_t n)
+	{
+		for (size_t k = 0; k < 4; ++k)
+		{
+			p[k] = static_cast<char>(n >> (8 * k));
+		}
+	}
+
+	std::uint32_t get(char const* p)
+	{
+		return static_cast<std::uint32_t>(fmt::impl::read<4>(p));
+	}
+
+	std::uint32_t checksum(char const* head, view data)
+	// Covers the length too, so that zeros set aside for later are never a record
+	{
+		return fmt::crc32c(data, fmt::crc32c(view(head, 4)));
+	}
+
+	bool mapped(void const* p)
+	{
+		#ifdef MAP_FAILED
+		return nullptr != p and MAP_FAILED != p;
+		#else
+		return nullptr != p;
+		#endif
+	}
+
+	struct trail
+	{
+		size_t end = 0;       // after the last whole record
+		bool damaged = false; // stopped by something other than zeros
+		bool stopped = false; // the block asked to stop
+	};
+
+	trail walk(char const* p, size_t n, env::file::block const* visit)
+	// Records from the front until the data or the space set aside begins
+	{
+		trail t;
+		while (t.end < n)
+		{
+			auto const left = n - t.end;
+			auto const at = p + t.end;
+			if (left < header)
+			{
+				t.damaged = std::any_of(at, at + left, [](char c) { return '\0' != c; });
+				break;
+			}
+
+			auto const size = get(at), sum = get(at + 4);
+			if (0 == size and 0 == sum)
+			{
+				break;
+			}
+			if (left - header < size or sum != checksum(at, view(at + header, size)))
+			{
+				t.damaged = true;
+				break;
+			}
+
+			auto const from = t.end;
+			t.end += header + size;
+			if (visit and (*visit)(from, view(at + header, size)))
+			{
+				t.stopped = true;
+				break;
+			}
+		}
+		return t;
+	}
+
+	bool reserve(int fd, size_t size)
+	// Blocks for the whole file up front, so that appending never changes its size
+	{
+		auto const off = static_cast<sys::off_t>(size);
+		#ifdef __linux__
+		if (0 == ::fallocate(fd, 0, 0, off))
+		{
+			return success;
+		}
+		// Some file systems cannot, and only the size is set
+		#endif
+		if (env::file::fail(sys::ftruncate(fd, off)))
+		{
+			sys::err(here, "ftruncate", fd, size);
+			return failure;
+		}
+		return success;
+	}
+}
+
+namespace env::file
+{
+	segment::segment(fmt::string::view path)
+	{
+		descriptor const in(path, rd);
+		if (not fail(in.get()))
+		{
+			auto const size = in.size();
+			if (0 < size)
+			{
+				map = make_map(in.get(), size, 0, rd);
+				length = mapped(map.get()) ? size : 0;
+			}
+		}
+	}
+
+	bool segment::each(block const& visit) const
+	{
+		auto const p = static_cast<char const*>(map.get());
+		return walk(p, length, &visit).damaged ? failure : success;
+	}
+
+	journal::journal(fmt::string::view path) : journal(path, options { })
+	{ }
+
+	journal::journal(fmt::string::view path, options o) : dir(path), opt(o)
+	{
+		if (recover())
+		{
+			sys::err(here, "recover", dir);
+		}
+	}
+
+	fmt::string journal::path(size_t n) const
+	{
+		auto name = fmt::to_string(static_cast<unsigned long long>(n), 10);
+		name.insert(0, digits - std::min(digits, name.size()), '0');
+		name += suffix;
+		return fmt::dir::join({ dir, name });
+	}
+
+	fwd::vector<fmt::string> journal::paths() const
+	{
+		fwd::vector<fmt::string> t;
+		for (auto const n : sealed)
+		{
+			t.push_back(path(n));
+		}
+		if (0 < number)
+		{
+			t.push_back(path(number));
+		}
+		return t;
+	}
+
+	bool journal::recover()
+	{
+		if (make_dir(dir).empty())
+		{
+			return failure;
+		}
+
+		(void) find(dir, [this](fmt::string::view u)
+		{
+			auto const name = fmt::dir::split(u).back();
+			auto const number = name.substr(0, digits);
+			if (digits + suffix.size() == name.size() and name.ends_with(suffix)
+				and std::all_of(number.begin(), number.end(), [](char c) { return '0' <= c and c <= '9'; }))
+			{
+				sealed.push_back(static_cast<size_t>(fmt::to_ullong(number)));
+			}
+			return success;
+		});
+		std::sort(sealed.begin(), sealed.end());
+
+		if (sealed.empty())
+		{
+			return roll(0);
+		}
+		number = sealed.back();
+		sealed.pop_back();
+
+		auto const name = path(number);
+		if (active.open(name, rw))
+		{
+			return failure;
+		}
+
+		// The last file ends at its first record which is not whole
+		auto const size = active.size();
+		if (0 < size)
+		{
+			auto const map = make_map(active.get(), size, 0, rd);
+			if (not mapped(map.get()))
+			{
+				return failure;
+			}
+			auto const t = walk(static_cast<char const*>(map.get()), size, nullptr);
+			if (t.damaged)
+			{
+				sys::warn(here, "torn", name, t.end);
+			}
+			end = t.end;
+		}
+
+		// Cut whatever follows, so that a later tear cannot join old bytes to new records
+		if (fail(sys::ftruncate(active.get(), static_cast<sys::off_t>(end))))
+		{
+			sys::err(here, "ftruncate", name, end);
+			return failure;
+		}
+		room = std::max(opt.segment, end);
+		return reserve(active.get(), room);
+	}
+
+	bool journal::roll(size_t need)
+	{
+		if (not fail(active.get()))
+		{
+			// Readers map the sealed file whole, so the space set aside is given back
+			if (fail(sys::ftruncate(active.get(), static_cast<sys::off_t>(end))))
+			{
+				sys::err(here, "ftruncate", path(number), end);
+				return failure;
+			}
+			if (opt.sync and flush())
+			{
+				return failure;
+			}
+			(void) active.close();
+			sealed.push_back(number);
+		}
+
+		++number;
+		end = 0;
+		room = std::max(opt.segment, need);
+		if (active.open(path(number), ov) or reserve(active.get(), room))
+		{
+			return failure;
+		}
+
+		#ifndef _WIN32
+		if (opt.sync)
+		{
+			// The name of the new file must last as well as its contents
+			descriptor const folder(dir, rd);
+			if (fail(sys::fsync(folder.get())))
+			{
+				sys::warn(here, "fsync", dir);
+			}
+		}
+		#endif
+		return success;
+	}
+
+	bool journal::gather(fwd::span<fwd::span<char const>> parts)
+	// Write the buffers at the end, going on after a short write
+	{
+		while (not parts.empty())
+		{
+			auto const n = active.pwritev(parts, end);
+			if (n <= 0)
+			{
+				return failure;
+			}
+			auto left = static_cast<size_t>(n);
+			end += left;
+			while (not parts.empty() and parts.front().size() <= left)
+			{
+				left -= parts.front().size();
+				parts = parts.subspan(1);
+			}
+			if (0 < left)
+			{
+				parts.front() = parts.front().subspan(left);
+			}
+		}
+		return success;
+	}
+
+	bool journal::append(fmt::string::view record)
+	{
+		fmt::string::view u = record;
+		return append(fmt::string::view::span(&u, 1));
+	}
+
+	bool journal::append(fmt::string::view::span records)
+	{
+		size_t need = 0;
+		for (auto const& u : records)
+		{
+			if (std::numeric_limits<std::uint32_t>::max() < u.size())
+			{
+				sys::err(here, "record", u.size());
+				return failure;
+			}
+			need += header + u.size();
+		}
+		if (room < end + need and roll(need))
+		{
+			return failure;
+		}
+
+		// Each record is a header and its data, in batches well inside the limit on buffers
+		constexpr size_t most = 512;
+		fwd::vector<std::array<char, header>> heads(std::min(most, records.size()));
+		fwd::vector<fwd::span<char const>> parts;
+		for (size_t i = 0; i < records.size(); i += most)
+		{
+			parts.clear();
+			auto const count = std::min(most, records.size() - i);
+			for (size_t k = 0; k < count; ++k)
+			{
+				auto const& u = records[i + k];
+				auto const head = heads[k].data();
+				put(head, static_cast<std::uint32_t>(u.size()));
+				put(head + 4, checksum(head, u));
+				parts.emplace_back(head, header);
+				if (not u.empty())
+				{
+					parts.emplace_back(u.data(), u.size());
+				}
+			}
+			if (gather(parts))
+			{
+				return failure;
+			}
+		}
+		if (opt.sync)
+		{
+			return flush();
+		}
+		return success;
+	}
+
+	bool journal::flush() const
+	{
+		#ifdef __linux__
+		auto const no = ::fdatasync(active.get());
+		#else
+		auto const no = sys::fsync(active.get());
+		#endif
+		if (fail(no))
+		{
+			sys::err(here, "sync", dir);
+			return failure;
+		}
+		return success;
+	}
+
+	bool journal::replay(block const& visit) const
+	{
+		bool stopped = false;
+		block const check = [&](size_t at, fmt::string::view u)
+		{
+			return stopped = visit(at, u);
+		};
+
+		for (auto const n : sealed)
+		{
+			segment const part(path(n));
+			if (part.each(check))
+			{
+				return failure;
+			}
+			if (stopped)
+			{
+				return success;
+			}
+		}
+
+		// Only as far as has been written, the rest being set aside
+		if (0 < end)
+		{
+			auto const map = make_map(active.get(), end, 0, rd);
+			if (not mapped(map.get()))
+			{
+				return failure;
+			}
+			if (walk(static_cast<char const*>(map.get()), end, &check).damaged)
+			{
+				return failure;
+			}
+		}
+		return success;
+	}
+}
+
+#ifdef test_unit
+
+test_unit(journal)
+{
+	auto const dir = fmt::dir::join({ env::temp(), "oasys.journal" });
+	(void) env::file::remove_dir(dir);
+
+	auto const records = sys::bench::words(1000, 8);
+	auto const collect = [](env::file::journal const& log)
+	{
+		fmt::string::vector t;
+		assert(not log.replay([&](auto, fmt::string::view u)
+		{
+			t.emplace_back(u);
+			return success;
+		}));
+		return t;
+	};
+
+	// Records come back in order across files, one at a time and in batches
+	{
+		env::file::journal log(dir, { 1 << 10 });
+		for (std::size_t i = 0; i < 100; ++i)
+		{
+			assert(not log.append(records[i]));
+		}
+		fmt::string::view::vector batch(records.begin() + 100, records.end());
+		assert(not log.append(batch));
+		assert(not log.flush());
+		assert(2 < log.paths().size());
+		assert(collect(log) == records);
+
+		// Sealed files hold nothing but records
+		env::file::segment const first(log.paths().front());
+		std::size_t count = 0, offset = 0;
+		assert(not first.each([&](auto at, fmt::string::view u)
+		{
+			assert(at == offset and u == records[count]);
+			offset += 8 + u.size();
+			++count;
+			return success;
+		}));
+		assert(0 < count and offset == first.size());
+	}
+
+	// Opened again, nothing is lost and appending goes on from the end
+	{
+		env::file::journal log(dir, { 1 << 10 });
+		assert(collect(log) == records);
+		assert(not log.append("after"));
+		auto const t = collect(log);
+		assert(t.size() == records.size() + 1 and "after" == t.back());
+	}
+
+	// A torn record at the end is cut away, and the ones before it kept
+	{
+		fmt::string name;
+		{
+			env::file::journal log(dir, { 1 << 10 });
+			assert(not log.append("whole"));
+			name = log.paths().back();
+		}
+		{
+			env::file::descriptor file(name, env::file::rw);
+			auto const size = file.size();
+			fwd::vector<char> bytes(size);
+			assert(static_cast<env::file::ssize_t>(size) == file.pread(bytes.data(), size, 0));
+			// Find the zeros after the last record and write half of a new one there
+			env::file::size_t end = 0;
+			while (end + 8 <= size and (bytes[end] or bytes[end + 4]))
+			{
+				end += 8 + static_cast<unsigned char>(bytes[end]);
+			}
+			char const torn[] { 40, 0, 0, 0, 1, 2, 3, 4, 't', 'o', 'r', 'n' };
+			assert(sizeof torn == file.pwrite(torn, sizeof torn, end));
+		}
+		env::file::journal log(dir, { 1 << 10 });
+		auto const t = collect(log);
+		assert(t.size() == records.size() + 2 and "whole" == t.back());
+		assert(not log.append("next"));
+		assert("next" == collect(log).back());
+	}
+
+	// Damage inside a sealed file is reported
+	{
+		env::file::journal log(dir, { 1 << 10 });
+		auto const name = log.paths().front();
+		{
+			env::file::descriptor file(name, env::file::rw);
+			char c = 0;
+			assert(1 == file.pread(&c, 1, 10));
+			c ^= 1;
+			assert(1 == file.pwrite(&c, 1, 10));
+		}
+		assert(log.replay([](auto, auto) { return success; }));
+	}
+
+	assert(not env::file::remove_dir(dir));
+}
+
+#endif
+#ifdef bench_unit
+
+bench_unit(journal)
+{
+	auto const dir = fmt::dir::join({ env::temp(), "oasys.journal.bench" });
+	auto const text = sys::bench::ascii(1 << 20, 13);
+
+	for (std::size_t size : { 64, 1024 })
+	{
+		fwd::vector<fmt::string::view> records;
+		for (std::size_t at = 0; at + size <= text.size(); at += size)
+		{
+			records.emplace_back(text.data() + at, size);
+		}
+
+		(void) env::file::remove_dir(dir);
+		{
+			env::file::journal log(dir);
+			bench(sys::bench::label("append", size), size, [&](std::size_t n)
+			{
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					(void) log.append(records[i % records.size()]);
+				}
+			});
+
+			bench(sys::bench::label("batch", size), size, [&](std::size_t n)
+			{
+				for (std::size_t i = 0; i < n; i += 64)
+				{
+					auto const at = i % (records.size() - 64);
+					fmt::string::view::span part(records.data() + at, std::min<std::size_t>(64, n - i));
+					(void) log.append(part);
+				}
+			});
+		}
+
+		// Everything written above read back through the maps
+		{
+			env::file::journal log(dir);
+			std::size_t bytes = 0, count = 0;
+			(void) log.replay([&](auto, fmt::string::view u)
+			{
+				bytes += u.size();
+				++count;
+				return success;
+			});
+
+			bench(sys::bench::label("replay", size), 0 < count ? bytes / count : 0, [&](std::size_t n)
+			{
+				while (n)
+				{
+					(void) log.replay([&](auto, fmt::string::view u)
+					{
+						sys::bench::keep(u.data());
+						return 0 == --n;
+					});
+				}
+			});
+		}
+	}
+	(void) env::file::remove_dir(dir);
+}
+
+#endif
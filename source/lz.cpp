@@ -0,0 +1,826 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "lz.hpp"
+#include "hash.hpp"
+#include "sync.hpp"
+#include "err.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	using std::size_t;
+	using view = fmt::string::view;
+
+	constexpr size_t least = 4;      // shortest match
+	constexpr size_t tail = 5;       // bytes at the end which are always literal
+	constexpr size_t margin = 12;    // no match starts nearer the end than this
+	constexpr size_t window = 65535; // farthest a match may look back
+	constexpr int bits = 12;         // of the positions in the table of matches
+
+	constexpr view magic = "oLZ1";
+	constexpr size_t header = 12;    // plain size, packed size and checksum
+	constexpr std::uint32_t stored = 1u << 31; // block kept as it was
+	constexpr size_t largest = 1 << 26;        // accepted from a frame
+
+	std::uint32_t load32(char const* p)
+	{
+		std::uint32_t word;
+		std::memcpy(&word, p, sizeof word);
+		return word;
+	}
+
+	std::uint64_t load64(char const* p)
+	{
+		std::uint64_t word;
+		std::memcpy(&word, p, sizeof word);
+		return word;
+	}
+
+	std::uint32_t slot(std::uint32_t word)
+	{
+		return (word * 2654435761u) >> (32 - bits);
+	}
+
+	size_t common(char const* a, char const* b, char const* end)
+	// Length of the run which is the same at both
+	{
+		auto const start = a;
+		for (; a + 8 <= end; a += 8, b += 8)
+		{
+			auto const diff = load64(a) ^ load64(b);
+			if (0 != diff)
+			{
+				auto const same = std::endian::little == std::endian::native ? std::countr_zero(diff) : std::countl_zero(diff);
+				return static_cast<size_t>(a - start) + static_cast<size_t>(same / 8);
+			}
+		}
+		for (; a < end and *a == *b; ++a, ++b);
+		return static_cast<size_t>(a - start);
+	}
+
+	char* length(char* op, size_t n)
+	// Rest of a length which did not fit in its four bits
+	{
+		for (; 255 <= n; n -= 255)
+		{
+			*op++ = static_cast<char>(255);
+		}
+		*op++ = static_cast<char>(n);
+		return op;
+	}
+
+	char* literals(char* op, char const* p, size_t n, size_t match)
+	// Token, literals and, unless this is the last, the length of the match which follows
+	{
+		auto const token = op++;
+		auto const rest = match - least;
+		*token = static_cast<char>(std::min<size_t>(n, 15) << 4 | (match ? std::min<size_t>(rest, 15) : 0));
+		if (15 <= n)
+		{
+			op = length(op, n - 15);
+		}
+		std::memcpy(op, p, n);
+		return op + n;
+	}
+
+	bool extend(unsigned char const*& ip, unsigned char const* end, size_t& n)
+	{
+		unsigned byte;
+		do
+		{
+			if (ip == end)
+			{
+				return failure;
+			}
+			byte = *ip++;
+			n += byte;
+		}
+		while (255 == byte);
+		return success;
+	}
+
+	void write32(char* p, std::uint32_t n)
+	// Little endian, as are all numbers in a frame
+	{
+		for (size_t k = 0; k < 4; ++k)
+		{
+			p[k] = static_cast<char>(n >> (8 * k));
+		}
+	}
+
+	std::uint32_t read32(char const* p)
+	{
+		return static_cast<std::uint32_t>(fmt::impl::read<4>(p));
+	}
+
+	void opening(fmt::string& out, size_t block)
+	{
+		char size[4];
+		write32(size, static_cast<std::uint32_t>(block));
+		out.append(magic);
+		out.append(size, 4);
+	}
+
+	void frame(view plain, fmt::string& out)
+	// One block with its header, kept as it was when it does not shrink
+	{
+		auto const at = out.size();
+		out.resize(at + header + fmt::lz::bound(plain.size()));
+		auto const head = out.data() + at;
+		auto n = fmt::lz::compress(plain, head + header);
+		std::uint32_t flag = 0;
+		if (plain.size() <= n)
+		{
+			std::memcpy(head + header, plain.data(), plain.size());
+			n = plain.size();
+			flag = stored;
+		}
+		write32(head, static_cast<std::uint32_t>(plain.size()));
+		write32(head + 4, static_cast<std::uint32_t>(n) | flag);
+		write32(head + 8, fmt::crc32c(view(head + header, n)));
+		out.resize(at + header + n);
+	}
+
+	void ending(fmt::string& out)
+	{
+		char const end[header] { };
+		out.append(end, header);
+	}
+
+	bool check(view head, size_t& block)
+	{
+		if (head.substr(0, 4) != magic)
+		{
+			sys::warn(here, "magic");
+			return failure;
+		}
+		block = read32(head.data() + 4);
+		if (0 == block or largest < block)
+		{
+			sys::warn(here, "block", block);
+			return failure;
+		}
+		return success;
+	}
+
+	bool decode(char const* head, view data, char* out)
+	// Checked then unpacked into the size in its header
+	{
+		auto const plain = read32(head), packed = read32(head + 4);
+		if (read32(head + 8) != fmt::crc32c(data))
+		{
+			sys::warn(here, "checksum");
+			return failure;
+		}
+		if (packed & stored)
+		{
+			if (plain != data.size())
+			{
+				return failure;
+			}
+			std::memcpy(out, data.data(), plain);
+			return success;
+		}
+		return fmt::lz::decompress(data, out, plain);
+	}
+
+}
+
+namespace fmt::lz
+{
+	std::size_t bound(std::size_t n)
+	{
+		return n + n / 255 + 16;
+	}
+
+	std::size_t compress(string::view in, char* out)
+	{
+		auto const src = in.data();
+		auto const n = in.size();
+		auto op = out;
+		size_t anchor = 0;
+
+		if (margin < n)
+		{
+			std::uint32_t table[1 << bits] { };
+			auto const limit = n - margin;
+			auto const stop = src + n - tail;
+
+			size_t ip = 1;
+			for (bool more = true; more; )
+			{
+				// Longer strides the longer nothing is found
+				size_t ref = 0;
+				for (size_t misses = 1 << 6;; ip += misses++ >> 6)
+				{
+					if (limit < ip)
+					{
+						more = false;
+						break;
+					}
+					auto const word = load32(src + ip);
+					auto& entry = table[slot(word)];
+					ref = entry;
+					entry = static_cast<std::uint32_t>(ip);
+					if (ref < ip and ip - ref <= window and load32(src + ref) == word)
+					{
+						break;
+					}
+				}
+				if (not more)
+				{
+					break;
+				}
+
+				// Further back into the literals, then forward as far as it goes
+				for (; anchor < ip and 0 < ref and src[ip - 1] == src[ref - 1]; --ip, --ref);
+				auto const match = least + common(src + ip + least, src + ref + least, stop);
+				auto const offset = ip - ref;
+
+				op = literals(op, src + anchor, ip - anchor, match);
+				*op++ = static_cast<char>(offset);
+				*op++ = static_cast<char>(offset >> 8);
+				if (15 <= match - least)
+				{
+					op = length(op, match - least - 15);
+				}
+
+				ip += match;
+				anchor = ip;
+				if (limit < ip)
+				{
+					break;
+				}
+				table[slot(load32(src + ip - 2))] = static_cast<std::uint32_t>(ip - 2);
+			}
+		}
+
+		op = literals(op, src + anchor, n - anchor, 0);
+		return static_cast<std::size_t>(op - out);
+	}
+
+	bool decompress(string::view in, char* out, std::size_t size)
+	{
+		auto ip = reinterpret_cast<unsigned char const*>(in.data());
+		auto const end = ip + in.size();
+		auto op = out;
+		auto const last = out + size;
+
+		for (;;)
+		{
+			if (ip == end)
+			{
+				return failure;
+			}
+			unsigned const token = *ip++;
+
+			size_t n = token >> 4;
+			if (15 == n and extend(ip, end, n))
+			{
+				return failure;
+			}
+			auto const in_left = static_cast<size_t>(end - ip);
+			auto const out_left = static_cast<size_t>(last - op);
+			if (in_left < n or out_left < n)
+			{
+				return failure;
+			}
+			// Short runs as one wide copy, when both buffers have room past them
+			if (n <= 16 and 16 <= in_left and 16 <= out_left)
+			{
+				std::memcpy(op, ip, 16);
+			}
+			else std::memcpy(op, ip, n);
+			ip += n;
+			op += n;
+
+			if (ip == end)
+			{
+				return op == last ? success : failure;
+			}
+			if (end - ip < 2)
+			{
+				return failure;
+			}
+			size_t const offset = ip[0] | ip[1] << 8;
+			ip += 2;
+			if (0 == offset or static_cast<size_t>(op - out) < offset)
+			{
+				return failure;
+			}
+
+			size_t match = token & 15;
+			if (15 == match and extend(ip, end, match))
+			{
+				return failure;
+			}
+			match += least;
+			if (static_cast<size_t>(last - op) < match)
+			{
+				return failure;
+			}
+
+			// Overlapping runs repeat what was just written, so they are copied in steps no longer than the offset
+			auto from = op - offset;
+			if (match <= 16 and 16 <= offset and 16 <= static_cast<size_t>(last - op))
+			{
+				std::memcpy(op, from, 16);
+			}
+			else
+			if (match <= offset)
+			{
+				std::memcpy(op, from, match);
+			}
+			else
+			if (8 <= offset)
+			{
+				for (size_t k = 0; k < match; k += 8)
+				{
+					std::memcpy(op + k, from + k, std::min<size_t>(8, match - k));
+				}
+			}
+			else
+			{
+				for (size_t k = 0; k < match; ++k)
+				{
+					op[k] = from[k];
+				}
+			}
+			op += match;
+		}
+	}
+
+	bool pack(string::view in, string& out, std::size_t block, std::size_t threads)
+	{
+		if (0 == block or largest < block)
+		{
+			sys::warn(here, "block", block);
+			return failure;
+		}
+		auto const blocks = (in.size() + block - 1) / block;
+		fwd::vector<string> parts(blocks);
+		sys::share(threads, blocks, [&](size_t i)
+		{
+			frame(in.substr(i * block, block), parts[i]);
+		});
+
+		out.clear();
+		opening(out, block);
+		for (auto const& part : parts)
+		{
+			out += part;
+		}
+		ending(out);
+		return success;
+	}
+
+	bool unpack(string::view in, string& out, std::size_t threads)
+	{
+		size_t block;
+		if (in.size() < 8 or check(in, block))
+		{
+			return failure;
+		}
+
+		// Headers first, so that each block knows where it goes
+		struct part
+		{
+			char const* head;
+			size_t at;
+		};
+		fwd::vector<part> parts;
+		size_t total = 0;
+		for (auto pos = size_t(8);; )
+		{
+			if (in.size() - pos < header)
+			{
+				sys::warn(here, "truncated");
+				return failure;
+			}
+			auto const head = in.data() + pos;
+			auto const plain = read32(head), packed = read32(head + 4) & ~stored;
+			if (0 == plain)
+			{
+				break;
+			}
+			if (block < plain or bound(block) < packed or in.size() - pos - header < packed)
+			{
+				sys::warn(here, "block", plain, packed);
+				return failure;
+			}
+			parts.push_back({ head, total });
+			total += plain;
+			pos += header + packed;
+		}
+
+		out.resize(total);
+		std::atomic<bool> bad = false;
+		sys::share(threads, parts.size(), [&](size_t i)
+		{
+			auto const head = parts[i].head;
+			view const data(head + header, read32(head + 4) & ~stored);
+			if (decode(head, data, out.data() + parts[i].at))
+			{
+				bad = true;
+			}
+		});
+		return bad ? failure : success;
+	}
+}
+
+namespace env::file
+{
+	namespace
+	{
+		bool exact(reader const& from, char* buf, size_t sz, size_t& got)
+		// Until full, since pipes give what they have
+		{
+			for (got = 0; got < sz; )
+			{
+				auto const n = from.read(buf + got, sz - got);
+				if (n < 0)
+				{
+					return failure;
+				}
+				if (0 == n)
+				{
+					break;
+				}
+				got += static_cast<size_t>(n);
+			}
+			return success;
+		}
+
+		bool whole(writer const& to, char const* buf, size_t sz)
+		{
+			for (size_t put = 0; put < sz; )
+			{
+				auto const n = to.write(buf + put, sz - put);
+				if (n <= 0)
+				{
+					return failure;
+				}
+				put += static_cast<size_t>(n);
+			}
+			return success;
+		}
+	}
+
+	packer::~packer()
+	{
+		if ((am & wr) and finish())
+		{
+			sys::warn(here, "finish");
+		}
+	}
+
+	bool packer::emit() const
+	{
+		output.clear();
+		if (not started)
+		{
+			opening(output, block);
+			started = true;
+		}
+		if (not source.empty())
+		{
+			frame(source, output);
+			source.clear();
+		}
+		return whole(file, output.data(), output.size());
+	}
+
+	ssize_t packer::write(const void *buf, size_t sz) const
+	{
+		assert(not finished);
+		auto p = static_cast<char const*>(buf);
+		for (auto left = sz; 0 < left; )
+		{
+			auto const n = std::min(left, block - source.size());
+			source.append(p, n);
+			p += n;
+			left -= n;
+			if (block == source.size() and emit())
+			{
+				return invalid;
+			}
+		}
+		return static_cast<ssize_t>(sz);
+	}
+
+	bool packer::finish() const
+	{
+		if (finished)
+		{
+			return success;
+		}
+		finished = true;
+		if (emit())
+		{
+			return failure;
+		}
+		output.clear();
+		ending(output);
+		return whole(file, output.data(), output.size());
+	}
+
+	bool packer::next() const
+	{
+		size_t got;
+		if (not opened)
+		{
+			char head[8];
+			if (exact(file, head, sizeof head, got) or got < sizeof head or check(view(head, got), limit))
+			{
+				return failure;
+			}
+			plain.reserve(limit);
+			opened = true;
+		}
+
+		char head[header];
+		if (exact(file, head, header, got) or got < header)
+		{
+			sys::warn(here, "truncated");
+			return failure;
+		}
+		auto const size = read32(head), packed = read32(head + 4) & ~stored;
+		if (0 == size)
+		{
+			ended = true;
+			return success;
+		}
+		if (limit < size or fmt::lz::bound(limit) < packed)
+		{
+			sys::warn(here, "block", size, packed);
+			return failure;
+		}
+
+		input.resize(packed);
+		if (exact(file, input.data(), packed, got) or got < packed)
+		{
+			sys::warn(here, "truncated");
+			return failure;
+		}
+		plain.resize(size);
+		at = 0;
+		return decode(head, input, plain.data());
+	}
+
+	ssize_t packer::read(void *buf, size_t sz) const
+	{
+		if (at == plain.size())
+		{
+			if (ended)
+			{
+				return 0;
+			}
+			if (next())
+			{
+				plain.clear();
+				at = 0;
+				return invalid;
+			}
+			if (ended)
+			{
+				return 0;
+			}
+		}
+		auto const n = std::min(sz, plain.size() - at);
+		std::memcpy(buf, plain.data() + at, n);
+		at += n;
+		return static_cast<ssize_t>(n);
+	}
+}
+
+#ifdef bench_unit
+
+namespace
+{
+	fmt::string binary(size_t bytes, unsigned long long seed)
+	// Fixed records of a counter, a small code and a measure, as a program would dump them
+	{
+		sys::bench::random next(seed);
+		fmt::string s;
+		std::uint32_t id = 0;
+		double measure = 0;
+		while (s.size() < bytes)
+		{
+			++id;
+			measure += static_cast<double>(next(1000)) / 100;
+			auto const code = static_cast<std::uint16_t>(next(16));
+			s.append(reinterpret_cast<char const*>(&id), sizeof id);
+			s.append(reinterpret_cast<char const*>(&code), sizeof code);
+			s.append(reinterpret_cast<char const*>(&measure), sizeof measure);
+		}
+		s.resize(bytes);
+		return s;
+	}
+
+	fmt::string prose(size_t bytes, unsigned long long seed)
+	// Words from a vocabulary with the common ones far more likely, as in written text
+	{
+		auto const words = sys::bench::words(4096, seed);
+		sys::bench::random next(seed);
+		fmt::string s;
+		while (s.size() < bytes)
+		{
+			s += words[next(1 + next(words.size()))];
+			s += 0 == next(12) ? '\n' : ' ';
+		}
+		s.resize(bytes);
+		return s;
+	}
+
+	fmt::string noise(size_t bytes, unsigned long long seed)
+	{
+		sys::bench::random next(seed);
+		fmt::string s(bytes, '\0');
+		for (auto& c : s)
+		{
+			c = static_cast<char>(next());
+		}
+		return s;
+	}
+}
+
+#endif
+#ifdef test_unit
+#include "dir.hpp"
+#include "env.hpp"
+#include "pipe.hpp"
+#include "sys.hpp"
+#include <iterator>
+
+namespace
+{
+	bool trip(view plain)
+	{
+		fmt::string packed(fmt::lz::bound(plain.size()), '\0');
+		packed.resize(fmt::lz::compress(plain, packed.data()));
+		fmt::string back(plain.size(), '\0');
+		if (fmt::lz::decompress(packed, back.data(), back.size()) or back != plain)
+		{
+			return failure;
+		}
+		// Any other size is refused
+		fmt::string other(plain.size() + 1, '\0');
+		return not fmt::lz::decompress(packed, other.data(), plain.size() + 1)
+			or (0 < plain.size() and not fmt::lz::decompress(packed, other.data(), plain.size() - 1));
+	}
+}
+
+test_unit(lz)
+{
+	// Every kind of input at sizes near the limits of the format
+	{
+		auto const corpora =
+		{
+			sys::bench::ascii(1 << 18, 1), sys::bench::utf8(1 << 18, 2), sys::bench::worst(1 << 18, "ab"),
+			prose(1 << 18, 3), binary(1 << 18, 4), noise(1 << 18, 5),
+		};
+		for (auto const& data : corpora)
+		{
+			for (size_t size : { 0, 1, 4, 12, 13, 14, 15, 16, 17, 31, 100, 1000, 70000, 1 << 18 })
+			{
+				assert(not trip(view(data).substr(0, size)));
+			}
+		}
+	}
+	// Matches which overlap themselves at every short distance, and lengths past 255
+	{
+		fmt::string s;
+		for (size_t k = 1; k < 20; ++k)
+		{
+			auto const unit = sys::bench::ascii(k, k);
+			for (size_t n = 0; n < 300; ++n) s += unit;
+		}
+		assert(not trip(s));
+
+		fmt::string packed(fmt::lz::bound(s.size()), '\0');
+		assert(fmt::lz::compress(s, packed.data()) < s.size() / 20);
+	}
+	// Damaged input fails without going outside of either buffer
+	{
+		auto const plain = prose(5000, 6);
+		fmt::string packed(fmt::lz::bound(plain.size()), '\0');
+		packed.resize(fmt::lz::compress(plain, packed.data()));
+		fmt::string back(plain.size(), '\0');
+		sys::bench::random next(6);
+		for (int i = 0; i < 2000; ++i)
+		{
+			auto bad = packed;
+			bad[next(bad.size())] ^= static_cast<char>(1 + next(255));
+			(void) fmt::lz::decompress(bad, back.data(), back.size());
+			(void) fmt::lz::decompress(view(packed).substr(0, next(packed.size())), back.data(), back.size());
+		}
+	}
+	// Frames unpacked on many threads, and damage to one of their blocks found
+	{
+		auto const plain = prose((1 << 20) + 77, 7) + noise(5000, 8);
+		fmt::string packed, back;
+		assert(not fmt::lz::pack(plain, packed, 1 << 14, 4));
+		assert(packed.size() < plain.size());
+		assert(not fmt::lz::unpack(packed, back, 4));
+		assert(back == plain);
+		assert(not fmt::lz::unpack(packed, back, 1));
+		assert(back == plain);
+
+		packed[packed.size() / 2] ^= 1;
+		assert(fmt::lz::unpack(packed, back, 4));
+		assert(fmt::lz::unpack(view(packed).substr(0, packed.size() - 1), back));
+	}
+	// Streams over a file write the same frame as packing, and read it back
+	{
+		auto const path = fmt::dir::join({ env::temp(), "oasys.lz" });
+		auto const plain = prose(300000, 9);
+		{
+			env::file::descriptor out(path, env::file::ov);
+			fmt::opackstream z(out, 1 << 12);
+			z << plain;
+			assert(not z.finish());
+		}
+
+		fmt::string packed, frame;
+		assert(not fmt::lz::pack(plain, packed, 1 << 12));
+		assert(not env::file::load(env::file::descriptor(path, env::file::rd), frame));
+		assert(frame == packed);
+
+		env::file::descriptor in(path, env::file::rd);
+		fmt::ipackstream z(in);
+		fmt::string const back { std::istreambuf_iterator<char>(z), std::istreambuf_iterator<char>() };
+		assert(back == plain);
+		(void) sys::unlink(path.c_str());
+	}
+	// A writer finishes its frame when it goes out of scope, with less than a block or with nothing
+	{
+		auto const path = fmt::dir::join({ env::temp(), "oasys.lz" });
+		for (size_t const size : { 1000, 0 })
+		{
+			auto const plain = prose(size, 10);
+			{
+				env::file::descriptor out(path, env::file::ov);
+				fmt::opackstream z(out, 1 << 12);
+				z << plain;
+			}
+
+			fmt::string packed, frame;
+			assert(not fmt::lz::pack(plain, packed, 1 << 12));
+			assert(not env::file::load(env::file::descriptor(path, env::file::rd), frame));
+			assert(frame == packed);
+
+			env::file::descriptor in(path, env::file::rd);
+			fmt::ipackstream z(in);
+			fmt::string const back { std::istreambuf_iterator<char>(z), std::istreambuf_iterator<char>() };
+			assert(back == plain);
+		}
+		(void) sys::unlink(path.c_str());
+	}
+}
+
+#endif
+#ifdef bench_unit
+
+bench_unit(lz)
+{
+	// Ratio and speed on text and on binary records, with one thread and with all
+	constexpr size_t size = 8 << 20;
+	auto const text = prose(size, 21);
+	auto const records = binary(size, 22);
+
+	for (auto const& [name, plain] : { std::pair("text", &text), std::pair("binary", &records) })
+	{
+		auto const kind = fmt::to_string(name);
+		fmt::string packed, back;
+		(void) fmt::lz::pack(*plain, packed);
+		auto const ratio = static_cast<double>(plain->size()) / static_cast<double>(packed.size());
+
+		bench(sys::bench::label(kind + "/pack", 1), size, [&](size_t n)
+		{
+			while (n--) (void) fmt::lz::pack(*plain, packed, 1 << 16, 1);
+		});
+		bench.results.back().counters.emplace_back("ratio", ratio);
+
+		bench(kind + "/pack", size, [&](size_t n)
+		{
+			while (n--) (void) fmt::lz::pack(*plain, packed);
+		});
+
+		bench(sys::bench::label(kind + "/unpack", 1), size, [&](size_t n)
+		{
+			while (n--) (void) fmt::lz::unpack(packed, back, 1);
+		});
+
+		bench(kind + "/unpack", size, [&](size_t n)
+		{
+			while (n--) (void) fmt::lz::unpack(packed, back);
+		});
+	}
+}
+
+#endif
@@ -0,0 +1,845 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "mem.hpp"
+#include "flat.hpp"
+#include "err.hpp"
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <map>
+#include <unordered_map>
+#ifdef _WIN32
+# include "win.hpp"
+#else
+# include <sys/mman.h>
+#endif
+
+namespace
+{
+	thread_local fwd::arena* innermost = nullptr;
+
+	constexpr std::size_t batch(std::size_t index)
+	// Blocks moved at once between a list and its source
+	{
+		return std::max<std::size_t>(256 >> index, 4);
+	}
+
+	void* heap(std::size_t size, std::size_t align)
+	{
+		if (__STDCPP_DEFAULT_NEW_ALIGNMENT__ < align)
+		{
+			return ::operator new(size, std::align_val_t(align));
+		}
+		return ::operator new(size);
+	}
+
+	void unheap(void* ptr, std::size_t size, std::size_t align)
+	{
+		if (__STDCPP_DEFAULT_NEW_ALIGNMENT__ < align)
+		{
+			::operator delete(ptr, size, std::align_val_t(align));
+		}
+		else ::operator delete(ptr, size);
+	}
+
+	void* pages(std::size_t size, bool huge)
+	// Anonymous pages, large ones if the system has them reserved
+	{
+		#ifdef _WIN32
+		{
+			void* ptr = nullptr;
+			if (huge)
+			{
+				ptr = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+			}
+			if (nullptr == ptr)
+			{
+				ptr = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			}
+			return ptr;
+		}
+		#else
+		{
+			constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+			void* ptr = MAP_FAILED;
+			#ifdef MAP_HUGETLB
+			if (huge)
+			{
+				ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+			}
+			#endif
+			if (MAP_FAILED == ptr)
+			{
+				ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+				if (MAP_FAILED == ptr)
+				{
+					return nullptr;
+				}
+				#ifdef MADV_HUGEPAGE
+				if (huge and sys::fail(madvise(ptr, size, MADV_HUGEPAGE)))
+				{
+					sys::warn(here, "madvise", size);
+				}
+				#endif
+			}
+			return ptr;
+		}
+		#endif
+	}
+
+	void unpages(void* ptr, std::size_t size)
+	{
+		#ifdef _WIN32
+		{
+			(void) size;
+			if (not VirtualFree(ptr, 0, MEM_RELEASE))
+			{
+				sys::win::err(here, "VirtualFree", ptr);
+			}
+		}
+		#else
+		{
+			if (sys::fail(munmap(ptr, size)))
+			{
+				sys::err(here, "munmap", ptr, size);
+			}
+		}
+		#endif
+	}
+}
+
+namespace fwd
+{
+	arena::arena(std::size_t block, bool huge) : grain(block), huge(huge)
+	{
+		if (huge)
+		{
+			grain = (grain + huge_page - 1) / huge_page * huge_page;
+		}
+	}
+
+	arena::~arena()
+	{
+		reset();
+		while (spare)
+		{
+			auto const b = spare;
+			spare = b->next;
+			free(b);
+		}
+	}
+
+	arena::block* arena::make(std::size_t size)
+	{
+		auto const page = huge ? huge_page : grain;
+		size = std::max(grain, (size + page - 1) / page * page);
+
+		void* ptr;
+		if (huge)
+		{
+			ptr = pages(size, true);
+			if (nullptr == ptr)
+			{
+				sys::err(here, "pages", size);
+				throw std::bad_alloc();
+			}
+		}
+		else ptr = ::operator new(size);
+
+		return new (ptr) block { nullptr, size, huge };
+	}
+
+	void arena::free(block* b)
+	{
+		if (b->mapped)
+		{
+			unpages(b, b->size);
+		}
+		else ::operator delete(b, b->size);
+	}
+
+	void* arena::grow(std::size_t size, std::size_t align)
+	{
+		auto const need = sizeof(block) + size + align;
+		if (need < size)
+		{
+			throw std::bad_alloc();
+		}
+
+		// Reuse the first spare with room before asking for more
+		block** link = &spare;
+		while (*link and (*link)->size < need)
+		{
+			link = &(*link)->next;
+		}
+
+		block* b = *link;
+		if (b)
+		{
+			*link = b->next;
+		}
+		else b = make(need);
+
+		b->next = head;
+		head = b;
+		pos = reinterpret_cast<std::uintptr_t>(b + 1);
+		end = reinterpret_cast<std::uintptr_t>(b) + b->size;
+
+		auto const at = (pos + align - 1) & ~(align - 1);
+		pos = at + size;
+		return reinterpret_cast<void*>(at);
+	}
+
+	void arena::rewind(mark m)
+	{
+		while (head != m.head)
+		{
+			auto const b = head;
+			head = b->next;
+			// Keep blocks of the usual size but not the odd large ones
+			if (grain < b->size)
+			{
+				free(b);
+			}
+			else
+			{
+				b->next = spare;
+				spare = b;
+			}
+		}
+		pos = m.pos;
+		end = m.end;
+	}
+
+	std::size_t arena::capacity() const
+	{
+		std::size_t sum = 0;
+		for (auto b = head; b; b = b->next) sum += b->size;
+		for (auto b = spare; b; b = b->next) sum += b->size;
+		return sum;
+	}
+
+	arena& arena::current()
+	{
+		if (innermost)
+		{
+			return *innermost;
+		}
+		thread_local arena own;
+		return own;
+	}
+
+	arena::scope::scope(arena& a) : that(&a), last(innermost), at(a.tell())
+	{
+		innermost = that;
+	}
+
+	arena::scope::~scope()
+	{
+		that->rewind(at);
+		innermost = last;
+	}
+
+	pool::~pool()
+	{
+		for (auto ptr : chunks)
+		{
+			::operator delete(ptr, chunk, std::align_val_t(largest));
+		}
+	}
+
+	pool::node* pool::carve(std::size_t index, std::size_t count)
+	{
+		auto const size = smallest << index;
+		auto const at = (pos + size - 1) & ~(size - 1);
+		if (end < at or (end - at) / size < count)
+		{
+			auto const ptr = ::operator new(chunk, std::align_val_t(largest));
+			chunks.push_back(ptr);
+			pos = reinterpret_cast<std::uintptr_t>(ptr);
+			end = pos + chunk;
+			return carve(index, count);
+		}
+
+		node* first = nullptr;
+		for (auto n = count; n > 0; --n)
+		{
+			auto const ptr = reinterpret_cast<node*>(at + (n - 1) * size);
+			ptr->next = first;
+			first = ptr;
+		}
+		pos = at + count * size;
+		return first;
+	}
+
+	void* pool::allocate(std::size_t size, std::size_t align)
+	{
+		auto const fit = std::max(size, align);
+		if (largest < fit)
+		{
+			return heap(size, align);
+		}
+
+		auto const i = index(fit);
+		if (nullptr == lists[i])
+		{
+			lists[i] = carve(i, batch(i));
+		}
+		auto const ptr = lists[i];
+		lists[i] = ptr->next;
+		return ptr;
+	}
+
+	void pool::deallocate(void* ptr, std::size_t size, std::size_t align)
+	{
+		auto const fit = std::max(size, align);
+		if (largest < fit)
+		{
+			unheap(ptr, size, align);
+			return;
+		}
+
+		auto const i = index(fit);
+		auto const n = static_cast<node*>(ptr);
+		n->next = lists[i];
+		lists[i] = n;
+	}
+}
+
+namespace
+{
+	struct depot : fwd::pool
+	// Shared pool which threads take from and give back to in lists
+	{
+		std::mutex lock;
+
+		static depot& get()
+		{
+			static depot that;
+			return that;
+		}
+
+		node* take(std::size_t index, std::size_t count)
+		{
+			std::lock_guard const hold(lock);
+			node* first = nullptr;
+			while (count > 0 and lists[index])
+			{
+				auto const n = lists[index];
+				lists[index] = n->next;
+				n->next = first;
+				first = n;
+				--count;
+			}
+			if (count > 0)
+			{
+				auto const fresh = carve(index, count);
+				auto last = fresh;
+				while (last->next) last = last->next;
+				last->next = first;
+				first = fresh;
+			}
+			return first;
+		}
+
+		void give(std::size_t index, node* first, node* last)
+		{
+			std::lock_guard const hold(lock);
+			last->next = lists[index];
+			lists[index] = first;
+		}
+
+		struct cache : fwd::unique
+		// Lists of one thread, given back when it ends
+		{
+			node* lists[classes] { };
+			std::size_t counts[classes] { };
+
+			~cache()
+			{
+				for (std::size_t i = 0; i < classes; ++i)
+				{
+					if (lists[i])
+					{
+						auto last = lists[i];
+						while (last->next) last = last->next;
+						get().give(i, lists[i], last);
+					}
+				}
+			}
+		};
+
+		static cache& local()
+		{
+			thread_local cache that;
+			return that;
+		}
+	};
+}
+
+namespace fwd
+{
+	void* pool::shared::allocate(std::size_t size, std::size_t align)
+	{
+		if (largest < std::max(size, align))
+		{
+			return heap(size, align);
+		}
+		auto& that = depot::get();
+		std::lock_guard const hold(that.lock);
+		return that.allocate(size, align);
+	}
+
+	void pool::shared::deallocate(void* ptr, std::size_t size, std::size_t align)
+	{
+		if (largest < std::max(size, align))
+		{
+			unheap(ptr, size, align);
+			return;
+		}
+		auto& that = depot::get();
+		std::lock_guard const hold(that.lock);
+		that.deallocate(ptr, size, align);
+	}
+
+	void* pool::cached::allocate(std::size_t size, std::size_t align)
+	{
+		auto const fit = std::max(size, align);
+		if (largest < fit)
+		{
+			return heap(size, align);
+		}
+
+		auto const i = index(fit);
+		auto& that = depot::local();
+		if (nullptr == that.lists[i])
+		{
+			that.lists[i] = depot::get().take(i, batch(i));
+			that.counts[i] = batch(i);
+		}
+		auto const ptr = that.lists[i];
+		that.lists[i] = ptr->next;
+		--that.counts[i];
+		return ptr;
+	}
+
+	void pool::cached::deallocate(void* ptr, std::size_t size, std::size_t align)
+	{
+		auto const fit = std::max(size, align);
+		if (largest < fit)
+		{
+			unheap(ptr, size, align);
+			return;
+		}
+
+		auto const i = index(fit);
+		auto& that = depot::local();
+		auto const n = static_cast<node*>(ptr);
+		n->next = that.lists[i];
+		that.lists[i] = n;
+
+		// Give a batch back when the list is long, keeping the rest warm
+		if (2 * batch(i) < ++that.counts[i])
+		{
+			auto last = n;
+			for (auto k = batch(i); k > 1; --k)
+			{
+				last = last->next;
+			}
+			that.lists[i] = last->next;
+			that.counts[i] -= batch(i);
+			depot::get().give(i, n, last);
+		}
+	}
+}
+
+#ifdef test_unit
+
+test_unit(mem)
+{
+	// Bump allocation is aligned and rewinds to the same place
+	{
+		fwd::arena a(1 << 12);
+		auto const p = static_cast<char*>(a.allocate(1, 1));
+		auto const q = static_cast<char*>(a.allocate(8, 8));
+		assert(0 == reinterpret_cast<std::uintptr_t>(q) % 8 and q - p < 16);
+
+		auto const m = a.tell();
+		auto const r = a.allocate(100);
+		for (int i = 0; i < 1000; ++i) (void) a.allocate(64);
+		auto const held = a.capacity();
+		a.rewind(m);
+		assert(r == a.allocate(100));
+		for (int i = 0; i < 1000; ++i) (void) a.allocate(64);
+		assert(held == a.capacity() and "Blocks are reused");
+
+		auto const big = static_cast<char*>(a.allocate(1 << 20));
+		big[0] = big[(1 << 20) - 1] = 1;
+		a.reset();
+		assert(held == a.capacity() and "Large blocks are dropped");
+	}
+
+	// Containers in a scope use its arena and leave it as it was
+	{
+		fwd::arena a;
+		auto const before = a.tell();
+		{
+			fwd::arena::scope const outer(a);
+			fmt::arena_string s("text which is too long to fit in the string itself");
+			fmt::arena_vector<int> v;
+			for (int i = 0; i < 100; ++i) v.push_back(i);
+			assert(&fwd::arena::current() == &a and v.get_allocator().from == &a);
+			assert(99 == v.back() and 15 < s.size());
+
+			auto const mid = a.allocate(1);
+			{
+				fwd::arena::scope const inner;
+				fmt::arena_vector<long> w(1000, 7);
+				assert(7 == w.back());
+			}
+			assert(static_cast<char*>(mid) + 1 == a.allocate(1, 1) and "Inner scope rewinds");
+		}
+		assert(&fwd::arena::current() != &a);
+		auto const after = a.tell();
+		assert(before.head == after.head and before.pos == after.pos);
+	}
+
+	// Huge pages, or ordinary ones where the system has none
+	{
+		fwd::huge_arena h;
+		auto const p = static_cast<char*>(h.allocate(1 << 20));
+		p[0] = p[(1 << 20) - 1] = 1;
+		assert(fwd::arena::huge_page <= h.capacity());
+	}
+
+	// Size classes
+	{
+		static_assert(0 == fwd::pool::index(1) and 0 == fwd::pool::index(16));
+		static_assert(1 == fwd::pool::index(17) and 8 == fwd::pool::index(4096));
+
+		fwd::pool p;
+		auto const a = p.allocate(24);
+		assert(0 == reinterpret_cast<std::uintptr_t>(a) % 32);
+		p.deallocate(a, 24);
+		assert(a == p.allocate(30) and "Freed blocks are reused in their class");
+		auto const big = p.allocate(10000, 64);
+		assert(0 == reinterpret_cast<std::uintptr_t>(big) % 64);
+		p.deallocate(big, 10000, 64);
+	}
+
+	// Shared and cached pools, freeing on a thread other than the one which allocated
+	{
+		fmt::pool_string s("pooled text longer than the small string buffer");
+		fmt::cache_vector<int> v(1000, 3);
+		fwd::set<int, fwd::order, fwd::cache_allocator> t;
+		std::thread worker([&]
+		{
+			fwd::set<int, fwd::order, fwd::cache_allocator> u;
+			for (int i = 0; i < 1000; ++i) u.insert(i);
+			t = u;
+			s += s;
+			v.clear();
+			v.shrink_to_fit();
+		});
+		worker.join();
+		assert(1000 == t.size() and 999 == *t.rbegin());
+		assert(s.size() == 2 * s.find("pooled", 1));
+		t.clear();
+	}
+}
+
+test_unit(flat)
+{
+	// Sorted and unique however the values arrive
+	{
+		fwd::flat_set<int> s { 5, 1, 4, 1, 3 };
+		assert(4 == s.size() and 1 == *s.begin() and 5 == *std::prev(s.end()));
+		assert(s.contains(4) and not s.contains(2));
+		assert(s.insert(2).second and not s.insert(2).second);
+		int const more[] = { 9, 0, 3, 7 };
+		s.insert(std::begin(more), std::end(more));
+		assert(std::is_sorted(s.begin(), s.end()) and 8 == s.size());
+		assert(7 == *s.lower_bound(6) and 7 == *s.upper_bound(5));
+		assert(1 == s.erase(0) and 0 == s.erase(0));
+		for (int i = -1; i < 11; ++i)
+		{
+			assert(s.contains(i) == std::binary_search(s.begin(), s.end(), i));
+		}
+	}
+
+	// Map with the first of each key kept, as a tree would
+	{
+		fwd::flat_map<fmt::string, int> m { { "b", 2 }, { "a", 1 }, { "b", 3 } };
+		assert(2 == m.size() and "a" == m.begin()->first and 2 == m.at("b"));
+		m["c"] = 4;
+		assert(not m.emplace("c", 5).second and 4 == m.at("c"));
+		m.insert_or_assign("c", 6);
+		assert(6 == m["c"] and 3 == m.size());
+		auto const [first, last] = m.equal_range("b");
+		assert(1 == std::distance(first, last) and 2 == first->second);
+		assert(m.end() == m.find("d") and 1 == m.erase("a"));
+	}
+
+	// Hash table through growth, deletion and reuse of deleted slots
+	{
+		fwd::hash_map<int, int> h;
+		for (int i = 0; i < 1000; ++i) h[i] = i * i;
+		assert(1000 == h.size() and 81 == h.at(9));
+		for (int i = 0; i < 1000; i += 2) assert(1 == h.erase(i));
+		assert(500 == h.size() and not h.contains(2) and h.contains(3));
+		for (int i = 0; i < 1000; i += 2) h.emplace(i, -i);
+		assert(1000 == h.size() and -4 == h.at(4) and 9 == h.at(3));
+		std::size_t walked = 0;
+		long long sum = 0;
+		for (auto const& [key, value] : h)
+		{
+			++walked;
+			sum += key;
+		}
+		assert(1000 == walked and 999 * 1000 / 2 == sum);
+
+		auto copy = h;
+		h.clear();
+		assert(h.empty() and h.end() == h.find(1) and 1000 == copy.size());
+		auto moved = std::move(copy);
+		assert(copy.empty() and 1 == moved.at(1));
+	}
+
+	// String keys, hashed as views
+	{
+		fwd::hash_map<fmt::string::view, std::size_t> h;
+		auto const words = fmt::split("one two three four five six seven eight nine ten", " ");
+		for (auto const& w : words) h.emplace(w, w.size());
+		assert(10 == h.size() and 5 == h.at("three") and not h.contains("zero"));
+	}
+}
+
+test_unit(small)
+{
+	// Inline until full, then on the heap with the same contents
+	{
+		fwd::small_vector<fmt::string, 4> v { "a", "b", "c" };
+		auto const count = sys::bench::allocations();
+		v.push_back("d");
+		assert(not v.spilled() and 4 == v.capacity());
+		assert(count == sys::bench::allocations());
+		v.emplace_back(v.front());
+		assert(v.spilled() and 5 == v.size() and "a" == v.back());
+		v.erase(v.begin() + 1);
+		assert("c" == v[1] and 4 == v.size());
+		v.insert(v.begin(), "z");
+		assert("z" == v.front() and "a" == v[1]);
+		v.resize(2);
+		v.shrink_to_fit();
+		assert(not v.spilled() and 2 == v.size() and "a" == v.back());
+	}
+
+	// Copies and moves of inline and heap storage
+	{
+		fwd::small_vector<int, 2> a { 1, 2 }, b { 1, 2, 3 };
+		auto c = a, d = b;
+		assert(c == a and d == b and not c.spilled() and d.spilled());
+		auto const heap = d.data();
+		auto e = std::move(d), f = std::move(c);
+		assert(heap == e.data() and d.empty() and not d.spilled());
+		assert(f == a and c.empty());
+		e.swap(f);
+		assert(e == a and f == b);
+		fwd::span<int const> s = f;
+		assert(3 == s.size() and 3 == s.back());
+		assert(2 == e.at(1));
+	}
+}
+
+#endif
+#ifdef bench_unit
+
+namespace
+{
+	template <template <class> class Alloc> void request(sys::bench::random& next, fwd::vector<fmt::string> const& words)
+	// Temporary strings, a vector and a set like a handler would build
+	{
+		using string = fmt::basic_string<char, fwd::character, Alloc>;
+		fwd::vector<string, Alloc> parts;
+		fwd::set<int, fwd::order, Alloc> seen;
+		for (int i = 0; i < 64; ++i)
+		{
+			string s(words[next(words.size())]);
+			s += " and ";
+			s += words[next(words.size())];
+			parts.push_back(std::move(s));
+			seen.insert(static_cast<int>(next(256)));
+		}
+		sys::bench::keep(parts.size() + seen.size());
+	}
+}
+
+bench_unit(mem)
+{
+	auto const words = sys::bench::words(1024);
+	sys::bench::random next(5);
+
+	bench("request/std", 0, [&](std::size_t n)
+	{
+		while (n--) request<fwd::allocator>(next, words);
+	});
+
+	bench("request/arena", 0, [&](std::size_t n)
+	{
+		fwd::arena a;
+		while (n--)
+		{
+			fwd::arena::scope const s(a);
+			request<fwd::arena_allocator>(next, words);
+		}
+	});
+
+	bench("request/huge", 0, [&](std::size_t n)
+	{
+		fwd::huge_arena a;
+		while (n--)
+		{
+			fwd::arena::scope const s(a);
+			request<fwd::arena_allocator>(next, words);
+		}
+	});
+
+	bench("request/pool", 0, [&](std::size_t n)
+	{
+		while (n--) request<fwd::pool_allocator>(next, words);
+	});
+
+	bench("request/cache", 0, [&](std::size_t n)
+	{
+		while (n--) request<fwd::cache_allocator>(next, words);
+	});
+
+	// Argument lists like those built for each process started
+	auto const args = fmt::split("cat -n --number-nonblank --show-ends file.txt", " ");
+
+	bench("args/vector", 0, [&](std::size_t n)
+	{
+		while (n--)
+		{
+			fwd::vector<char const*> list;
+			for (auto u : args) list.push_back(u.data());
+			list.push_back(nullptr);
+			sys::bench::keep(list.data());
+		}
+	});
+
+	bench("args/small", 0, [&](std::size_t n)
+	{
+		while (n--)
+		{
+			fwd::small_vector<char const*, 16> list;
+			for (auto u : args) list.push_back(u.data());
+			list.push_back(nullptr);
+			sys::bench::keep(list.data());
+		}
+	});
+
+	// Node churn on every thread, where the shared pool contends for its lock
+	auto const threads = std::max(2u, std::thread::hardware_concurrency());
+
+	auto const churn = [&]<template <class> class Alloc>(fmt::string::view label)
+	{
+		bench.parallel(label, threads, 0, [](std::size_t n, std::size_t id)
+		{
+			fwd::set<int, fwd::order, Alloc> s;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				s.insert(static_cast<int>(i * 2654435761u + id));
+				if (256 < s.size()) s.erase(s.begin());
+			}
+			sys::bench::keep(s.size());
+		});
+	};
+
+	churn.operator()<fwd::allocator>("churn/std");
+	churn.operator()<fwd::pool_allocator>("churn/pool");
+	churn.operator()<fwd::cache_allocator>("churn/cache");
+}
+
+bench_unit(flat)
+{
+	// Lookups of keys which are present in tables built once
+	for (std::size_t size : { 16, 1 << 10, 1 << 16 })
+	{
+		using view = fmt::string::view;
+		auto const words = sys::bench::words(size);
+		fwd::vector<view> const keys(words.begin(), words.end());
+
+		std::map<view, std::size_t> tree;
+		fwd::flat_map<view, std::size_t> flat;
+		fwd::hash_map<view, std::size_t> table;
+		std::unordered_map<std::string_view, std::size_t> unordered;
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			tree.emplace(keys[i], i);
+			flat.emplace(keys[i], i);
+			table.emplace(keys[i], i);
+			unordered.emplace(keys[i], i);
+		}
+
+		sys::bench::random next(size);
+		fwd::vector<view> order(4096);
+		for (auto& key : order) key = keys[next(size)];
+
+		bench(sys::bench::label("map", size), 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(tree.find(order[i & 4095])->second);
+		});
+
+		bench(sys::bench::label("flat", size), 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(flat.find(order[i & 4095])->second);
+		});
+
+		bench(sys::bench::label("hash", size), 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(table.find(order[i & 4095])->second);
+		});
+
+		bench(sys::bench::label("unordered", size), 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(unordered.find(order[i & 4095])->second);
+		});
+	}
+
+	// Integer keys, where the search itself is most of the cost
+	{
+		constexpr int size = 1 << 12;
+		std::map<int, int> tree;
+		fwd::flat_set<int> flat;
+		fwd::hash_map<int, int> table;
+		for (int i = 0; i < size; ++i)
+		{
+			tree.emplace(i * 7, i);
+			(void) flat.insert(i * 7);
+			table.emplace(i * 7, i);
+		}
+
+		sys::bench::random next(3);
+		fwd::vector<int> order(4096);
+		for (auto& key : order) key = static_cast<int>(next(size)) * 7;
+
+		bench("int/map", 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(tree.find(order[i & 4095])->second);
+		});
+
+		bench("int/flat", 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(*flat.find(order[i & 4095]));
+		});
+
+		bench("int/hash", 0, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; ++i) sys::bench::keep(table.find(order[i & 4095])->second);
+		});
+	}
+}
+
+#endif
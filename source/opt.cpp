@@ -335,14 +335,14 @@ namespace env::opt
 		return set(make_pair(key), value);
 	}
 
-	fmt::string::view::vector put(int argc, char** argv, command::span cmd)
+	fmt::string::view::small put(int argc, char** argv, command::span cmd)
 	{
 		assert(nullptr == argv[argc]);
 		// Push a view to command line arguments
 		std::copy(argv, argv + argc, std::back_inserter(list));
 		// Arguments not part of a command
-		fmt::string::view::vector extra;
-		fmt::string::view::vector args;
+		fmt::string::view::small extra;
+		fmt::string::view::small args;
 		// Command line range
 		auto const end = cmd.end();
 		auto current = end;
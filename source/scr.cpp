@@ -0,0 +1,716 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "scr.hpp"
+#include "char.hpp"
+#include "err.hpp"
+#include <algorithm>
+#include <charconv>
+
+namespace
+{
+	void number(fmt::string& buf, std::size_t n)
+	{
+		char tmp[24];
+		auto const res = std::to_chars(tmp, tmp + sizeof tmp, n);
+		buf.append(tmp, res.ptr);
+	}
+
+	void intro(fmt::string& buf)
+	{
+		buf += fmt::C0::ESC;
+		buf += fmt::G0::CSI;
+	}
+
+	char32_t decode(fmt::view::const_iterator& it, fmt::view::const_iterator end)
+	// Next code point from UTF-8, or the replacement for a broken sequence
+	{
+		constexpr char32_t bad = 0xFFFD;
+		auto const c = static_cast<unsigned char>(*it++);
+		if (c < 0x80) return c;
+
+		int extra = 0xF0 <= c ? 3 : 0xE0 <= c ? 2 : 0xC0 <= c ? 1 : 0;
+		if (0 == extra or 0xF8 <= c) return bad;
+
+		char32_t code = c & (0x3F >> extra);
+		for (; 0 < extra; --extra)
+		{
+			if (end == it or 0x80 != (*it & 0xC0)) return bad;
+			code = code << 6 | (*it++ & 0x3F);
+		}
+		return code;
+	}
+
+	struct range
+	{
+		char32_t first, last;
+	};
+
+	constexpr range joining[] =
+	// Marks and formats which join the character before, from Unicode 14.0.0
+	{
+		{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+		{ 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0600, 0x0605 },
+		{ 0x0610, 0x061A }, { 0x061C, 0x061C }, { 0x064B, 0x065F }, { 0x0670, 0x0670 },
+		{ 0x06D6, 0x06DD }, { 0x06DF, 0x06E4 }, { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED },
+		{ 0x070F, 0x070F }, { 0x0711, 0x0711 }, { 0x0730, 0x074A }, { 0x07A6, 0x07B0 },
+		{ 0x07EB, 0x07F3 }, { 0x07FD, 0x07FD }, { 0x0816, 0x0819 }, { 0x081B, 0x0823 },
+		{ 0x0825, 0x0827 }, { 0x0829, 0x082D }, { 0x0859, 0x085B }, { 0x0890, 0x089F },
+		{ 0x08CA, 0x0902 }, { 0x093A, 0x093A }, { 0x093C, 0x093C }, { 0x0941, 0x0948 },
+		{ 0x094D, 0x094D }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 }, { 0x0981, 0x0981 },
+		{ 0x09BC, 0x09BC }, { 0x09C1, 0x09C4 }, { 0x09CD, 0x09CD }, { 0x09E2, 0x09E3 },
+		{ 0x09FE, 0x0A02 }, { 0x0A3C, 0x0A3C }, { 0x0A41, 0x0A51 }, { 0x0A70, 0x0A71 },
+		{ 0x0A75, 0x0A75 }, { 0x0A81, 0x0A82 }, { 0x0ABC, 0x0ABC }, { 0x0AC1, 0x0AC8 },
+		{ 0x0ACD, 0x0ACD }, { 0x0AE2, 0x0AE3 }, { 0x0AFA, 0x0B01 }, { 0x0B3C, 0x0B3C },
+		{ 0x0B3F, 0x0B3F }, { 0x0B41, 0x0B44 }, { 0x0B4D, 0x0B56 }, { 0x0B62, 0x0B63 },
+		{ 0x0B82, 0x0B82 }, { 0x0BC0, 0x0BC0 }, { 0x0BCD, 0x0BCD }, { 0x0C00, 0x0C00 },
+		{ 0x0C04, 0x0C04 }, { 0x0C3C, 0x0C3C }, { 0x0C3E, 0x0C40 }, { 0x0C46, 0x0C56 },
+		{ 0x0C62, 0x0C63 }, { 0x0C81, 0x0C81 }, { 0x0CBC, 0x0CBC }, { 0x0CBF, 0x0CBF },
+		{ 0x0CC6, 0x0CC6 }, { 0x0CCC, 0x0CCD }, { 0x0CE2, 0x0CE3 }, { 0x0D00, 0x0D01 },
+		{ 0x0D3B, 0x0D3C }, { 0x0D41, 0x0D44 }, { 0x0D4D, 0x0D4D }, { 0x0D62, 0x0D63 },
+		{ 0x0D81, 0x0D81 }, { 0x0DCA, 0x0DCA }, { 0x0DD2, 0x0DD6 }, { 0x0E31, 0x0E31 },
+		{ 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x0EB1, 0x0EB1 }, { 0x0EB4, 0x0EBC },
+		{ 0x0EC8, 0x0ECD }, { 0x0F18, 0x0F19 }, { 0x0F35, 0x0F35 }, { 0x0F37, 0x0F37 },
+		{ 0x0F39, 0x0F39 }, { 0x0F71, 0x0F7E }, { 0x0F80, 0x0F84 }, { 0x0F86, 0x0F87 },
+		{ 0x0F8D, 0x0FBC }, { 0x0FC6, 0x0FC6 }, { 0x102D, 0x1030 }, { 0x1032, 0x1037 },
+		{ 0x1039, 0x103A }, { 0x103D, 0x103E }, { 0x1058, 0x1059 }, { 0x105E, 0x1060 },
+		{ 0x1071, 0x1074 }, { 0x1082, 0x1082 }, { 0x1085, 0x1086 }, { 0x108D, 0x108D },
+		{ 0x109D, 0x109D }, { 0x1160, 0x11FF }, { 0x135D, 0x135F }, { 0x1712, 0x1714 },
+		{ 0x1732, 0x1733 }, { 0x1752, 0x1753 }, { 0x1772, 0x1773 }, { 0x17B4, 0x17B5 },
+		{ 0x17B7, 0x17BD }, { 0x17C6, 0x17C6 }, { 0x17C9, 0x17D3 }, { 0x17DD, 0x17DD },
+		{ 0x180B, 0x180F }, { 0x1885, 0x1886 }, { 0x18A9, 0x18A9 }, { 0x1920, 0x1922 },
+		{ 0x1927, 0x1928 }, { 0x1932, 0x1932 }, { 0x1939, 0x193B }, { 0x1A17, 0x1A18 },
+		{ 0x1A1B, 0x1A1B }, { 0x1A56, 0x1A56 }, { 0x1A58, 0x1A60 }, { 0x1A62, 0x1A62 },
+		{ 0x1A65, 0x1A6C }, { 0x1A73, 0x1A7F }, { 0x1AB0, 0x1B03 }, { 0x1B34, 0x1B34 },
+		{ 0x1B36, 0x1B3A }, { 0x1B3C, 0x1B3C }, { 0x1B42, 0x1B42 }, { 0x1B6B, 0x1B73 },
+		{ 0x1B80, 0x1B81 }, { 0x1BA2, 0x1BA5 }, { 0x1BA8, 0x1BA9 }, { 0x1BAB, 0x1BAD },
+		{ 0x1BE6, 0x1BE6 }, { 0x1BE8, 0x1BE9 }, { 0x1BED, 0x1BED }, { 0x1BEF, 0x1BF1 },
+		{ 0x1C2C, 0x1C33 }, { 0x1C36, 0x1C37 }, { 0x1CD0, 0x1CD2 }, { 0x1CD4, 0x1CE0 },
+		{ 0x1CE2, 0x1CE8 }, { 0x1CED, 0x1CED }, { 0x1CF4, 0x1CF4 }, { 0x1CF8, 0x1CF9 },
+		{ 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x206F },
+		{ 0x20D0, 0x20F0 }, { 0x2CEF, 0x2CF1 }, { 0x2D7F, 0x2D7F }, { 0x2DE0, 0x2DFF },
+		{ 0x302A, 0x302D }, { 0x3099, 0x309A }, { 0xA66F, 0xA672 }, { 0xA674, 0xA67D },
+		{ 0xA69E, 0xA69F }, { 0xA6F0, 0xA6F1 }, { 0xA802, 0xA802 }, { 0xA806, 0xA806 },
+		{ 0xA80B, 0xA80B }, { 0xA825, 0xA826 }, { 0xA82C, 0xA82C }, { 0xA8C4, 0xA8C5 },
+		{ 0xA8E0, 0xA8F1 }, { 0xA8FF, 0xA8FF }, { 0xA926, 0xA92D }, { 0xA947, 0xA951 },
+		{ 0xA980, 0xA982 }, { 0xA9B3, 0xA9B3 }, { 0xA9B6, 0xA9B9 }, { 0xA9BC, 0xA9BD },
+		{ 0xA9E5, 0xA9E5 }, { 0xAA29, 0xAA2E }, { 0xAA31, 0xAA32 }, { 0xAA35, 0xAA36 },
+		{ 0xAA43, 0xAA43 }, { 0xAA4C, 0xAA4C }, { 0xAA7C, 0xAA7C }, { 0xAAB0, 0xAAB0 },
+		{ 0xAAB2, 0xAAB4 }, { 0xAAB7, 0xAAB8 }, { 0xAABE, 0xAABF }, { 0xAAC1, 0xAAC1 },
+		{ 0xAAEC, 0xAAED }, { 0xAAF6, 0xAAF6 }, { 0xABE5, 0xABE5 }, { 0xABE8, 0xABE8 },
+		{ 0xABED, 0xABED }, { 0xD7B0, 0xD7FF }, { 0xFB1E, 0xFB1E }, { 0xFE00, 0xFE0F },
+		{ 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0xFFF9, 0xFFFB }, { 0x101FD, 0x101FD },
+		{ 0x102E0, 0x102E0 }, { 0x10376, 0x1037A }, { 0x10A01, 0x10A0F }, { 0x10A38, 0x10A3F },
+		{ 0x10AE5, 0x10AE6 }, { 0x10D24, 0x10D27 }, { 0x10EAB, 0x10EAC }, { 0x10F46, 0x10F50 },
+		{ 0x10F82, 0x10F85 }, { 0x11001, 0x11001 }, { 0x11038, 0x11046 }, { 0x11070, 0x11070 },
+		{ 0x11073, 0x11074 }, { 0x1107F, 0x11081 }, { 0x110B3, 0x110B6 }, { 0x110B9, 0x110BA },
+		{ 0x110BD, 0x110BD }, { 0x110C2, 0x110CD }, { 0x11100, 0x11102 }, { 0x11127, 0x1112B },
+		{ 0x1112D, 0x11134 }, { 0x11173, 0x11173 }, { 0x11180, 0x11181 }, { 0x111B6, 0x111BE },
+		{ 0x111C9, 0x111CC }, { 0x111CF, 0x111CF }, { 0x1122F, 0x11231 }, { 0x11234, 0x11234 },
+		{ 0x11236, 0x11237 }, { 0x1123E, 0x1123E }, { 0x112DF, 0x112DF }, { 0x112E3, 0x112EA },
+		{ 0x11300, 0x11301 }, { 0x1133B, 0x1133C }, { 0x11340, 0x11340 }, { 0x11366, 0x11374 },
+		{ 0x11438, 0x1143F }, { 0x11442, 0x11444 }, { 0x11446, 0x11446 }, { 0x1145E, 0x1145E },
+		{ 0x114B3, 0x114B8 }, { 0x114BA, 0x114BA }, { 0x114BF, 0x114C0 }, { 0x114C2, 0x114C3 },
+		{ 0x115B2, 0x115B5 }, { 0x115BC, 0x115BD }, { 0x115BF, 0x115C0 }, { 0x115DC, 0x115DD },
+		{ 0x11633, 0x1163A }, { 0x1163D, 0x1163D }, { 0x1163F, 0x11640 }, { 0x116AB, 0x116AB },
+		{ 0x116AD, 0x116AD }, { 0x116B0, 0x116B5 }, { 0x116B7, 0x116B7 }, { 0x1171D, 0x1171F },
+		{ 0x11722, 0x11725 }, { 0x11727, 0x1172B }, { 0x1182F, 0x11837 }, { 0x11839, 0x1183A },
+		{ 0x1193B, 0x1193C }, { 0x1193E, 0x1193E }, { 0x11943, 0x11943 }, { 0x119D4, 0x119DB },
+		{ 0x119E0, 0x119E0 }, { 0x11A01, 0x11A0A }, { 0x11A33, 0x11A38 }, { 0x11A3B, 0x11A3E },
+		{ 0x11A47, 0x11A47 }, { 0x11A51, 0x11A56 }, { 0x11A59, 0x11A5B }, { 0x11A8A, 0x11A96 },
+		{ 0x11A98, 0x11A99 }, { 0x11C30, 0x11C3D }, { 0x11C3F, 0x11C3F }, { 0x11C92, 0x11CA7 },
+		{ 0x11CAA, 0x11CB0 }, { 0x11CB2, 0x11CB3 }, { 0x11CB5, 0x11CB6 }, { 0x11D31, 0x11D45 },
+		{ 0x11D47, 0x11D47 }, { 0x11D90, 0x11D91 }, { 0x11D95, 0x11D95 }, { 0x11D97, 0x11D97 },
+		{ 0x11EF3, 0x11EF4 }, { 0x13430, 0x13438 }, { 0x16AF0, 0x16AF4 }, { 0x16B30, 0x16B36 },
+		{ 0x16F4F, 0x16F4F }, { 0x16F8F, 0x16F92 }, { 0x16FE4, 0x16FE4 }, { 0x1BC9D, 0x1BC9E },
+		{ 0x1BCA0, 0x1CF46 }, { 0x1D167, 0x1D169 }, { 0x1D173, 0x1D182 }, { 0x1D185, 0x1D18B },
+		{ 0x1D1AA, 0x1D1AD }, { 0x1D242, 0x1D244 }, { 0x1DA00, 0x1DA36 }, { 0x1DA3B, 0x1DA6C },
+		{ 0x1DA75, 0x1DA75 }, { 0x1DA84, 0x1DA84 }, { 0x1DA9B, 0x1DAAF }, { 0x1E000, 0x1E02A },
+		{ 0x1E130, 0x1E136 }, { 0x1E2AE, 0x1E2AE }, { 0x1E2EC, 0x1E2EF }, { 0x1E8D0, 0x1E8D6 },
+		{ 0x1E944, 0x1E94A }, { 0xE0001, 0xE01EF },
+	};
+
+	constexpr range wide[] =
+	// East Asian wide and full width characters, and emoji shown as pictures
+	{
+		{ 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+		{ 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+		{ 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+		{ 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+		{ 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+		{ 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+		{ 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+		{ 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+		{ 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x303E },
+		{ 0x3041, 0x3247 }, { 0x3250, 0x4DBF }, { 0x4E00, 0xA4C6 }, { 0xA960, 0xA97C },
+		{ 0xAC00, 0xD7A3 }, { 0xF900, 0xFAD9 }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6B },
+		{ 0xFF01, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x1B2FB }, { 0x1F004, 0x1F004 },
+		{ 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F320 },
+		{ 0x1F32D, 0x1F335 }, { 0x1F337, 0x1F37C }, { 0x1F37E, 0x1F393 }, { 0x1F3A0, 0x1F3CA },
+		{ 0x1F3CF, 0x1F3D3 }, { 0x1F3E0, 0x1F3F0 }, { 0x1F3F4, 0x1F3F4 }, { 0x1F3F8, 0x1F43E },
+		{ 0x1F440, 0x1F440 }, { 0x1F442, 0x1F4FC }, { 0x1F4FF, 0x1F53D }, { 0x1F54B, 0x1F54E },
+		{ 0x1F550, 0x1F567 }, { 0x1F57A, 0x1F57A }, { 0x1F595, 0x1F596 }, { 0x1F5A4, 0x1F5A4 },
+		{ 0x1F5FB, 0x1F64F }, { 0x1F680, 0x1F6C5 }, { 0x1F6CC, 0x1F6CC }, { 0x1F6D0, 0x1F6D2 },
+		{ 0x1F6D5, 0x1F6DF }, { 0x1F6EB, 0x1F6EC }, { 0x1F6F4, 0x1F6FC }, { 0x1F7E0, 0x1F7F0 },
+		{ 0x1F90C, 0x1F93A }, { 0x1F93C, 0x1F945 }, { 0x1F947, 0x1F9FF }, { 0x1FA70, 0x1FAF6 },
+		{ 0x20000, 0x3FFFD },
+	};
+
+	template <std::size_t N> bool within(range const (&table)[N], char32_t c)
+	{
+		auto const it = std::upper_bound(table, table + N, c, [](char32_t code, range const& r)
+		{
+			return code < r.first;
+		});
+		return it != table and c <= it[-1].last;
+	}
+
+	std::size_t columns(char32_t c)
+	// Cells a terminal gives the character, with none for controls and for
+	// marks which join the one before, neither of which can have a cell
+	{
+		if (c < 0x20 or (0x7F <= c and c < 0xA0)) return 0;
+		if (c < 0x300) return 1;
+		if (within(joining, c)) return 0;
+		if (within(wide, c)) return 2;
+		return 1;
+	}
+
+	struct params
+	// Graphic rendition parameters gathered for one sequence
+	{
+		int list[16];
+		std::size_t size = 0;
+		std::size_t width = 0; // encoded length
+
+		void add(int n)
+		{
+			list[size++] = n;
+			width += 1 + (10 <= n) + (100 <= n);
+		}
+
+		void color(std::uint16_t c, int base, int bright)
+		{
+			if (fmt::cell::plain == c) add(base + 9);
+			else if (c < 8) add(base + c);
+			else if (c < 16) add(bright + c - 8);
+			else { add(base + 8); add(5); add(c); }
+		}
+
+		void attrs(unsigned char bits)
+		{
+			constexpr struct { unsigned char bit; int on; } map[] =
+			{
+				{ fmt::cell::intense, fmt::SGR::intense },
+				{ fmt::cell::faint, fmt::SGR::faint },
+				{ fmt::cell::italic, fmt::SGR::italic },
+				{ fmt::cell::underline, fmt::SGR::underline },
+				{ fmt::cell::blink, fmt::SGR::blink_slow },
+				{ fmt::cell::reverse, fmt::SGR::reverse },
+				{ fmt::cell::strike, fmt::SGR::strike },
+			};
+
+			for (auto const& m : map)
+			{
+				if (bits & m.bit) add(m.on);
+			}
+		}
+	};
+}
+
+namespace fmt
+{
+	void screen::resize(std::size_t cols, std::size_t rows)
+	{
+		width = cols;
+		height = rows;
+		next.assign(cols * rows, cell{});
+		last.assign(cols * rows, cell{});
+		fresh = true;
+	}
+
+	void screen::fill(cell c)
+	{
+		std::fill(next.begin(), next.end(), c);
+	}
+
+	std::size_t screen::put(std::size_t col, std::size_t row, view text, cell style)
+	{
+		assert(row < height);
+		auto it = text.begin();
+		while (col < width and it != text.end())
+		{
+			auto code = decode(it, text.end());
+			auto n = columns(code);
+			if (0 == n)
+			{
+				// Controls would move the cursor behind our back and
+				// a joining mark has no cell of its own to go in
+				code = 0xFFFD;
+				n = 1;
+			}
+			if (width < col + n)
+			{
+				break;
+			}
+			style.code = code;
+			next[row * width + col++] = style;
+			if (2 == n)
+			{
+				style.code = cell::trail;
+				next[row * width + col++] = style;
+			}
+		}
+		return col;
+	}
+
+	void screen::glyph(char32_t c)
+	{
+		if (c < 0x80)
+		{
+			buf += static_cast<char>(c);
+		}
+		else
+		if (c < 0x800)
+		{
+			buf += static_cast<char>(0xC0 | c >> 6);
+			buf += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else
+		if (c < 0x10000)
+		{
+			buf += static_cast<char>(0xE0 | c >> 12);
+			buf += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+			buf += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			buf += static_cast<char>(0xF0 | c >> 18);
+			buf += static_cast<char>(0x80 | (c >> 12 & 0x3F));
+			buf += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+			buf += static_cast<char>(0x80 | (c & 0x3F));
+		}
+	}
+
+	void screen::move(std::size_t col, std::size_t row)
+	{
+		if (known and row == y)
+		{
+			if (col == x) return;
+
+			if (x < col)
+			{
+				// Reprinting a few unchanged cells is shorter than any move
+				auto const from = last.begin() + row * width;
+				auto const same = [this](cell const& c) { return c.same(pen) and 1 == columns(c.code); };
+				if (col - x <= 3 and std::all_of(from + x, from + col, same))
+				{
+					std::for_each(from + x, from + col, [this](cell const& c) { glyph(c.code); });
+					x = col;
+					return;
+				}
+
+				intro(buf);
+				if (1 < col - x) number(buf, col - x);
+				buf += CSI::CUF;
+			}
+			else
+			{
+				intro(buf);
+				if (0 < col) number(buf, col + 1);
+				buf += CSI::CHA;
+			}
+		}
+		else
+		if (known and row == y + 1 and 0 == col)
+		{
+			buf += C0::CR;
+			buf += C0::LF;
+		}
+		else
+		{
+			intro(buf);
+			if (0 < row or 0 < col) number(buf, row + 1);
+			if (0 < col)
+			{
+				buf += ';';
+				number(buf, col + 1);
+			}
+			buf += CSI::CUP;
+		}
+
+		x = col;
+		y = row;
+		known = true;
+	}
+
+	void screen::style(cell const& c)
+	{
+		if (c.same(pen)) return;
+
+		// Turn off only what changed
+		params step;
+		unsigned char const off = pen.attr & ~c.attr;
+		unsigned char on = c.attr & ~pen.attr;
+		if (off & (cell::intense | cell::faint))
+		{
+			// One code clears both so restore whichever stays
+			step.add(SGR::intense_off);
+			on |= c.attr & (cell::intense | cell::faint);
+		}
+		if (off & cell::italic) step.add(SGR::italic_off);
+		if (off & cell::underline) step.add(SGR::underline_off);
+		if (off & cell::blink) step.add(SGR::blink_off);
+		if (off & cell::reverse) step.add(SGR::inverse_off);
+		if (off & cell::strike) step.add(SGR::strike_off);
+		step.attrs(on);
+		if (c.fg != pen.fg) step.color(c.fg, SGR::fg_black, 90);
+		if (c.bg != pen.bg) step.color(c.bg, SGR::bg_black, 100);
+
+		// Or start again from the default
+		params reset;
+		reset.add(SGR::reset);
+		reset.attrs(c.attr);
+		if (cell::plain != c.fg) reset.color(c.fg, SGR::fg_black, 90);
+		if (cell::plain != c.bg) reset.color(c.bg, SGR::bg_black, 100);
+
+		auto const& p = reset.width + reset.size < step.width + step.size ? reset : step;
+		intro(buf);
+		for (std::size_t i = 0; i < p.size; ++i)
+		{
+			if (0 < i) buf += ';';
+			number(buf, static_cast<std::size_t>(p.list[i]));
+		}
+		buf += CSI::SGR;
+
+		pen.fg = c.fg;
+		pen.bg = c.bg;
+		pen.attr = c.attr;
+	}
+
+	view screen::render()
+	{
+		buf.clear();
+
+		if (fresh)
+		{
+			// Start from a blank page in the default rendition
+			constexpr auto& reset = io::escaped<G0::CSI, CSI::SGR, SGR::reset>;
+			constexpr auto& erase = io::escaped<G0::CSI, CSI::ED, ED::erase_page>;
+			buf.append(reset.data, reset.size);
+			buf.append(erase.data, erase.size);
+
+			std::fill(last.begin(), last.end(), cell{});
+			pen = cell{};
+			known = false;
+			fresh = false;
+		}
+
+		// Whether a double width character has its right half after it
+		auto const pair = [this](fwd::vector<cell> const& cells, std::size_t at, std::size_t col)
+		{
+			return col + 1 < width and 2 == columns(cells[at].code) and cell::trail == cells[at + 1].code;
+		};
+
+		for (std::size_t row = 0; row < height; ++row)
+		{
+			bool broken = false;
+			for (std::size_t col = 0, n; col < width; col += n)
+			{
+				auto const at = row * width + col;
+				auto const& c = next[at];
+				auto const now = pair(next, at, col), was = pair(last, at, col);
+				n = now ? 2 : 1;
+
+				bool const same = c == last[at] and now == was and (not now or next[at + 1] == last[at + 1]);
+				// Covering half of a wide character blanks the other half
+				bool const redraw = broken;
+				broken = (was and not now) or (now and pair(last, at + 1, col + 1));
+				if (same and not redraw) continue;
+
+				move(col, row);
+				style(c);
+				if (now)
+				{
+					glyph(c.code);
+					last[at + 1] = next[at + 1];
+				}
+				else
+				{
+					// Halves on their own and characters without a cell stand out
+					glyph(cell::trail == c.code ? U' ' : 1 == columns(c.code) ? c.code : 0xFFFD);
+				}
+				last[at] = c;
+
+				x += n;
+				if (x == width)
+				{
+					// Terminals disagree on where the cursor waits after the margin
+					known = false;
+				}
+			}
+		}
+
+		return buf;
+	}
+
+	bool screen::flush(env::file::writer const& out)
+	{
+		auto const frame = render();
+		auto const size = frame.size();
+		if (0 == size) return success;
+
+		auto const n = out.write(frame.data(), size);
+		if (n < 0 or static_cast<std::size_t>(n) != size)
+		{
+			sys::err(here, "write", size);
+			return failure;
+		}
+		return success;
+	}
+}
+
+#ifdef test_unit
+
+test_unit(scr)
+{
+	fmt::screen s(10, 3);
+
+	// First frame clears the page and draws nothing that is blank
+	assert(s.render() == "\x1b[0m\x1b[2J");
+	assert(s.render().empty());
+
+	// Absolute move from an unknown position
+	assert(2 == s.put(0, 0, "Hi"));
+	assert(s.render() == "\x1b[HHi");
+
+	// Short gaps are reprinted rather than moved over
+	s(4, 0).code = U'x';
+	assert(s.render() == "  x");
+
+	// Longer gaps on the same row move forward
+	s(9, 0).code = U'y';
+	assert(s.render() == "\x1b[4Cy");
+
+	// Colour change then the right margin forgets the cursor
+	fmt::cell red;
+	red.fg = 1;
+	s.put(9, 2, "z", red);
+	assert(s.render() == "\x1b[3;10H\x1b[31mz");
+
+	// Reset is shorter than restoring the default colour
+	s.put(0, 1, "w");
+	assert(s.render() == "\x1b[2H\x1b[0mw");
+
+	// Next line from the first column
+	s.put(0, 2, "\xc3\xa9");
+	assert(s.render() == "\r\n\xc3\xa9");
+
+	// Going back on the same row
+	s(1, 1).code = U'v';
+	assert(s.render() == "\x1b[2;2Hv");
+	s(0, 1).code = U'u';
+	assert(s.render() == "\x1b[Gu");
+
+	// A reset is shorter than turning off many attributes
+	fmt::cell loud;
+	loud.attr = fmt::cell::intense | fmt::cell::underline;
+	loud.fg = 1;
+	loud.bg = 200;
+	s.put(2, 1, "L", loud);
+	assert(s.render() == "v\x1b[1;4;31;48;5;200mL");
+	s.put(3, 1, "M");
+	assert(s.render() == "\x1b[0mM");
+
+	// Removing one of intense and faint keeps the other
+	fmt::cell both;
+	both.attr = fmt::cell::intense | fmt::cell::faint;
+	both.fg = 1;
+	s.put(4, 1, "B", both);
+	fmt::cell dim = both;
+	dim.attr = fmt::cell::faint;
+	s.put(5, 1, "D", dim);
+	assert(s.render() == "\x1b[1;2;31mB\x1b[22;2mD");
+
+	// Controls never reach the terminal
+	s.put(6, 1, "\t");
+	assert(s(6, 1).code == 0xFFFD);
+
+	// Nor do C1 controls, and joining marks have no cell to go in
+	assert(10 == s.put(7, 1, "e\xcc\x81\xc2\x9b"));
+	assert(s(8, 1).code == 0xFFFD and s(9, 1).code == 0xFFFD);
+
+	// Clipped at the margin
+	assert(10 == s.put(8, 0, "long"));
+
+	// Invalidate redraws everything that is not blank
+	s.render();
+	s.invalidate();
+	auto const all = s.render();
+	assert(all.starts_with("\x1b[0m\x1b[2J\x1b[HHi"));
+	assert(s.render().empty());
+
+	// Double width characters cover the cell after them and move the cursor by two
+	fmt::screen w(6, 2);
+	(void) w.render();
+	assert(4 == w.put(0, 0, "\xe6\x97\xa5\xe6\x9c\xac"));
+	assert(w(1, 0).code == fmt::cell::trail);
+	assert(w.render() == "\x1b[H\xe6\x97\xa5\xe6\x9c\xac");
+	w.put(4, 0, "x");
+	assert(w.render() == "x");
+
+	// A narrow one over its left half blanks the right half too
+	w.put(2, 0, "a");
+	assert(w.render() == "\x1b[3Ga ");
+
+	// Gaps with wide characters are moved over rather than reprinted
+	assert(4 == w.put(0, 1, "a\xe6\x97\xa5" "b"));
+	assert(w.render() == "\r\na\xe6\x97\xa5" "b");
+	w.put(0, 1, "c");
+	assert(w.render() == "\x1b[Gc");
+	w.put(3, 1, "d");
+	assert(w.render() == "\x1b[2Cd");
+
+	// One which does not fit before the margin is clipped
+	assert(5 == w.put(5, 1, "\xe6\x97\xa5"));
+	assert(w(5, 1).code == U' ');
+}
+
+#endif
+#ifdef bench_unit
+
+namespace
+{
+	fwd::vector<fmt::cell> noise(sys::bench::random& next, std::size_t size)
+	{
+		fwd::vector<fmt::cell> cells(size);
+		for (auto& c : cells)
+		{
+			c.code = static_cast<char32_t>('!' + next(94));
+			c.fg = static_cast<std::uint16_t>(next(8));
+			c.attr = next(8) ? 0 : fmt::cell::intense;
+		}
+		return cells;
+	}
+
+	void load(fmt::screen& s, fwd::vector<fmt::cell> const& cells)
+	{
+		for (std::size_t row = 0, at = 0; row < s.rows(); ++row)
+		{
+			for (std::size_t col = 0; col < s.cols(); ++col, ++at)
+			{
+				s(col, row) = cells[at];
+			}
+		}
+	}
+}
+
+bench_unit(scr)
+{
+	constexpr std::size_t cols = 200, rows = 50, size = cols * rows;
+	sys::bench::random next(42);
+	fwd::vector<fmt::cell> const frames[] = { noise(next, size), noise(next, size) };
+
+	auto const report = [&bench](std::size_t bytes)
+	// Bytes written per frame for each kind of update
+	{
+		bench.results.back().counters.emplace_back("bytes/frame", static_cast<double>(bytes));
+	};
+
+	{
+		fmt::screen s(cols, rows);
+		load(s, frames[0]);
+		s.render();
+		load(s, frames[1]);
+		auto const bytes = s.render().size();
+		std::size_t flip = 0;
+		bench("diff/full", bytes, [&](std::size_t n)
+		{
+			while (n--)
+			{
+				load(s, frames[flip ^= 1]);
+				sys::bench::keep(s.render());
+			}
+		});
+		report(bytes);
+	}
+
+	{
+		// Status line of counters which tick every frame
+		fmt::screen s(cols, rows);
+		load(s, frames[0]);
+		s.render();
+		unsigned long tick = 0;
+		auto const update = [&]
+		{
+			char line[64];
+			auto const end = std::to_chars(line, line + sizeof line, tick++).ptr;
+			s.put(cols - 24, rows - 1, fmt::view(line, end - line));
+		};
+		update();
+		auto const bytes = s.render().size();
+		bench("diff/ticker", bytes, [&](std::size_t n)
+		{
+			while (n--)
+			{
+				update();
+				sys::bench::keep(s.render());
+			}
+		});
+		report(bytes);
+	}
+
+	{
+		// One in a hundred cells changes
+		fmt::screen s(cols, rows);
+		load(s, frames[0]);
+		s.render();
+		fwd::vector<std::size_t> spots(size / 100);
+		for (auto& at : spots) at = next(size);
+		auto const update = [&]
+		{
+			for (auto const at : spots)
+			{
+				auto& c = s(at % cols, at / cols);
+				c.code = c.code == U'~' ? U'!' : c.code + 1;
+			}
+		};
+		update();
+		auto const bytes = s.render().size();
+		bench("diff/sparse", bytes, [&](std::size_t n)
+		{
+			while (n--)
+			{
+				update();
+				sys::bench::keep(s.render());
+			}
+		});
+		report(bytes);
+	}
+
+	{
+		// Whole page through the stream manipulators as a baseline
+		auto const draw = [&](fwd::vector<fmt::cell> const& cells)
+		{
+			fmt::string::stream out;
+			out << fmt::io::ctl<fmt::CSI::CUP, 1, 1>;
+			for (auto const& c : cells)
+			{
+				out << fmt::io::reset;
+				if (c.attr) out << fmt::io::intense;
+				out << fmt::io::rendition({ fmt::SGR::fg_black + c.fg });
+				out << static_cast<char>(c.code);
+			}
+			return out.str();
+		};
+		auto const bytes = draw(frames[0]).size();
+		std::size_t flip = 0;
+		bench("naive/full", bytes, [&](std::size_t n)
+		{
+			while (n--) sys::bench::keep(draw(frames[flip ^= 1]));
+		});
+		report(bytes);
+	}
+}
+
+#endif
@@ -0,0 +1,396 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+#include "sort.hpp"
+#include "sync.hpp"
+#include "err.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	using view = fmt::string::view;
+
+	constexpr std::size_t tiny = 12;       // insertion sort below this
+	constexpr std::size_t small = 64;      // multikey quicksort below this
+	constexpr std::size_t crowd = 1 << 15; // strings worth sharing between threads
+
+	int at(view const& u, std::size_t depth)
+	// Byte after the common prefix counted from one, or zero past the end
+	{
+		return depth < u.size() ? 1 + static_cast<unsigned char>(u[depth]) : 0;
+	}
+
+	bool before(view const& a, view const& b, std::size_t depth)
+	// Compare what follows the common prefix
+	{
+		auto const n = std::min(a.size(), b.size()) - depth;
+		auto const c = 0 < n ? std::memcmp(a.data() + depth, b.data() + depth, n) : 0;
+		return c < 0 or (0 == c and a.size() < b.size());
+	}
+
+	std::size_t common(view const* v, std::size_t n, std::size_t depth)
+	// Length of the prefix which every string shares beyond depth
+	{
+		auto const first = v[0].data() + depth;
+		auto most = v[0].size() - depth;
+		for (std::size_t i = 1; i < n and 0 < most; ++i)
+		{
+			auto const next = v[i].data() + depth;
+			auto const limit = std::min(most, v[i].size() - depth);
+			std::size_t k = 0;
+			while (k < limit and first[k] == next[k]) ++k;
+			most = k;
+		}
+		return most;
+	}
+
+	void insertion(view* v, std::size_t n, std::size_t depth)
+	{
+		for (std::size_t i = 1; i < n; ++i)
+		{
+			auto const u = v[i];
+			auto j = i;
+			for (; 0 < j and before(u, v[j - 1], depth); --j)
+			{
+				v[j] = v[j - 1];
+			}
+			v[j] = u;
+		}
+	}
+
+	void quick(view* v, std::size_t n, std::size_t depth)
+	// Three way partition on one byte, walking into the equal part without recursion
+	{
+		while (tiny < n)
+		{
+			int const a = at(v[0], depth), b = at(v[n / 2], depth), c = at(v[n - 1], depth);
+			int const pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+			std::size_t lt = 0, i = 0, gt = n;
+			while (i < gt)
+			{
+				int const k = at(v[i], depth);
+				if (k < pivot)
+				{
+					std::swap(v[lt++], v[i++]);
+				}
+				else
+				if (pivot < k)
+				{
+					std::swap(v[i], v[--gt]);
+				}
+				else ++i;
+			}
+
+			quick(v, lt, depth);
+			quick(v + gt, n - gt, depth);
+			if (0 == pivot)
+			{
+				return; // equal strings which have ended
+			}
+			// All equal means a shared prefix, which is skipped whole
+			depth += 0 == lt and n == gt ? 1 + common(v, n, depth + 1) : 1;
+			v += lt;
+			n = gt - lt;
+		}
+		insertion(v, n, depth);
+	}
+
+	struct range
+	{
+		view* v;             // strings sharing a prefix of depth bytes
+		view* copy;          // scratch of the same size
+		std::uint16_t* key;  // scratch for each byte read
+		std::size_t n, depth;
+
+		range part(std::size_t begin, std::size_t size) const
+		{
+			return { v + begin, copy + begin, key + begin, size, depth + 1 };
+		}
+	};
+
+	template <class Visit> void spread(range r, Visit&& visit)
+	// Distribute by one byte, visiting each bucket which is not yet in order
+	{
+		std::size_t count[257];
+		for (;;)
+		{
+			std::fill(std::begin(count), std::end(count), 0);
+			for (std::size_t i = 0; i < r.n; ++i)
+			{
+				++count[r.key[i] = static_cast<std::uint16_t>(at(r.v[i], r.depth))];
+			}
+
+			if (r.n != count[r.key[0]])
+			{
+				break;
+			}
+			if (0 == r.key[0])
+			{
+				return; // every string is the same
+			}
+			// One bucket holds them all, so skip the rest of their common prefix
+			r.depth += 1 + common(r.v, r.n, r.depth + 1);
+		}
+
+		std::size_t start[257], pos = 0;
+		for (int k = 0; k < 257; ++k)
+		{
+			start[k] = pos;
+			pos += count[k];
+		}
+		for (std::size_t i = 0; i < r.n; ++i)
+		{
+			r.copy[start[r.key[i]]++] = r.v[i];
+		}
+		std::copy(r.copy, r.copy + r.n, r.v);
+
+		// The first bucket holds strings which have ended and are equal
+		for (int k = 1; k < 257; ++k)
+		{
+			if (1 < count[k])
+			{
+				visit(r.part(start[k] - count[k], count[k]));
+			}
+		}
+	}
+
+	void radix(range r)
+	{
+		if (r.n < small)
+		{
+			quick(r.v, r.n, r.depth);
+		}
+		else spread(r, radix);
+	}
+
+	void split(range r, std::size_t most, fwd::vector<range>& tasks)
+	// Divide until every bucket is a fair share of the work
+	{
+		if (r.n <= most)
+		{
+			tasks.push_back(r);
+		}
+		else spread(r, [&](range part)
+		{
+			split(part, most, tasks);
+		});
+	}
+}
+
+namespace fwd
+{
+	void sort_strings(span<fmt::string::view> s, std::size_t threads)
+	{
+		if (s.size() < 2)
+		{
+			return;
+		}
+
+		vector<fmt::string::view> copy(s.size());
+		vector<std::uint16_t> key(s.size());
+		range const all { s.data(), copy.data(), key.data(), s.size(), 0 };
+
+		if (0 == threads)
+		{
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		if (threads < 2 or s.size() < crowd)
+		{
+			radix(all);
+			return;
+		}
+
+		// Largest buckets first so that no thread is left with a long one at the end
+		vector<range> tasks;
+		split(all, std::max(small, s.size() / (threads * 8)), tasks);
+		std::sort(tasks.begin(), tasks.end(), [](range const& a, range const& b)
+		{
+			return b.n < a.n;
+		});
+
+		sys::share(threads, tasks.size(), [&](std::size_t i)
+		{
+			radix(tasks[i]);
+		});
+	}
+
+	span<fmt::string::view> unique_strings(span<fmt::string::view> s)
+	{
+		auto const end = std::unique(s.begin(), s.end(), [](view const& a, view const& b)
+		{
+			return a.size() == b.size() and (a.empty() or 0 == std::memcmp(a.data(), b.data(), a.size()));
+		});
+		return s.first(static_cast<std::size_t>(end - s.begin()));
+	}
+
+	vector<fmt::string::view> sorted_merge(span<fmt::string::view const> a, span<fmt::string::view const> b)
+	{
+		vector<fmt::string::view> out;
+		out.reserve(a.size() + b.size());
+		std::size_t i = 0, j = 0;
+		while (i < a.size() and j < b.size())
+		{
+			if (before(a[i], b[j], 0))
+			{
+				out.push_back(a[i++]);
+			}
+			else
+			if (before(b[j], a[i], 0))
+			{
+				out.push_back(b[j++]);
+			}
+			else
+			{
+				out.push_back(a[i++]);
+				++j;
+			}
+		}
+		out.insert(out.end(), a.begin() + i, a.end());
+		out.insert(out.end(), b.begin() + j, b.end());
+		return out;
+	}
+}
+
+#ifdef bench_unit
+
+namespace
+{
+	fmt::string::vector paths(std::size_t count, unsigned long long seed)
+	// Deep names sharing long prefixes, like a directory listing
+	{
+		auto const words = sys::bench::words(64, seed);
+		sys::bench::random next(seed);
+		fmt::string::vector t;
+		t.reserve(count);
+		while (t.size() < count)
+		{
+			fmt::string s = "/usr/share/local";
+			for (auto n = 1 + next(6); 0 < n; --n)
+			{
+				s += '/';
+				s += words[next(words.size())];
+			}
+			t.emplace_back(std::move(s));
+		}
+		return t;
+	}
+}
+
+#endif
+#ifdef test_unit
+
+namespace
+{
+	bool ordered(fwd::span<view const> s)
+	{
+		return std::is_sorted(s.begin(), s.end(), [](view const& a, view const& b)
+		{
+			return before(a, b, 0);
+		});
+	}
+}
+
+test_unit(sort)
+{
+	// Same order as the standard sort, duplicates and empty strings included
+	for (std::size_t size : { 0, 1, 5, 40, 500, 5000 })
+	{
+		auto words = sys::bench::words(size, 3);
+		auto more = paths(size, 4);
+		fmt::string::vector text(words.begin(), words.end());
+		text.insert(text.end(), more.begin(), more.end());
+		text.insert(text.end(), words.begin(), words.begin() + static_cast<std::ptrdiff_t>(size / 2));
+		text.emplace_back();
+		text.emplace_back();
+
+		fmt::string::view::vector s(text.begin(), text.end());
+		auto t = s;
+		fwd::sort_strings(s);
+		std::sort(t.begin(), t.end());
+		assert(std::equal(s.begin(), s.end(), t.begin(), t.end()));
+		assert(ordered(s));
+	}
+	// Bytes above seven bits order after ASCII
+	{
+		fmt::string::view::vector s { "\xc3\xa9t\xc3\xa9", "ete", "\xff", "", "e" };
+		fwd::sort_strings(s);
+		assert(s[0].empty() and "e" == s[1] and "ete" == s[2] and "\xff" == s[4]);
+	}
+	// Threads give the same order
+	{
+		auto const text = paths(1 << 16, 5);
+		fmt::string::view::vector s(text.begin(), text.end());
+		auto t = s;
+		fwd::sort_strings(s, 4);
+		fwd::sort_strings(t, 1);
+		assert(std::equal(s.begin(), s.end(), t.begin(), t.end()));
+		assert(ordered(s));
+	}
+	// Duplicates removed and runs merged
+	{
+		fmt::string::view::vector s { "b", "a", "c", "a", "b", "" };
+		fwd::sort_strings(s);
+		auto const u = fwd::unique_strings(s);
+		assert(4 == u.size() and u[0].empty() and "c" == u[3]);
+
+		fmt::string::view::vector const t { "aa", "b", "d" };
+		auto const m = fwd::sorted_merge(u, t);
+		assert(6 == m.size() and ordered(m));
+		assert("aa" == m[2] and "b" == m[3] and "d" == m[5]);
+	}
+}
+
+#endif
+#ifdef bench_unit
+
+bench_unit(sort)
+{
+	// Names and paths sorted whole, copied back each time
+	for (std::size_t size : { 1 << 10, 1 << 14, 1 << 18 })
+	{
+		auto const words = sys::bench::words(size, 6);
+		auto const names = paths(size, 7);
+		fmt::string::view::vector const a(words.begin(), words.end()), b(names.begin(), names.end());
+		fmt::string::view::vector s(size);
+
+		for (auto const& [name, from] : { std::pair("words", &a), std::pair("paths", &b) })
+		{
+			auto const& input = *from;
+			bench(sys::bench::label(fmt::to_string(name) + "/std", size), 0, [&](std::size_t n)
+			{
+				while (n--)
+				{
+					std::copy(input.begin(), input.end(), s.begin());
+					std::sort(s.begin(), s.end());
+				}
+				sys::bench::keep(s.front());
+			});
+
+			bench(sys::bench::label(fmt::to_string(name) + "/radix", size), 0, [&](std::size_t n)
+			{
+				while (n--)
+				{
+					std::copy(input.begin(), input.end(), s.begin());
+					fwd::sort_strings(s, 1);
+				}
+				sys::bench::keep(s.front());
+			});
+
+			bench(sys::bench::label(fmt::to_string(name) + "/parallel", size), 0, [&](std::size_t n)
+			{
+				while (n--)
+				{
+					std::copy(input.begin(), input.end(), s.begin());
+					fwd::sort_strings(s);
+				}
+				sys::bench::keep(s.front());
+			});
+		}
+	}
+}
+
+#endif
@@ -11,6 +11,8 @@
 #include "pipe.hpp"
 #include "sync.hpp"
 #include "type.hpp"
+#include "line.hpp"
+#include <map>
 #ifdef _WIN32
 #include "win/message.hpp"
 #else
@@ -45,8 +47,7 @@ namespace sys
 		static sys::mutex key;
 		auto const unlock = key.lock();
 
-		fmt::string line;
-		while (std::getline(thread_buf, line))
+		for (auto const line : fmt::lines(thread_buf))
 		{
 			buf << line << std::endl;
 		}
@@ -491,6 +492,7 @@ namespace sys::sig
 {
 	socket &scope::event(int no)
 	{
+		// Sockets cannot move, so they stay in the nodes of a tree
 		static std::map<int, sys::sig::socket> map;
 		return map[no];
 	}
@@ -700,3 +702,542 @@ test_unit(sig)
 }
 
 #endif
+
+#if defined(test_unit) || defined(bench_unit)
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#ifndef _WIN32
+#include "uni/semaphore.hpp"
+#endif
+
+namespace
+{
+	size_t stress(size_t count, size_t rounds, unsigned long long seed)
+	// Random operations on every primitive, counting broken invariants
+	{
+		std::atomic<size_t> broken { 0 };
+		std::atomic<long> inside { 0 }, readers { 0 }, writers { 0 };
+
+		sys::mutex mutex;
+		long counter = 0;
+
+		sys::rwlock rwlock;
+
+		struct balance
+		{
+			long left = 0, right = 0;
+		};
+		sys::exclusive<balance> pair;
+
+		sys::atomic<long> triple;
+
+		#ifndef _WIN32
+		constexpr long limit = 2;
+		std::atomic<long> held { 0 };
+		sys::uni::sem::init sem(limit);
+
+		sys::mutex qm;
+		sys::uni::cond qc;
+		std::deque<size_t> queue;
+		std::atomic<size_t> produced { 0 }, consumed { 0 };
+		#endif
+
+		fwd::vector<size_t> locked(count, 0);
+		fwd::vector<std::thread> pool;
+		for (size_t id = 0; id < count; ++id)
+		{
+			pool.emplace_back([&, id]
+			{
+				sys::bench::random next(seed + id);
+				for (size_t round = 0; round < rounds; ++round)
+				{
+					switch (next(6))
+					{
+					case 0:
+						{
+							auto const key = mutex.lock();
+							if (1 != ++ inside) ++ broken;
+							++ counter;
+							++ locked[id];
+							-- inside;
+						}
+						break;
+
+					case 1:
+						if (next(2))
+						{
+							auto const key = rwlock.read();
+							++ readers;
+							if (0 != writers) ++ broken;
+							-- readers;
+						}
+						else
+						{
+							auto const key = rwlock.write();
+							if (1 != ++ writers or 0 != readers) ++ broken;
+							-- writers;
+						}
+						break;
+
+					case 2:
+						if (next(2))
+						{
+							auto const reader = pair.read();
+							if (0 != reader->left + reader->right) ++ broken;
+						}
+						else
+						{
+							auto writer = pair.write();
+							++ writer->left;
+							-- writer->right;
+						}
+						break;
+
+					case 3:
+						if (next(2))
+						{
+							if (0 != triple % 3) ++ broken;
+						}
+						else
+						{
+							triple = 3 * static_cast<long>(next(1000));
+						}
+						break;
+
+					#ifndef _WIN32
+					case 4:
+						if (not sem.wait())
+						{
+							if (limit < ++ held) ++ broken;
+							-- held;
+							(void) sem.post();
+						}
+						break;
+
+					case 5:
+						{
+							// Push before pop so that a waiter is always woken
+							{
+								auto const key = qm.lock();
+								queue.push_back(id);
+								++ produced;
+							}
+							(void) qc.signal();
+							{
+								auto const key = qm.lock();
+								while (queue.empty())
+								{
+									(void) qm.wait(qc);
+								}
+								queue.pop_front();
+								++ consumed;
+							}
+						}
+						break;
+					#endif
+					}
+				}
+			});
+		}
+
+		for (auto& t : pool)
+		{
+			t.join();
+		}
+
+		// Totals agree once every thread has finished
+		size_t total = 0;
+		for (auto n : locked) total += n;
+		if (fmt::to_size(counter) != total) ++ broken;
+		{
+			auto const reader = pair.read();
+			if (0 != reader->left + reader->right) ++ broken;
+		}
+		#ifndef _WIN32
+		if (produced != consumed or not queue.empty()) ++ broken;
+		#endif
+
+		return broken;
+	}
+}
+#endif
+
+#ifdef test_unit
+test_unit(sync)
+{
+	auto const count = 2 * std::max(2u, std::thread::hardware_concurrency());
+	assert(0 == stress(count, 1 << 12, 1));
+}
+
+test_unit(share)
+{
+	fwd::vector<std::atomic<int>> runs(1000);
+	sys::share(4, runs.size(), [&](size_t i)
+	{
+		++ runs[i];
+	});
+	assert(std::all_of(runs.begin(), runs.end(), [](auto const& n) { return 1 == n; }));
+
+	// A throw on one worker reaches the caller once all have joined
+	bool caught = false;
+	try
+	{
+		sys::share(4, runs.size(), [](size_t i)
+		{
+			if (42 == i) throw std::runtime_error("share");
+		});
+	}
+	catch (std::runtime_error const&)
+	{
+		caught = true;
+	}
+	assert(caught);
+}
+#endif
+
+#ifdef bench_unit
+namespace
+{
+	struct workload
+	{
+		fmt::string::view label;
+		size_t reads; // percentage of operations that only read
+	};
+
+	constexpr workload mixes[] =
+	{
+		{ "read", 95 },
+		{ "mixed", 50 },
+		{ "write", 5 },
+	};
+
+	fwd::vector<size_t> threads()
+	// Thread counts doubling from one up to the hardware concurrency
+	{
+		fwd::vector<size_t> t;
+		auto const most = std::max<size_t>(1, std::thread::hardware_concurrency());
+		for (size_t n = 1; n <= most; n *= 2)
+		{
+			t.push_back(n);
+		}
+		if (t.back() < most)
+		{
+			t.push_back(most);
+		}
+		return t;
+	}
+
+	template <class Enter>
+	void fairness(sys::bench::suite& bench, fmt::string::view label, size_t count, Enter enter)
+	// Threads contend for a fixed time recording each wait to enter
+	{
+		using clock = std::chrono::steady_clock;
+		constexpr size_t most = 1 << 18;
+		auto const& opt = sys::bench::settings();
+		std::chrono::duration<double> const span(opt.target * opt.samples);
+
+		fwd::vector<fwd::vector<double>> waits(count);
+		fwd::vector<size_t> ops(count, 0);
+		std::atomic<size_t> ready { 0 };
+		std::atomic<bool> stop { false };
+
+		fwd::vector<std::thread> pool;
+		for (size_t id = 0; id < count; ++id)
+		{
+			pool.emplace_back([&, id]
+			{
+				auto& mine = waits[id];
+				mine.reserve(most);
+				for (++ ready; ready < count; )
+				{
+					std::this_thread::yield();
+				}
+
+				size_t n = 0;
+				while (not stop.load(std::memory_order_relaxed))
+				{
+					auto const begin = clock::now();
+					auto const key = enter();
+					std::chrono::duration<double, std::nano> const wait = clock::now() - begin;
+					if (mine.size() < most)
+					{
+						mine.push_back(wait.count());
+					}
+					++ n;
+				}
+				ops[id] = n;
+			});
+		}
+
+		while (ready < count)
+		{
+			std::this_thread::yield();
+		}
+		std::this_thread::sleep_for(span);
+		stop = true;
+		for (auto& t : pool)
+		{
+			t.join();
+		}
+
+		fwd::vector<double> all;
+		double sum = 0, squares = 0;
+		for (size_t id = 0; id < count; ++id)
+		{
+			all.insert(all.end(), waits[id].begin(), waits[id].end());
+			auto const x = static_cast<double>(ops[id]);
+			sum += x;
+			squares += x * x;
+		}
+
+		if (all.empty())
+		{
+			return;
+		}
+
+		std::sort(all.begin(), all.end());
+		auto const at = [&all](double q)
+		{
+			auto const rank = static_cast<size_t>(std::ceil(q * all.size()));
+			return all[std::clamp<size_t>(rank, 1, all.size()) - 1];
+		};
+
+		auto& out = bench.results.emplace_back();
+		out.name = fmt::to_string(bench.name) + "/fair/" + sys::bench::label(label, count);
+		out.iterations = static_cast<size_t>(sum);
+		out.samples = all.size();
+		out.median = at(0.5);
+		out.p99 = at(0.99);
+		out.mean = std::accumulate(all.begin(), all.end(), 0.0) / all.size();
+		out.rate = sum / span.count();
+		// Jain's index is one when every thread got the same share
+		out.counters.emplace_back("fairness", 0 < squares ? sum * sum / (count * squares) : 1);
+		out.counters.emplace_back("p999", at(0.999));
+		out.counters.emplace_back("max", all.back());
+	}
+}
+
+bench_unit(sync)
+{
+	// Uncontended latency of each primitive
+	{
+		sys::mutex mutex;
+		bench("mutex", [&](size_t n)
+		{
+			while (n--)
+			{
+				auto const key = mutex.lock();
+				sys::bench::clobber();
+			}
+		});
+
+		sys::rwlock rwlock;
+		bench("rwlock/read", [&](size_t n)
+		{
+			while (n--)
+			{
+				auto const key = rwlock.read();
+				sys::bench::clobber();
+			}
+		});
+
+		bench("rwlock/write", [&](size_t n)
+		{
+			while (n--)
+			{
+				auto const key = rwlock.write();
+				sys::bench::clobber();
+			}
+		});
+
+		sys::exclusive<fwd::vector<long>> vector;
+		vector.write()->resize(64);
+		bench("exclusive/read", [&](size_t n)
+		{
+			while (n--)
+			{
+				auto const reader = vector.read();
+				sys::bench::keep(reader->front());
+			}
+		});
+
+		bench("exclusive/write", [&](size_t n)
+		{
+			while (n--)
+			{
+				auto writer = vector.write();
+				++ writer->front();
+			}
+		});
+
+		sys::atomic<long> value;
+		bench("atomic/load", [&](size_t n)
+		{
+			while (n--)
+			{
+				sys::bench::keep(static_cast<long>(value));
+			}
+		});
+
+		bench("atomic/store", [&](size_t n)
+		{
+			while (n--)
+			{
+				value = static_cast<long>(n);
+			}
+		});
+
+		#ifndef _WIN32
+		sys::uni::sem::init sem(1);
+		bench("semaphore", [&](size_t n)
+		{
+			while (n-- and not sem.wait())
+			{
+				(void) sem.post();
+			}
+		});
+
+		sys::uni::cond cond;
+		bench("cond/signal", [&](size_t n)
+		{
+			while (n--)
+			{
+				(void) cond.signal();
+			}
+		});
+		#endif
+	}
+
+	// Contended throughput by thread count and mix of reads to writes
+	for (auto const count : threads())
+	{
+		for (auto const& mix : mixes)
+		{
+			auto const label = [&mix](fmt::string::view kind)
+			{
+				return fmt::to_string(kind) + "/" + fmt::to_string(mix.label);
+			};
+
+			sys::rwlock rwlock;
+			long shared = 0;
+			bench.parallel(label("rwlock"), count, 0, [&](size_t n, size_t id)
+			{
+				sys::bench::random next(id);
+				while (n--)
+				{
+					if (next(100) < mix.reads)
+					{
+						auto const key = rwlock.read();
+						sys::bench::keep(shared);
+					}
+					else
+					{
+						auto const key = rwlock.write();
+						++ shared;
+					}
+				}
+			});
+
+			sys::mutex mutex;
+			bench.parallel(label("mutex"), count, 0, [&](size_t n, size_t id)
+			{
+				sys::bench::random next(id);
+				while (n--)
+				{
+					auto const key = mutex.lock();
+					if (next(100) < mix.reads)
+					{
+						sys::bench::keep(shared);
+					}
+					else
+					{
+						++ shared;
+					}
+				}
+			});
+
+			sys::exclusive<fwd::vector<long>> vector;
+			vector.write()->resize(64);
+			bench.parallel(label("exclusive"), count, 0, [&](size_t n, size_t id)
+			{
+				sys::bench::random next(id);
+				while (n--)
+				{
+					auto const at = next(64);
+					if (next(100) < mix.reads)
+					{
+						auto const reader = vector.read();
+						sys::bench::keep(reader->at(at));
+					}
+					else
+					{
+						auto writer = vector.write();
+						++ writer->at(at);
+					}
+				}
+			});
+
+			sys::atomic<long> value;
+			bench.parallel(label("atomic"), count, 0, [&](size_t n, size_t id)
+			{
+				sys::bench::random next(id);
+				while (n--)
+				{
+					if (next(100) < mix.reads)
+					{
+						sys::bench::keep(static_cast<long>(value));
+					}
+					else
+					{
+						value = static_cast<long>(n);
+					}
+				}
+			});
+		}
+
+		#ifndef _WIN32
+		sys::uni::sem::init sem(1);
+		bench.parallel("semaphore", count, 0, [&](size_t n, size_t)
+		{
+			while (n-- and not sem.wait())
+			{
+				(void) sem.post();
+			}
+		});
+		#endif
+
+		// Share of the lock each thread got and the tail of its waits
+		sys::mutex mutex;
+		fairness(bench, "mutex", count, [&mutex]
+		{
+			return mutex.lock();
+		});
+
+		sys::rwlock rwlock;
+		fairness(bench, "rwlock", count, [&rwlock]
+		{
+			return rwlock.write();
+		});
+	}
+}
+
+bench_unit(stress)
+// One round of random operations on all primitives with checks
+{
+	auto const count = 2 * std::max(2u, std::thread::hardware_concurrency());
+	unsigned long long seed = 0;
+	bench("rounds", [&](size_t n)
+	{
+		if (0 < stress(count, n, ++ seed))
+		{
+			sys::err(here, "stress", count, seed);
+		}
+	});
+}
+#endif
@@ -10,12 +10,18 @@
 #include "dev.hpp"
 #include "sig.hpp"
 #include "err.hpp"
+#include "ini.hpp"
+#include "dig.hpp"
+#include "bench.hpp"
 #include <iostream>
 #include <fstream>
 #include <future>
 #include <vector>
 #include <set>
 #include <map>
+#include <new>
+#include <cstdlib>
+#include <algorithm>
 
 #ifndef _TOOLS
 # define _TOOLS "Tools.ini"
@@ -33,6 +39,96 @@ test_unit(err)
 #endif
 #endif
 
+// Global allocation is replaced in the runner alone, so that benchmarks can
+// count the calls made by each operation without taxing other programs
+
+namespace
+{
+	thread_local std::size_t allocated = 0;
+
+	std::size_t allocations()
+	{
+		return allocated;
+	}
+
+	void* allocate(std::size_t size, std::size_t align)
+	{
+		++ allocated;
+		size = std::max<std::size_t>(1, size);
+		bool const over = alignof(std::max_align_t) < align;
+		if (over)
+		{
+			size = (size + align - 1) / align * align;
+		}
+
+		for (;;)
+		{
+			#ifdef _WIN32
+			auto const ptr = over ? _aligned_malloc(size, align) : std::malloc(size);
+			#else
+			auto const ptr = over ? std::aligned_alloc(align, size) : std::malloc(size);
+			#endif
+			if (nullptr != ptr)
+			{
+				return ptr;
+			}
+
+			auto const handler = std::get_new_handler();
+			if (nullptr == handler)
+			{
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+	}
+
+	void release(void* ptr, std::size_t align) noexcept
+	{
+		#ifdef _WIN32
+		if (alignof(std::max_align_t) < align)
+		{
+			_aligned_free(ptr);
+			return;
+		}
+		#else
+		(void) align;
+		#endif
+		std::free(ptr);
+	}
+}
+
+// Array and nothrow forms call these by default
+
+void* operator new(std::size_t size)
+{
+	return allocate(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+	return allocate(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void* ptr) noexcept
+{
+	release(ptr, 0);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	release(ptr, 0);
+}
+
+void operator delete(void* ptr, std::align_val_t align) noexcept
+{
+	release(ptr, static_cast<std::size_t>(align));
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t align) noexcept
+{
+	release(ptr, static_cast<std::size_t>(align));
+}
+
 namespace
 {
 	void runner(fmt::string::view name, fmt::string::buf::ptr buf, bool host)
@@ -85,10 +181,42 @@ namespace
 		}
 		sys::out().rdbuf(back);
 	}
+
+	void bencher(fmt::string::view name, sys::bench::result::vector& out)
+	{
+		try
+		{
+			auto const call = sys::sym<void(sys::bench::suite&)>(name);
+			if (nullptr == call)
+			{
+				sys::out() << name << " is missing" << fmt::eol;
+			}
+			else
+			{
+				sys::bench::suite bench(name.substr(name.find('_') + 1));
+				call(bench);
+				for (auto& result : bench.results)
+				{
+					out.emplace_back(std::move(result));
+				}
+			}
+		}
+		catch (std::exception const& error)
+		{
+			sys::out() << error.what() << fmt::eol;
+		}
+		catch (...)
+		{
+			sys::out() << "Unknown" << fmt::eol;
+		}
+	}
 }
 
 int main(int argc, char** argv)
 {
+	// Benchmarks count allocations through the replacements above
+	sys::bench::allocations(allocations);
+
 	// Default options file
 	fmt::string const config = _TOOLS;
 
@@ -103,6 +231,12 @@ int main(int argc, char** argv)
 			print = fmt::put("print"),
 			quiet = fmt::put("quiet"),
 			host  = fmt::put("host"),
+			bench = fmt::put("bench"),
+			base  = fmt::put("baseline"),
+			save  = fmt::put("save"),
+			limit = fmt::put("limit"),
+			count = fmt::put("counters"),
+			table = fmt::put("table"),
 			help  = fmt::put("help");
 	} arg;
 
@@ -116,6 +250,12 @@ int main(int argc, char** argv)
 		{ 0, "a", fmt::get(arg.async), "Run tests asynchronously" },
 		{ 1, "t", fmt::get(arg.tools), _TOOLS " is replaced with argument" },
 		{ 0, "o", fmt::get(arg.host), "Host tests in this process" },
+		{ 0, "b", fmt::get(arg.bench), "Run benchmarks instead of tests" },
+		{ 1, "r", fmt::get(arg.base), "Compare benchmarks with baseline file" },
+		{ 1, "s", fmt::get(arg.save), "Save benchmark results to file" },
+		{ 1, "x", fmt::get(arg.limit), "Regression threshold in percent" },
+		{ 0, "n", fmt::get(arg.count), "Attach hardware counters to benchmarks" },
+		{ 0, "m", fmt::get(arg.table), "Print benchmarks as tab separated values" },
 	};
 
 	// Command line parsing
@@ -127,6 +267,7 @@ int main(int argc, char** argv)
 	auto const quiet = env::opt::get(arg.quiet, false);
 	auto const async = env::opt::get(arg.async, false);
 	auto const tools = env::opt::get(arg.tools, config);
+	auto const bench = env::opt::get(arg.bench, false);
 	auto const clean = std::empty(env::opt::arguments());
 
 	// Initialize from tools
@@ -156,7 +297,7 @@ int main(int argc, char** argv)
 
 	// Map test names to error buffers' string stream
 	std::map<fmt::string, fmt::string::stream> context;
-	fmt::string::view const prefix = "test_";
+	fmt::string::view const prefix = bench ? "bench_" : "test_";
 	auto const program = env::opt::program();
 
 	if (std::empty(tests))
@@ -230,6 +371,8 @@ int main(int argc, char** argv)
 			<< fmt::eol << fmt::tab
 			<< "4. The dump symbols for " << prefix << "*"
 			<< fmt::eol
+			<< "Benchmarks are run in this process one at a time"
+			<< fmt::eol
 			<< "Commands for unit test runner:"
 			<< fmt::eol;
 
@@ -247,6 +390,143 @@ int main(int argc, char** argv)
 		return EXIT_SUCCESS;
 	}
 
+	// Run all the selected benchmarks in series
+	if (bench)
+	{
+		sys::bench::settings().counters = env::opt::get(arg.count, false);
+		auto const limit = env::opt::get(arg.limit, 5.0f);
+		auto const base = env::opt::get(arg.base, fmt::empty);
+		auto const save = env::opt::get(arg.save, fmt::empty);
+		auto const table = env::opt::get(arg.table, false);
+		auto const paint = color and not table;
+
+		doc::ini before, after;
+		if (not std::empty(base))
+		{
+			auto const path = fmt::to_string(base);
+			std::ifstream in { path };
+			if (in)
+			{
+				while (in >> before);
+			}
+			else
+			{
+				std::cerr << "Failed to open " << path << fmt::eol;
+			}
+		}
+
+		if (table)
+		{
+			// Header names the columns for other tools, every row having all of them
+			std::cout << "name" << fmt::tab << "iterations"
+			          << fmt::tab << "median" << fmt::tab << "p99"
+			          << fmt::tab << "rate" << fmt::tab << "base"
+			          << fmt::tab << "slower" << fmt::tab << "counters" << fmt::eol;
+		}
+
+		std::size_t counter = 0, errors = 0;
+		for (auto& [name, error] : context)
+		{
+			sys::bench::result::vector results;
+			auto const back = sys::out().rdbuf(error.rdbuf());
+			bencher(name, results);
+			(void) sys::out().rdbuf(back);
+
+			for (auto const& result : results)
+			{
+				// Suite is the group and label is the key
+				auto const pair = fmt::to_pair(result.name, "/");
+				auto const key = doc::path::pair { fmt::set(pair.first), fmt::set(pair.second) };
+				auto const old = before.get(key);
+				auto const slower = not std::empty(old)
+					and sys::bench::compare(result, fmt::to_double(old), limit);
+
+				if (paint)
+				{
+					std::cout << (slower ? fmt::io::fg_magenta : fmt::io::fg_green);
+				}
+
+				if (table)
+				{
+					// Counters share one column as a list of event=value
+					std::cout << result.name
+					          << fmt::tab << result.iterations
+					          << fmt::tab << fmt::to_string(result.median, 1)
+					          << fmt::tab << fmt::to_string(result.p99, 1)
+					          << fmt::tab << fmt::to_string(result.rate, 0)
+					          << fmt::tab << old
+					          << fmt::tab << (slower ? 1 : 0)
+					          << fmt::tab;
+
+					char const* sep = "";
+					for (auto const& [event, value] : result.counters)
+					{
+						std::cout << sep << event << '=' << fmt::to_string(value, 2);
+						sep = ",";
+					}
+				}
+				else
+				{
+					std::cout << result;
+					if (slower)
+					{
+						std::cout << fmt::tab << "slower than " << old;
+					}
+				}
+				std::cout << fmt::eol;
+				counter += slower;
+
+				(void) after.set(key, fmt::to_string(result.median, 1));
+			}
+
+			// Errors are not regressions and stay out of the table
+			auto& out = table ? std::cerr : std::cout;
+			for (fmt::string line; std::getline(error, line); ++ errors)
+			{
+				if (paint) out << fmt::io::fg_yellow;
+				out << name << fmt::tab << line << fmt::eol;
+			}
+		}
+
+		if (not std::empty(save))
+		{
+			auto const path = fmt::to_string(save);
+			std::ofstream out { path };
+			if (out)
+			{
+				out << after;
+			}
+			else
+			{
+				std::cerr << "Failed to write " << path << fmt::eol;
+			}
+		}
+
+		if (paint)
+		{
+			std::cout << (0 < counter + errors ? fmt::io::fg_magenta : fmt::io::fg_cyan);
+		}
+
+		if (not quiet and not table)
+		{
+			std::cout << "There are " << counter << " regressions";
+			if (0 < errors)
+			{
+				std::cout << " and " << errors << " errors";
+			}
+			std::cout << fmt::eol;
+		}
+
+		if (paint)
+		{
+			std::cout << fmt::io::reset;
+		}
+
+		std::cout << std::flush;
+
+		return 0 < counter + errors ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
 	// Run all the selected unit tests 
 	{
 		std::vector<std::future<void>> threads;